@@ -0,0 +1,125 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+#include "arena.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+#define ARENA_HEADER_SIZE   ((sizeof(ArenaBlock) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+void* Arena_Alloc(Arena *arena, size_t size)
+{
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    ArenaBlock *block = arena->Current;
+
+    if (block == NULL || block->Size - block->Used < size) // on to the next block
+    {
+        ArenaBlock *previous = block;
+        block = (previous != NULL) ? previous->Next : arena->First;
+
+        if (block == NULL || block->Size < size) // none left, or too small: a new one goes in before it
+        {
+            size_t blockSize = (size > ARENA_BLOCK_SIZE) ? size : ARENA_BLOCK_SIZE;
+            ArenaBlock *created = (ArenaBlock*)malloc(ARENA_HEADER_SIZE + blockSize);
+
+            if (created == NULL)
+                return NULL;
+
+            created->Size = blockSize;
+            created->Next = block;
+
+            if (previous != NULL)
+                previous->Next = created;
+            else
+                arena->First = created;
+
+            block = created;
+            arena->NumBlocks++;
+        }
+
+        block->Used = 0;
+        arena->Current = block;
+    }
+
+    void *memory = (char*)block + ARENA_HEADER_SIZE + block->Used;
+    block->Used += size;
+
+    return memory;
+}
+
+ArenaMark Arena_Mark(const Arena *arena)
+{
+    ArenaMark mark = { arena->Current, (arena->Current != NULL) ? arena->Current->Used : 0 };
+    return mark;
+}
+
+void Arena_Release(Arena *arena, ArenaMark mark)
+{
+    arena->Current = mark.Block; // NULL starts over from the first block
+
+    if (mark.Block != NULL)
+        mark.Block->Used = mark.Used;
+}
+
+void Arena_Destroy(Arena *arena)
+{
+    while (arena->First != NULL)
+    {
+        ArenaBlock *next = arena->First->Next;
+        free(arena->First);
+        arena->First = next;
+    }
+
+    arena->Current = NULL;
+}
+
+// SCRATCH
+// =================================================================
+
+static pthread_key_t scratchKey;
+static pthread_once_t scratchKeyReady = PTHREAD_ONCE_INIT;
+
+static void Arena_FreeScratch(void *scratch) // when its thread ends
+{
+    Arena_Destroy((Arena*)scratch);
+    free(scratch);
+}
+
+static void Arena_CreateScratchKey(void)
+{
+    pthread_key_create(&scratchKey, Arena_FreeScratch);
+}
+
+Arena* Arena_Scratch(void)
+{
+    pthread_once(&scratchKeyReady, Arena_CreateScratchKey);
+
+    Arena *scratch = (Arena*)pthread_getspecific(scratchKey);
+
+    if (scratch == NULL) // the first time on this thread
+    {
+        static _Thread_local Arena fallback; // not freed with the thread, but still its own
+        scratch = (Arena*)calloc(1, sizeof(Arena));
+
+        if (scratch == NULL || pthread_setspecific(scratchKey, scratch) != 0)
+        {
+            free(scratch);
+            return &fallback;
+        }
+    }
+
+    return scratch;
+}
@@ -0,0 +1,57 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// A bump allocator for memory that is only needed while a dialog or a frame is on: take a mark, allocate, release to the mark
+// The blocks are kept when released, so once the first dialogs have warmed it up, opening them again allocates nothing
+// Each thread has a scratch arena of its own (Arena_Scratch): nothing is shared and no lock is taken, and the big buffers stay off the stack
+
+#define ARENA_BLOCK_SIZE    65536   // bigger requests get a block of their own size
+#define ARENA_ALIGNMENT     16
+
+typedef struct _ArenaBlock
+{
+    struct _ArenaBlock *Next;
+    size_t Size;            // usable bytes, after the header
+    size_t Used;
+} ArenaBlock;
+
+typedef struct _Arena
+{
+    ArenaBlock *First;
+    ArenaBlock *Current;    // the one being filled ... the blocks after it are free
+    uint32_t NumBlocks;     // ever allocated (so the steady state can be checked)
+} Arena;
+
+typedef struct _ArenaMark
+{
+    ArenaBlock *Block;
+    size_t Used;
+} ArenaMark;
+
+void* Arena_Alloc(Arena *arena, size_t size); // aligned to ARENA_ALIGNMENT ... returns NULL if out of memory
+ArenaMark Arena_Mark(const Arena *arena);
+void Arena_Release(Arena *arena, ArenaMark mark); // gives back everything allocated since the mark (in the reverse order of the marks)
+void Arena_Destroy(Arena *arena); // frees the blocks
+
+Arena* Arena_Scratch(void); // of the calling thread, freed when the thread ends
+
+#endif // _ARENA_H_
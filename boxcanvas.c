@@ -16,15 +16,24 @@
 // ===================================================================================  //
 
 #include "boxcanvas.h"
+#include "terminalsize.h"
+#include "threadpool.h"
+#include "outputsink.h"
+#include "renderstats.h"
+#include "port_clock.h"
+#include "canvasmirror.h"
+#include "arena.h"
+#include "braillepanel.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
 
-void BoxCanvas_Create(BoxCanvas *canvas, uint8_t X, uint8_t Y, uint8_t W, uint8_t H)
+static void BoxCanvas_Init(BoxCanvas *canvas, uint8_t X, uint8_t Y, uint8_t W, uint8_t H, Arena *arena) // the row pointers and the cells in a single block
 {
     uint8_t WidthColumns, HeightRows;
 
     if (W == 0 || H == 0)
-        Terminal_GetSize(&WidthColumns, &HeightRows);
+        TerminalSize_Get(&WidthColumns, &HeightRows);
 
     canvas->Top = Y;
     canvas->Left = X;
@@ -32,32 +41,130 @@ void BoxCanvas_Create(BoxCanvas *canvas, uint8_t X, uint8_t Y, uint8_t W, uint8_
     canvas->Height = (H == 0) ? HeightRows : H;
     canvas->BackgroundStyle = CONSOLE_STYLE_BACKGROUND_GREY;
     canvas->FillStyle = CONSOLE_STYLE_TEXT_WHITE;
+    canvas->Mirror = NULL;
+    canvas->Braille = NULL;
+    canvas->Scratch = (arena != NULL);
 
-    canvas->BlockBuffer = (uint8_t**)malloc(canvas->Height * sizeof(uint8_t*));
-    for (size_t row = 0; row < canvas->Height; row++)
+    size_t pointersSize = canvas->Height * sizeof(uint8_t*);
+    size_t cellsSize = (size_t)canvas->Width * canvas->Height * sizeof(uint8_t);
+    char *block = (arena != NULL) ? (char*)Arena_Alloc(arena, pointersSize + cellsSize) : (char*)malloc(pointersSize + cellsSize);
+
+    canvas->BlockBuffer = (uint8_t**)block;
+    if (block == NULL) // an empty canvas: nothing is drawn, and destroying it is still fine
     {
-        canvas->BlockBuffer[row] = (uint8_t*)malloc(canvas->Width * sizeof(uint8_t));
-        memset(canvas->BlockBuffer[row], 0, canvas->Width * sizeof(uint8_t));
+        canvas->Width = 0;
+        canvas->Height = 0;
+        return;
     }
+
+    memset(block + pointersSize, 0, cellsSize);
+
+    for (size_t row = 0; row < canvas->Height; row++)
+        canvas->BlockBuffer[row] = (uint8_t*)(block + pointersSize) + row * canvas->Width;
+}
+
+void BoxCanvas_Create(BoxCanvas *canvas, uint8_t X, uint8_t Y, uint8_t W, uint8_t H)
+{
+    BoxCanvas_Init(canvas, X, Y, W, H, NULL);
+}
+
+void BoxCanvas_CreateScratch(BoxCanvas *canvas, uint8_t X, uint8_t Y, uint8_t W, uint8_t H)
+{
+    BoxCanvas_Init(canvas, X, Y, W, H, Arena_Scratch());
 }
 
 void BoxCanvas_Destroy(BoxCanvas *canvas)
 {
-    for (size_t row = 0; row < canvas->Height; row++)
-        free((uint8_t *)canvas->BlockBuffer[row]); // free columns memory
+    if (!canvas->Scratch) // scratch canvases go with the arena
+        free(canvas->BlockBuffer);
 
-    free((uint8_t **)canvas->BlockBuffer); // free rows memory
+    canvas->BlockBuffer = NULL;
+}
+
+void BoxCanvas_Resize(BoxCanvas *canvas, uint8_t W, uint8_t H)
+{
+    BoxCanvas resized;
+    BoxCanvas_Create(&resized, canvas->Left, canvas->Top, W, H);
+    resized.FillStyle = canvas->FillStyle;
+    resized.BackgroundStyle = canvas->BackgroundStyle;
+    resized.Mirror = canvas->Mirror;
+    resized.Braille = canvas->Braille; // clipped to the new size when they are encoded
+
+    for (size_t row = 0; row < min(canvas->Height, resized.Height); row++) // keep what was drawn, clipped to the new size
+        memcpy(resized.BlockBuffer[row], canvas->BlockBuffer[row], min(canvas->Width, resized.Width) * sizeof(uint8_t));
+
+    BoxCanvas_Destroy(canvas);
+    *canvas = resized;
+}
+
+static void BoxCanvas_GetMixedCharacter(uint8_t boxcode, uint8_t *boxascii, uint32_t* boxunicode) // junctions of double and single lines
+{
+    uint8_t boxstrong = boxcode & BOX_FLAG_STRONG; // horizontal lines are double, vertical lines are single
+
+    switch (boxcode & BOX_MASK_BORDER)
+    {
+        case BOX_FLAG_UP | BOX_FLAG_DOWN | BOX_FLAG_LEFT | BOX_FLAG_RIGHT: // cross line +
+            *boxascii = (boxstrong) ? 216 : 215;
+            *boxunicode  = (boxstrong) ?  0x256A : 0x256B ;
+            break;
+
+        case BOX_FLAG_UP | BOX_FLAG_LEFT:  // _|
+            *boxascii = (boxstrong) ? 190 : 189;
+            *boxunicode  = (boxstrong) ?  0x255B : 0x255C ;
+            break;
+
+        case BOX_FLAG_UP | BOX_FLAG_RIGHT: // |_
+            *boxascii = (boxstrong) ? 212 : 211;
+            *boxunicode  = (boxstrong) ?  0x2558 : 0x2559 ;
+            break;
+
+        case BOX_FLAG_DOWN | BOX_FLAG_LEFT: // |
+            *boxascii = (boxstrong) ? 184 : 183;
+            *boxunicode  = (boxstrong) ?  0x2555 : 0x2556 ;
+            break;
+
+        case BOX_FLAG_DOWN | BOX_FLAG_RIGHT: // |
+            *boxascii = (boxstrong) ? 213 : 214;
+            *boxunicode  = (boxstrong) ?  0x2552 : 0x2553 ;
+            break;
+
+        case BOX_FLAG_UP | BOX_FLAG_LEFT | BOX_FLAG_RIGHT: // _|_
+            *boxascii = (boxstrong) ? 207 : 208;
+            *boxunicode  = (boxstrong) ?  0x2567 : 0x2568 ;
+            break;
+
+        case BOX_FLAG_DOWN | BOX_FLAG_LEFT | BOX_FLAG_RIGHT: // |
+            *boxascii = (boxstrong) ? 209 : 210;
+            *boxunicode  = (boxstrong) ?  0x2564 : 0x2565 ;
+            break;
+
+        case BOX_FLAG_UP | BOX_FLAG_DOWN | BOX_FLAG_LEFT: // -|
+            *boxascii = (boxstrong) ? 181 : 182;
+            *boxunicode  = (boxstrong) ?  0x2561 : 0x2562 ;
+            break;
+
+        case BOX_FLAG_UP | BOX_FLAG_DOWN | BOX_FLAG_RIGHT: // |-
+        default:
+            *boxascii = (boxstrong) ? 198 : 199;
+            *boxunicode  = (boxstrong) ?  0x255E : 0x255F ;
+            break;
+    }
 }
 
 void BoxCanvas_GetCharacter(uint8_t boxcode, uint8_t *boxascii, uint32_t* boxunicode)
 {
     uint8_t boxstrong = boxcode & BOX_FLAG_STRONG;
 
+    if ((boxcode & BOX_FLAG_MIXED) && !(boxcode & BOX_MASK_HORIZONTAL))
+        boxstrong = !boxstrong; // only vertical lines, and they have the other weight
+
     if (boxcode == 0) // no code ...
     {
         *boxascii = ' '; // ... no box
         *boxunicode = ' ';
     }
+    else if ((boxcode & BOX_FLAG_MIXED) && (boxcode & BOX_MASK_HORIZONTAL) && (boxcode & BOX_MASK_VERTICAL) && !(boxcode & BOX_FLAG_FILL))
+        BoxCanvas_GetMixedCharacter(boxcode, boxascii, boxunicode);
     else if (boxcode & BOX_FLAG_FILL)
     {
         *boxascii = 219; // full painted box
@@ -139,46 +246,385 @@ void BoxCanvas_GetCharacter(uint8_t boxcode, uint8_t *boxascii, uint32_t* boxuni
     }
 }
 
+static char glyphBytes[2][256][5];     // [use_utf8][box code] -> text to print
+static uint8_t glyphLength[2][256];
+static pthread_once_t glyphsReady = PTHREAD_ONCE_INIT; // the bands and the sessions may encode on several threads at once
+
+static void BoxCanvas_PrepareGlyphs(void) // looking the characters up once is much cheaper than decoding the flags of every cell
+{
+    for (uint16_t code = 0; code < 256; code++)
+    {
+        uint8_t ascii;
+        uint32_t unicode;
+
+        BoxCanvas_GetCharacter(code, &ascii, &unicode);
+
+        glyphBytes[0][code][0] = ascii;
+        glyphLength[0][code] = 1;
+
+        utf8_encode(glyphBytes[1][code], unicode);
+        glyphLength[1][code] = strlen(glyphBytes[1][code]);
+    }
+}
+
+static char* BoxCanvas_EncodeNumber(char *out, uint16_t number)
+{
+    char digits[5];
+    uint8_t count = 0;
+
+    do {
+        digits[count++] = '0' + number % 10;
+        number /= 10;
+    } while (number > 0);
+
+    while (count > 0)
+        *out++ = digits[--count];
+
+    return out;
+}
+
+static char* BoxCanvas_EncodeCursor(char *out, const BoxCanvas *canvas, uint8_t row, uint8_t col) // same place Terminal_SetCursorPosition(Left + col, Top + row) goes to
+{
+    *out++ = '\x1b';
+    *out++ = '[';
+    out = BoxCanvas_EncodeNumber(out, canvas->Top + row + 1);
+    *out++ = ';';
+    out = BoxCanvas_EncodeNumber(out, canvas->Left + col + 1);
+    *out++ = 'H';
+
+    return out;
+}
+
+static const BraillePanel* BoxCanvas_BrailleAt(const BoxCanvas *canvas, uint8_t row, uint8_t col) // the topmost panel over the cell, or NULL
+{
+    for (const BraillePanel *panel = canvas->Braille; panel != NULL; panel = panel->Next)
+        if (row >= panel->Y && row - panel->Y < panel->H && col >= panel->X && col - panel->X < panel->W)
+            return panel;
+
+    return NULL;
+}
+
+size_t BoxCanvas_EncodeRows(const BoxCanvas *canvas, uint8_t firstRow, uint8_t numRows, uint8_t use_utf8, uint8_t with_cursor, char *out)
+{
+    pthread_once(&glyphsReady, BoxCanvas_PrepareGlyphs);
+
+    char *start = out;
+    use_utf8 = use_utf8 ? 1 : 0;
+
+    for (uint16_t row = firstRow; row < firstRow + numRows; row++)
+    {
+        if (with_cursor)
+            out = BoxCanvas_EncodeCursor(out, canvas, row, 0);
+
+        const uint8_t *codes = canvas->BlockBuffer[row];
+
+        if (canvas->Braille != NULL) // the plots are encoded in the same pass as the boxes around them
+        {
+            for (uint16_t col = 0; col < canvas->Width; col++)
+            {
+                const BraillePanel *panel = BoxCanvas_BrailleAt(canvas, row, col);
+
+                if (panel != NULL)
+                    out += BraillePanel_Glyph(panel->Dots[(size_t)(row - panel->Y) * panel->W + (col - panel->X)], use_utf8, out);
+                else
+                {
+                    memcpy(out, glyphBytes[use_utf8][codes[col]], 4);
+                    out += glyphLength[use_utf8][codes[col]];
+                }
+            }
+
+            continue;
+        }
+
+        for (uint16_t col = 0; col < canvas->Width; col++)
+        {
+            memcpy(out, glyphBytes[use_utf8][codes[col]], 4);
+            out += glyphLength[use_utf8][codes[col]];
+        }
+    }
+
+    return out - start;
+}
+
+#if defined(unix) || defined(__unix__) || defined(__unix)
+
+struct encodeBand
+{
+    const BoxCanvas *Canvas;
+    char *Buffer;
+    uint8_t NumBands;
+    struct iovec *Segments;
+};
+
+static void BoxCanvas_EncodeBand(void *argument, uint8_t band)
+{
+    struct encodeBand *work = (struct encodeBand*)argument;
+
+    // bands are contiguous, in order, and each one writes to its own part of the buffer
+    uint8_t firstRow = (uint16_t)work->Canvas->Height * band / work->NumBands;
+    uint8_t lastRow = (uint16_t)work->Canvas->Height * (band + 1) / work->NumBands;
+    char *out = work->Buffer + (size_t)firstRow * BOX_CANVAS_ROW_BYTES(work->Canvas->Width);
+
+    work->Segments[band].iov_base = out;
+    work->Segments[band].iov_len = BoxCanvas_EncodeRows(work->Canvas, firstRow, lastRow - firstRow, 1, 1, out);
+}
+
+static uint8_t BoxCanvas_RenderParallel(BoxCanvas *canvas)
+{
+    uint8_t numBands = min(ThreadPool_Size(), canvas->Height);
+    if (numBands < 2)
+        return 0;
+
+    pthread_once(&glyphsReady, BoxCanvas_PrepareGlyphs); // built here, before the bands go out: the workers only ever read the table
+
+    struct iovec segments[THREAD_POOL_MAX_THREADS];
+    struct encodeBand work = { .Canvas = canvas, .NumBands = numBands, .Segments = segments };
+
+    Arena *scratch = Arena_Scratch();
+    ArenaMark mark = Arena_Mark(scratch);
+
+    work.Buffer = (char*)Arena_Alloc(scratch, (size_t)canvas->Height * BOX_CANVAS_ROW_BYTES(canvas->Width));
+    if (work.Buffer == NULL)
+        return 0;
+
+    uint64_t start = Clock_GetMicroseconds();
+    ThreadPool_Run(BoxCanvas_EncodeBand, &work, numBands);
+    RenderStats_Count(RENDER_COUNTER_ENCODE_TIME, Clock_GetMicroseconds() - start);
+
+    fflush(stdout); // what was printed before the canvas must reach the terminal before it
+    OutputSink_WriteVector(segments, numBands);
+
+    Arena_Release(scratch, mark);
+    return 1;
+}
+
+#endif
+
+static void BoxCanvas_BrailleShown(BoxCanvas *canvas) // the whole canvas was rendered, panels and all
+{
+    for (BraillePanel *panel = canvas->Braille; panel != NULL; panel = panel->Next)
+    {
+        memcpy(panel->Shown, panel->Dots, (size_t)panel->W * panel->H);
+        panel->ShownValid = 1;
+    }
+}
+
 void BoxCanvas_Render(BoxCanvas *canvas)
 {
+    RenderStats_Count(RENDER_COUNTER_CELLS, (uint32_t)canvas->Width * canvas->Height);
+
+    if (canvas->Mirror != NULL) // the viewers get the frame at the same time as the terminal
+        CanvasMirror_Publish(canvas->Mirror, canvas);
+
     Terminal_SaveCursorPosition(); // let's save the current state before we do anything
 
-    Terminal_SetStyle(canvas->FillStyle, canvas->BackgroundStyle); // set the style
-    Terminal_ClearArea(canvas->Left, canvas->Top, canvas->Width, canvas->Height);
+    Terminal_SetStyle(canvas->FillStyle, canvas->BackgroundStyle); // set the style - every cell of the area is printed, so there's no need to clear it first
 
     #if (defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN32__))
         uint8_t use_utf8 = (GetConsoleOutputCP() == CP_UTF8);
+        uint8_t with_cursor = 0; // the console is positioned by the API, not by escape sequences
     #else
         uint8_t use_utf8 = 1; // always use utf-8 under UNIX
+        uint8_t with_cursor = 1;
+
+        if ((uint16_t)canvas->Width * canvas->Height >= BOX_CANVAS_PARALLEL_CELLS && BoxCanvas_RenderParallel(canvas)) // big canvases are encoded in bands by the thread pool
+        {
+            BoxCanvas_BrailleShown(canvas);
+            Terminal_RestoreCursorSavedPosition();
+            return;
+        }
     #endif
 
-    char print_line_buffer[canvas->Width*5];
-    for (int16_t row = 0; row < canvas->Height; row++) // iterate over the rows and print along the lines (natural printing left to right)
+    Arena *scratch = Arena_Scratch();
+    ArenaMark mark = Arena_Mark(scratch);
+
+    char *print_line_buffer = (char*)Arena_Alloc(scratch, BOX_CANVAS_ROW_BYTES(canvas->Width)); // not on the stack, which may be small on other threads
+    if (print_line_buffer == NULL)
+    {
+        Terminal_RestoreCursorSavedPosition();
+        return;
+    }
+
+    for (uint8_t row = 0; row < canvas->Height; row++) // iterate over the rows and print along the lines (natural printing left to right)
     {
-        memset(print_line_buffer, 0, sizeof(print_line_buffer)); // erase garbage from previous iteration with '\0'
-        for (int16_t col = 0; col < canvas->Width; col++)
+        if (!with_cursor)
+            Terminal_SetCursorPosition(canvas->Left, canvas->Top + row);
+
+        uint64_t start = Clock_GetMicroseconds();
+        size_t length = BoxCanvas_EncodeRows(canvas, row, 1, use_utf8, with_cursor, print_line_buffer);
+        RenderStats_Count(RENDER_COUNTER_ENCODE_TIME, Clock_GetMicroseconds() - start);
+
+        OutputSink_Print(print_line_buffer, length);
+    }
+
+    BoxCanvas_BrailleShown(canvas);
+    Arena_Release(scratch, mark);
+    Terminal_RestoreCursorSavedPosition();
+}
+
+void BoxCanvas_AddBraille(BoxCanvas *canvas, BraillePanel *panel)
+{
+    panel->Next = canvas->Braille;
+    panel->ShownValid = 0; // the terminal does not have it yet
+    canvas->Braille = panel;
+}
+
+void BoxCanvas_RemoveBraille(BoxCanvas *canvas, BraillePanel *panel)
+{
+    for (BraillePanel **link = &canvas->Braille; *link != NULL; link = &(*link)->Next)
+    {
+        if (*link == panel)
         {
-            uint8_t ascii;
-            uint32_t unicode;
-            char utf8[5];
+            *link = panel->Next;
+            panel->Next = NULL;
+            break;
+        }
+    }
+
+    for (BraillePanel *below = canvas->Braille; below != NULL; below = below->Next)
+        below->ShownValid = 0; // the parts it covered are sent again by the next BoxCanvas_RenderBraille
+}
+
+void BoxCanvas_RenderBraille(BoxCanvas *canvas)
+{
+    if (canvas->Braille == NULL)
+        return;
+
+    #if (defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN32__))
+        uint8_t use_utf8 = (GetConsoleOutputCP() == CP_UTF8);
+        uint8_t with_cursor = 0;
+    #else
+        uint8_t use_utf8 = 1;
+        uint8_t with_cursor = 1;
+    #endif
+
+    Arena *scratch = Arena_Scratch();
+    ArenaMark mark = Arena_Mark(scratch);
+
+    char *buffer = (char*)Arena_Alloc(scratch, (size_t)canvas->Width * 8 + 12); // the runs of a row: up to 3 bytes per cell, and a cursor movement for every 3 cells at most
+    if (buffer == NULL)
+        return;
 
-            BoxCanvas_GetCharacter(canvas->BlockBuffer[row][col], &ascii, &unicode);
+    uint8_t started = 0;
+    uint32_t cells = 0;
+    uint64_t start = Clock_GetMicroseconds();
 
-            if (use_utf8)
+    for (BraillePanel *panel = canvas->Braille; panel != NULL; panel = panel->Next)
+    {
+        uint8_t rows = (panel->Y < canvas->Height) ? min(panel->H, canvas->Height - panel->Y) : 0; // clipped to the canvas
+        uint8_t cols = (panel->X < canvas->Width) ? min(panel->W, canvas->Width - panel->X) : 0;
+
+        for (uint8_t row = 0; row < rows; row++)
+        {
+            const uint8_t *dots = &panel->Dots[(size_t)row * panel->W];
+            uint8_t *shown = &panel->Shown[(size_t)row * panel->W];
+            char *out = buffer;
+            int16_t runEnd = -1; // one past the last cell written on this row (-1 = none)
+
+            for (uint8_t col = 0; col < cols; col++)
             {
-                utf8_encode(utf8, unicode);
-                strcat(print_line_buffer, utf8);
+                if (panel->ShownValid && dots[col] == shown[col])
+                    continue;
+
+                if (BoxCanvas_BrailleAt(canvas, panel->Y + row, panel->X + col) != panel)
+                    continue; // a panel added later is over it
+
+                if (!started) // nothing is sent when nothing changed
+                {
+                    Terminal_SaveCursorPosition();
+                    Terminal_SetStyle(canvas->FillStyle, canvas->BackgroundStyle);
+                    started = 1;
+                }
+
+                uint8_t join = (runEnd >= 0 && col - runEnd <= BRAILLE_PANEL_RUN_GAP); // the cells in between are sent again instead of moving the cursor
+                for (int16_t gap = runEnd; join && gap < col; gap++)
+                    join = (BoxCanvas_BrailleAt(canvas, panel->Y + row, panel->X + gap) == panel);
+
+                if (!join)
+                {
+                    if (with_cursor)
+                        out = BoxCanvas_EncodeCursor(out, canvas, panel->Y + row, panel->X + col);
+                    else
+                    {
+                        OutputSink_Print(buffer, out - buffer);
+                        out = buffer;
+                        Terminal_SetCursorPosition(canvas->Left + panel->X + col, canvas->Top + panel->Y + row);
+                    }
+
+                    runEnd = col;
+                }
+
+                for (; runEnd <= col; runEnd++, cells++)
+                {
+                    out += BraillePanel_Glyph(dots[runEnd], use_utf8, out);
+                    shown[runEnd] = dots[runEnd];
+                }
             }
-            else
-                print_line_buffer[strlen(print_line_buffer)] = ascii;
+
+            OutputSink_Print(buffer, out - buffer);
         }
 
-        Terminal_SetCursorPosition(canvas->Left, canvas->Top + row);
-        fwrite(print_line_buffer, sizeof(char)*strlen(print_line_buffer), 1, stdout);
-        //printf("%s", print_line_buffer);
+        panel->ShownValid = 1;
     }
 
-    Terminal_RestoreCursorSavedPosition();
+    RenderStats_Count(RENDER_COUNTER_CELLS, cells);
+    RenderStats_Count(RENDER_COUNTER_ENCODE_TIME, Clock_GetMicroseconds() - start);
+
+    Arena_Release(scratch, mark);
+
+    if (started)
+        Terminal_RestoreCursorSavedPosition();
+}
+
+uint8_t BoxCanvas_BoxCode(uint32_t X, uint32_t Y, uint32_t maxX, uint32_t maxY, uint32_t currX, uint32_t currY, BoxDrawStyle style)
+{
+    uint8_t code = 0;
+
+    if (currX == X && currY == Y) // top left corner
+        code |= BOX_FLAG_DOWN | BOX_FLAG_RIGHT;
+    else if (currX == maxX-1 && currY == Y) // top right corner
+        code |= BOX_FLAG_DOWN | BOX_FLAG_LEFT;
+    else if (currX == X && currY == maxY-1) // bottom left corner
+        code |= BOX_FLAG_UP | BOX_FLAG_RIGHT;
+    else if (currX == maxX-1 && currY == maxY-1) // bottom right corner
+        code |= BOX_FLAG_UP | BOX_FLAG_LEFT;
+    else if (currX == maxX || currY == maxY) // shadow
+    {
+        if ((currX > X + 2) && (currY > Y + 1))
+            code |= BOX_FLAG_DOTTED;
+    }
+    else if (currX == X || currX == maxX-1) // left or right side
+        code |= BOX_FLAG_UP | BOX_FLAG_DOWN;
+    else if (currY == Y || currY == maxY-1) // top or bottom
+        code |= BOX_FLAG_LEFT | BOX_FLAG_RIGHT;
+    else (void)0; // interior
+
+    if (code != 0 && (style & BOX_STYLE_STRONG)) code |= BOX_FLAG_STRONG;
+
+    return code;
+}
+
+static uint8_t BoxCanvas_JunctionCode(uint8_t borders, uint8_t horizontalStrong, uint8_t verticalStrong)
+{
+    if (!(borders & BOX_MASK_HORIZONTAL))
+        return borders | (verticalStrong ? BOX_FLAG_STRONG : 0);
+
+    if (!(borders & BOX_MASK_VERTICAL))
+        return borders | (horizontalStrong ? BOX_FLAG_STRONG : 0);
+
+    return borders | (horizontalStrong ? BOX_FLAG_STRONG : 0) | ((!horizontalStrong != !verticalStrong) ? BOX_FLAG_MIXED : 0);
+}
+
+uint8_t BoxCanvas_MergeCode(uint8_t code, uint8_t added)
+{
+    if (!(code & BOX_MASK_BORDER) || !(added & BOX_MASK_BORDER))
+        return code | added; // fills and shadows just pile up
+
+    // a line is strong if either code draws it strong
+    uint8_t horizontalStrong = ((code & BOX_MASK_HORIZONTAL) && (code & BOX_FLAG_STRONG)) || ((added & BOX_MASK_HORIZONTAL) && (added & BOX_FLAG_STRONG));
+    uint8_t verticalStrong = ((code & BOX_MASK_VERTICAL) && !(code & BOX_FLAG_STRONG) != !(code & BOX_FLAG_MIXED)) || ((added & BOX_MASK_VERTICAL) && !(added & BOX_FLAG_STRONG) != !(added & BOX_FLAG_MIXED));
+
+    return BoxCanvas_JunctionCode((code | added) & BOX_MASK_BORDER, horizontalStrong, verticalStrong) | ((code | added) & (BOX_FLAG_DOTTED | BOX_FLAG_FILL));
 }
 
 void BoxCanvas_Box(BoxCanvas *canvas, uint8_t X, uint8_t Y, uint8_t W, uint8_t H, BoxDrawStyle style)
@@ -188,39 +634,101 @@ void BoxCanvas_Box(BoxCanvas *canvas, uint8_t X, uint8_t Y, uint8_t W, uint8_t H
 
     uint8_t shadow = style & BOX_STYLE_SHADOW;
     uint8_t fill = style & BOX_STYLE_FILL;
-    uint8_t strong = style & BOX_STYLE_STRONG;
 
     for (uint8_t currX = X; currX < maxX + (shadow && maxX < canvas->Width) ? 1 : 0; currX++)
     {
         for (uint8_t currY = Y; currY < maxY + (shadow && maxY < canvas->Height); currY++)
+        {
+            uint8_t code = BoxCanvas_BoxCode(X, Y, maxX, maxY, currX, currY, style);
+
+            if (fill)
+                canvas->BlockBuffer[currY][currX] = code;
+            else
+                canvas->BlockBuffer[currY][currX] = BoxCanvas_MergeCode(canvas->BlockBuffer[currY][currX], code);
+        }
+    }
+}
+
+#define GRID_NO_LINE 0xFFFF
+
+void BoxCanvas_Grid(BoxCanvas *canvas, uint8_t X, uint8_t Y, uint8_t numCols, const uint8_t *colWidths, uint8_t numRows, const uint8_t *rowHeights, const BoxDrawStyle *colLines, const BoxDrawStyle *rowLines, BoxDrawStyle style)
+{
+    uint16_t lineAtX[256]; // which line crosses each column / row of the canvas, so every cell is worked out on its own in a single sweep
+    uint16_t lineAtY[256];
+
+    uint16_t W = 1, H = 1;
+    for (uint8_t col = 0; col < numCols; col++)
+        W += colWidths[col] + 1;
+    for (uint8_t row = 0; row < numRows; row++)
+        H += rowHeights[row] + 1;
+
+    uint16_t maxX = min(X + W, canvas->Width);
+    uint16_t maxY = min(Y + H, canvas->Height);
+    if (X >= maxX || Y >= maxY)
+        return;
+
+    uint8_t shadow = style & BOX_STYLE_SHADOW;
+    uint8_t fill = style & BOX_STYLE_FILL;
+
+    for (uint16_t currX = X; currX < maxX; currX++)
+        lineAtX[currX - X] = GRID_NO_LINE;
+    for (uint16_t currY = Y; currY < maxY; currY++)
+        lineAtY[currY - Y] = GRID_NO_LINE;
+
+    for (uint16_t line = 0, currX = X; line <= numCols && currX < maxX; currX += colWidths[line++] + 1)
+    {
+        lineAtX[currX - X] = line;
+        if (line == numCols)
+            break;
+    }
+
+    for (uint16_t line = 0, currY = Y; line <= numRows && currY < maxY; currY += rowHeights[line++] + 1)
+    {
+        lineAtY[currY - Y] = line;
+        if (line == numRows)
+            break;
+    }
+
+    uint16_t shadowX = (shadow && X + W < canvas->Width) ? X + W : GRID_NO_LINE; // like a box, the shadow is only drawn if it fits
+    uint16_t shadowY = (shadow && Y + H < canvas->Height) ? Y + H : GRID_NO_LINE;
+
+    for (uint16_t currY = Y; currY < maxY + (shadowY != GRID_NO_LINE); currY++)
+    {
+        uint8_t *cells = canvas->BlockBuffer[currY];
+        uint16_t horizontalLine = (currY < maxY) ? lineAtY[currY - Y] : GRID_NO_LINE;
+        uint8_t horizontalStrong = (horizontalLine == GRID_NO_LINE) ? 0 : (rowLines ? rowLines[horizontalLine] : style) & BOX_STYLE_STRONG;
+
+        for (uint16_t currX = X; currX < maxX + (shadowX != GRID_NO_LINE); currX++)
         {
             uint8_t code = 0;
 
-            if (currX == X && currY == Y) // top left corner
-                code |= BOX_FLAG_DOWN | BOX_FLAG_RIGHT;
-            else if (currX == maxX-1 && currY == Y) // top right corner
-                code |= BOX_FLAG_DOWN | BOX_FLAG_LEFT;
-            else if (currX == X && currY == maxY-1) // bottom left corner
-                code |= BOX_FLAG_UP | BOX_FLAG_RIGHT;
-            else if (currX == maxX-1 && currY == maxY-1) // bottom right corner
-                code |= BOX_FLAG_UP | BOX_FLAG_LEFT;
-            else if (currX == maxX || currY == maxY) // shadow
+            if (currX == shadowX || currY == shadowY)
             {
                 if ((currX > X + 2) && (currY > Y + 1))
-                    code |= BOX_FLAG_DOTTED;
+                    code = BOX_FLAG_DOTTED | (style & BOX_STYLE_STRONG);
             }
-            else if (currX == X || currX == maxX-1) // left or right side
-                code |= BOX_FLAG_UP | BOX_FLAG_DOWN;
-            else if (currY == Y || currY == maxY-1) // top or bottom
-                code |= BOX_FLAG_LEFT | BOX_FLAG_RIGHT;
-            else (void)0; // interior
+            else
+            {
+                uint16_t verticalLine = lineAtX[currX - X];
+                uint8_t borders = 0;
+
+                if (verticalLine != GRID_NO_LINE)
+                    borders |= ((currY > Y) ? BOX_FLAG_UP : 0) | ((currY < Y + H - 1) ? BOX_FLAG_DOWN : 0);
 
-            if (code != 0 && strong) code |= BOX_FLAG_STRONG;
+                if (horizontalLine != GRID_NO_LINE)
+                    borders |= ((currX > X) ? BOX_FLAG_LEFT : 0) | ((currX < X + W - 1) ? BOX_FLAG_RIGHT : 0);
+
+                if (borders)
+                {
+                    uint8_t verticalStrong = (verticalLine == GRID_NO_LINE) ? 0 : (colLines ? colLines[verticalLine] : style) & BOX_STYLE_STRONG;
+                    code = BoxCanvas_JunctionCode(borders, horizontalStrong, verticalStrong);
+                }
+            }
 
             if (fill)
-                canvas->BlockBuffer[currY][currX] = code;
+                cells[currX] = code;
             else
-                canvas->BlockBuffer[currY][currX] |= code;
+                cells[currX] = BoxCanvas_MergeCode(cells[currX], code);
         }
     }
 }
@@ -18,9 +18,10 @@
 #define _BOX_CANVAS_H_
 
 #include <stdint.h>
+#include <stddef.h>
 #include "../BrailleCanvas/BrailleCanvas/terminal.h" // -- get this file (and the matching .c file too) in the repo "BrailleCanvas" at: https://github.com/luizfeldmann/BrailleCanvas
 
-// box flags <UP> <DOWN> <LEFT> <RIGHT> <?> <STRONG> <DOTTED> <FILL>
+// box flags <UP> <DOWN> <LEFT> <RIGHT> <MIXED> <STRONG> <DOTTED> <FILL>
 #define BOX_FLAG_UP 0b10000000
 #define BOX_FLAG_DOWN 0b01000000
 #define BOX_FLAG_LEFT 0b00100000
@@ -28,7 +29,13 @@
 #define BOX_FLAG_FILL 0b00000001
 #define BOX_FLAG_DOTTED 0b00000010
 #define BOX_FLAG_STRONG 0b0000100
+#define BOX_FLAG_MIXED 0b00001000 // the vertical lines have the opposite weight of the horizontal ones (STRONG is the weight of the horizontal lines)
 #define BOX_MASK_BORDER 0b11110000
+#define BOX_MASK_VERTICAL 0b11000000
+#define BOX_MASK_HORIZONTAL 0b00110000
+
+#define BOX_CANVAS_PARALLEL_CELLS 8192 // canvases with at least this many cells are encoded in bands by the thread pool
+#define BOX_CANVAS_ROW_BYTES(width) ((size_t)(width)*4 + 12) // longest encoding of a row: up to 4 bytes per cell plus the cursor movement
 
 typedef enum { // <> <> <> <> <> <STRONG> <DOTTED/SHADOW> <FILL>
     BOX_STYLE_FILL = BOX_FLAG_FILL,
@@ -50,11 +57,24 @@ typedef struct _BoxCanvas
     ConsoleStyleBackground BackgroundStyle;
 
     uint8_t **BlockBuffer;
+
+    struct _CanvasMirror *Mirror; // the viewers each frame is published to, or NULL (see canvasmirror.h)
+    struct _BraillePanel *Braille; // the plots shown over the cells, or NULL (see braillepanel.h)
+    uint8_t Scratch;        // the cells are in the scratch arena of the thread (see arena.h)
 } BoxCanvas;
 
 void BoxCanvas_Create(BoxCanvas *canvas, uint8_t X, uint8_t Y, uint8_t W, uint8_t H);
+void BoxCanvas_CreateScratch(BoxCanvas *canvas, uint8_t X, uint8_t Y, uint8_t W, uint8_t H); // same, in the scratch arena of the thread: it lasts until the arena is released to a mark taken before
 void BoxCanvas_Destroy(BoxCanvas *canvas);
+void BoxCanvas_Resize(BoxCanvas *canvas, uint8_t W, uint8_t H); // 0 width or height means "fullscreen" (use it after FRAME_EVENT_RESIZE)
 void BoxCanvas_Render(BoxCanvas *canvas);
+void BoxCanvas_AddBraille(BoxCanvas *canvas, struct _BraillePanel *panel); // the panel is shown over its cells (on top of the panels added before) ... the caller keeps it, and removes it before destroying it
+void BoxCanvas_RemoveBraille(BoxCanvas *canvas, struct _BraillePanel *panel); // the box codes under it show again from the next BoxCanvas_Render
+void BoxCanvas_RenderBraille(BoxCanvas *canvas); // only the cells of the panels that changed since they were last rendered (the boxes and the rest must have been rendered before)
+size_t BoxCanvas_EncodeRows(const BoxCanvas *canvas, uint8_t firstRow, uint8_t numRows, uint8_t use_utf8, uint8_t with_cursor, char *out); // writes the text that renders the rows into out (BOX_CANVAS_ROW_BYTES each) and returns its length
 void BoxCanvas_Box(BoxCanvas *canvas, uint8_t X, uint8_t Y, uint8_t W, uint8_t H, BoxDrawStyle style);
+void BoxCanvas_Grid(BoxCanvas *canvas, uint8_t X, uint8_t Y, uint8_t numCols, const uint8_t *colWidths, uint8_t numRows, const uint8_t *rowHeights, const BoxDrawStyle *colLines, const BoxDrawStyle *rowLines, BoxDrawStyle style); // widths and heights are inside the lines; colLines (numCols+1) and rowLines (numRows+1) give the weight of each line, or NULL for the weight in style
+uint8_t BoxCanvas_MergeCode(uint8_t code, uint8_t added); // joins the lines of two codes, each one keeping its own weight
+uint8_t BoxCanvas_BoxCode(uint32_t X, uint32_t Y, uint32_t maxX, uint32_t maxY, uint32_t currX, uint32_t currY, BoxDrawStyle style); // the code of one cell of a box that spans X...maxX-1, Y...maxY-1 (the shadow is at maxX / maxY)
 
 #endif // _BOX_CANVAS_H_
@@ -0,0 +1,470 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+// A whiptail / dialog style front end to the dialogs, for shell scripts:
+//
+//      boxdialog [options] --msgbox   <text> <height> <width>
+//      boxdialog [options] --yesno    <text> <height> <width>
+//      boxdialog [options] --menu     <text> <height> <width> <menu height> [<tag> <item>] ...
+//      boxdialog [options] --rangebox <text> <height> <width> <min> <max> <default>
+//      boxdialog [options] --gauge    <text> <height> <width> <percent>        (then reads percents from stdin, and "XXX" blocks with a percent and a new text)
+//      boxdialog [options] --fselect  <path> <height> <width>
+//      boxdialog --sync-update                                                 (prints what to put in BOXCANVAS_SYNC_UPDATE)
+//
+//      options: --title <title> --backtitle <text> --default-item <tag> --defaultno --clear --output-fd <fd> --stdout --stderr
+//               --yes-button <text> --no-button <text> --ok-button <text> --cancel-button <text> --style grey|blue|red
+//
+// The heights and widths are accepted but not used: the dialogs size themselves, and wrap long texts ("\n" in a text starts a new line). The answer (tag, value or path) goes to stderr unless told otherwise.
+// Exit status: 0 OK / Yes, 1 No / Cancel, 255 ESC or an error.
+// Nothing touches the terminal before the arguments are checked, and with BOXCANVAS_SYNC_UPDATE set (see syncupdate.h) the terminal is not queried either,
+// so each run costs little more than starting the process.
+// With BOXCANVAS_RECORD set to a file, what the dialog drew and the keys it read are saved there as an asciicast on exit (and on SIGUSR1 while it's open).
+
+#include "terminaldialogbox.h"
+#include "terminalsize.h"
+#include "syncupdate.h"
+#include "textwidth.h"
+#include "framerecorder.h"
+#include "outputsink.h"          // the recording needs all of stdout
+#include "tinydir.h"            // get this file at https://github.com/cxong/tinydir
+#include "../BrailleCanvas/BrailleCanvas/terminal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(unix) || defined(__unix__) || defined(__unix)
+    #include <unistd.h>
+    #include <signal.h>
+    #include <fcntl.h>
+#elif (defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN32__))
+    #include <direct.h>
+    #define fdopen _fdopen
+    #define chdir _chdir
+    #define getcwd _getcwd
+#endif
+
+#define BOX_DIALOG_OK       0
+#define BOX_DIALOG_CANCEL   1
+#define BOX_DIALOG_ESC      255
+#define BOX_DIALOG_ERROR    255
+
+#define BOX_DIALOG_LINE_MAX 256     // of the gauge input
+
+typedef enum {
+    BOX_NONE,
+    BOX_MSGBOX,
+    BOX_YESNO,
+    BOX_MENU,
+    BOX_RANGEBOX,
+    BOX_GAUGE,
+    BOX_FSELECT,
+} BoxType;
+
+struct boxOptions
+{
+    BoxType Type;
+    const char *Title;
+    const char *DefaultItem;
+    uint8_t DefaultNo;
+    uint8_t Clear;
+    int OutputDescriptor;
+    const char *YesButton;
+    const char *NoButton;
+    const char *OkButton;
+    const char *CancelButton;   // after the items of a menu
+    DialogBoxStyle Style;
+    char **Arguments;   // of the box, after the text
+    int NumArguments;
+    const char *Text;
+};
+
+static const struct {
+    const char *Name;
+    BoxType Type;
+    int NumArguments;   // after the text, height and width (a menu has its pairs on top of these)
+} boxTypes[] = {
+    { "--msgbox",   BOX_MSGBOX,     0 },
+    { "--yesno",    BOX_YESNO,      0 },
+    { "--menu",     BOX_MENU,       1 },
+    { "--rangebox", BOX_RANGEBOX,   3 },
+    { "--gauge",    BOX_GAUGE,      1 },
+    { "--fselect",  BOX_FSELECT,    0 },
+};
+
+static int BoxDialog_Usage(void)
+{
+    fputs("usage: boxdialog [options] --msgbox|--yesno|--menu|--rangebox|--gauge|--fselect <text> <height> <width> [arguments]\n", stderr);
+    return BOX_DIALOG_ERROR;
+}
+
+static void BoxDialog_Unescape(char *text) // "\n" becomes a new line, as in whiptail
+{
+    char *out = text;
+
+    for (; *text != '\0'; text++)
+        if (text[0] == '\\' && text[1] == 'n')
+        {
+            *out++ = '\n';
+            text++;
+        }
+        else
+            *out++ = *text;
+
+    *out = '\0';
+}
+
+static uint8_t BoxDialog_Parse(struct boxOptions *options, int argc, char **argv) // returns 0 on bad arguments
+{
+    for (int arg = 1; arg < argc; arg++)
+    {
+        const char *name = argv[arg];
+        const char *value = (arg + 1 < argc) ? argv[arg + 1] : NULL;
+
+        for (size_t index = 0; index < sizeof(boxTypes) / sizeof(boxTypes[0]); index++)
+        {
+            if (strcmp(name, boxTypes[index].Name) != 0)
+                continue;
+
+            if (argc - arg - 1 < 3 + boxTypes[index].NumArguments) // the text, height and width come first
+                return 0;
+
+            options->Type = boxTypes[index].Type;
+            options->Text = argv[arg + 1];
+            if (options->Type != BOX_FSELECT) // not in a path
+                BoxDialog_Unescape(argv[arg + 1]);
+            options->Arguments = &argv[arg + 4];
+            options->NumArguments = argc - arg - 4;
+
+            return (options->Type == BOX_MENU) ? (options->NumArguments % 2 == 1) : (options->NumArguments == boxTypes[index].NumArguments);
+        }
+
+        if (strcmp(name, "--defaultno") == 0)
+            options->DefaultNo = 1;
+        else if (strcmp(name, "--clear") == 0)
+            options->Clear = 1;
+        else if (strcmp(name, "--stdout") == 0)
+            options->OutputDescriptor = 1;
+        else if (strcmp(name, "--stderr") == 0)
+            options->OutputDescriptor = 2;
+        else if (value == NULL) // the rest take a value
+            return 0;
+        else
+        {
+            if (strcmp(name, "--title") == 0)
+                options->Title = value;
+            else if (strcmp(name, "--default-item") == 0)
+                options->DefaultItem = value;
+            else if (strcmp(name, "--output-fd") == 0)
+                options->OutputDescriptor = atoi(value);
+            else if (strcmp(name, "--yes-button") == 0)
+                options->YesButton = value;
+            else if (strcmp(name, "--no-button") == 0)
+                options->NoButton = value;
+            else if (strcmp(name, "--cancel-button") == 0)
+                options->CancelButton = value;
+            else if (strcmp(name, "--ok-button") == 0)
+                options->OkButton = value;
+            else if (strcmp(name, "--style") == 0)
+                options->Style = (strcmp(value, "grey") == 0) ? DIALOG_BOX_STYLE_GREY : (strcmp(value, "red") == 0) ? DIALOG_BOX_STYLE_RED : DIALOG_BOX_STYLE_BLUE;
+            else if (strcmp(name, "--backtitle") != 0) // accepted, but there is no back title
+                return 0;
+
+            arg++;
+        }
+    }
+
+    return 0; // no box
+}
+
+static void BoxDialog_SeparateAnswer(struct boxOptions *options) // with --stdout the answer is captured by the script: the dialog is drawn on the terminal instead
+{
+    if (options->OutputDescriptor != 1)
+        return;
+
+    #if defined(unix) || defined(__unix__) || defined(__unix)
+        int terminal = open("/dev/tty", O_WRONLY);
+        if (terminal < 0)
+            return; // no terminal to draw on: both go to stdout, as before
+
+        int answer = dup(STDOUT_FILENO);
+        if (answer >= 0 && dup2(terminal, STDOUT_FILENO) >= 0)
+            options->OutputDescriptor = answer;
+        else if (answer >= 0)
+            close(answer);
+
+        close(terminal);
+    #endif
+}
+
+static void BoxDialog_Answer(const struct boxOptions *options, const char *answer) // like whiptail: no new line
+{
+    if (options->OutputDescriptor == 1 || options->OutputDescriptor == 2)
+    {
+        FILE *stream = (options->OutputDescriptor == 1) ? stdout : stderr;
+        fputs(answer, stream);
+        fflush(stream);
+        return;
+    }
+
+    FILE *stream = fdopen(options->OutputDescriptor, "w");
+    if (stream != NULL)
+    {
+        fputs(answer, stream);
+        fclose(stream);
+    }
+}
+
+// BOXES
+// =================================================================
+
+static int BoxDialog_Message(const struct boxOptions *options)
+{
+    if (options->Type == BOX_MSGBOX)
+        return (ShowChoiceBox(options->Title, options->Text, 1, (char*[]){(char*)options->OkButton}, options->Style) == MESSAGE_BOX_ESC) ? BOX_DIALOG_ESC : BOX_DIALOG_OK;
+
+    char *buttons[2] = { (char*)options->YesButton, (char*)options->NoButton };
+    uint8_t yes = 0;
+
+    if (options->DefaultNo) // the first option is the one selected
+    {
+        buttons[0] = (char*)options->NoButton;
+        buttons[1] = (char*)options->YesButton;
+        yes = 1;
+    }
+
+    uint8_t choice = ShowChoiceBox(options->Title, options->Text, 2, buttons, options->Style);
+
+    if (choice == MESSAGE_BOX_ESC)
+        return BOX_DIALOG_ESC;
+
+    return (choice == yes) ? BOX_DIALOG_OK : BOX_DIALOG_CANCEL;
+}
+
+static int BoxDialog_Menu(const struct boxOptions *options)
+{
+    uint32_t numItems = options->NumArguments / 2;
+    char **tags = &options->Arguments[1];
+    if (numItems == 0)
+        return BOX_DIALOG_ERROR;
+
+    size_t tagColumns = 0, itemColumns = 0;
+    uint32_t selection = 0;
+
+    for (uint32_t index = 0; index < numItems; index++)
+    {
+        tagColumns = max(tagColumns, TextWidth_String(tags[index * 2]));
+        itemColumns = max(itemColumns, TextWidth_String(tags[index * 2 + 1]));
+
+        if (options->DefaultItem != NULL && strcmp(tags[index * 2], options->DefaultItem) == 0)
+            selection = index;
+    }
+
+    char **items = (char**)malloc((numItems + 1) * sizeof(char*)); // "tag  item", all as wide, so the tags and the items line up when centered ... and the cancel button after them
+    if (items == NULL)
+        return BOX_DIALOG_ERROR;
+
+    for (uint32_t index = 0; index < numItems; index++)
+    {
+        const char *tag = tags[index * 2], *item = tags[index * 2 + 1];
+        size_t padding = tagColumns - TextWidth_String(tag) + 2;
+        size_t trailing = itemColumns - TextWidth_String(item);
+
+        items[index] = (char*)malloc(strlen(tag) + padding + strlen(item) + trailing + 1);
+        if (items[index] == NULL)
+        {
+            while (index > 0)
+                free(items[--index]);
+            free(items);
+
+            return BOX_DIALOG_ERROR;
+        }
+
+        sprintf(items[index], "%s%*s%s%*s", tag, (int)padding, "", item, (int)trailing, "");
+    }
+
+    uint8_t termW, termH;
+    TerminalSize_Get(&termW, &termH);
+
+    int result = BOX_DIALOG_OK;
+
+    if (numItems + 1 <= MESSAGE_BOX_MAX_OPTIONS && numItems + 5 <= termH && selection == 0) // a message box, as whiptail draws it
+    {
+        items[numItems] = (char*)options->CancelButton;
+        selection = ShowChoiceBox(options->Title, options->Text, (uint8_t)numItems + 1, items, options->Style);
+
+        if (selection == MESSAGE_BOX_ESC)
+            result = BOX_DIALOG_ESC;
+        else if (selection == numItems)
+            result = BOX_DIALOG_CANCEL;
+    }
+    else // too many to fit, or starting from another one: the list has a single line above it, for the title and the text
+    {
+        char title[256];
+        if (options->Title[0] != '\0' && options->Text[0] != '\0')
+            snprintf(title, sizeof(title), "%s: %s", options->Title, options->Text);
+        else
+            snprintf(title, sizeof(title), "%s", (options->Title[0] != '\0') ? options->Title : options->Text);
+
+        if (!ShowListBox(&selection, title, numItems, ListBox_ArrayItem, items, options->Style))
+            result = BOX_DIALOG_ESC;
+    }
+
+    if (result == BOX_DIALOG_OK)
+        BoxDialog_Answer(options, tags[selection * 2]);
+
+    for (uint32_t index = 0; index < numItems; index++)
+        free(items[index]);
+    free(items);
+
+    return result;
+}
+
+static int BoxDialog_Range(const struct boxOptions *options)
+{
+    int minValue = atoi(options->Arguments[0]), maxValue = atoi(options->Arguments[1]), value = atoi(options->Arguments[2]); // whole numbers, as in dialog
+
+    float chosen = value;
+    if (!ShowRangeBox(options->Title, options->Text, minValue, &chosen, maxValue, 1, options->Style))
+        return BOX_DIALOG_ESC; // there is no cancel button to return BOX_DIALOG_CANCEL for
+
+    char answer[32];
+    sprintf(answer, "%d", (int)chosen);
+
+    BoxDialog_Answer(options, answer);
+    return BOX_DIALOG_OK;
+}
+
+static int BoxDialog_Gauge(const struct boxOptions *options)
+{
+    ProgressDialog gauge;
+    if (!ProgressDialog_Open(&gauge, options->Title, 100, options->Style))
+        return BOX_DIALOG_ERROR;
+
+    ProgressDialog_SetLabel(&gauge, options->Text);
+    ProgressDialog_Update(&gauge, (uint64_t)atoi(options->Arguments[0]));
+
+    char line[BOX_DIALOG_LINE_MAX];
+    char label[PROGRESS_DIALOG_LABEL_MAX] = "";
+    int blockLine = -1; // the line in an "XXX" block, -1 outside of one
+
+    while (fgets(line, sizeof(line), stdin) != NULL)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+
+        if (strcmp(line, "XXX") == 0)
+        {
+            if (blockLine >= 0) // the end of it
+                ProgressDialog_SetLabel(&gauge, label);
+
+            blockLine = (blockLine >= 0) ? -1 : 0;
+            label[0] = '\0';
+        }
+        else if (blockLine < 0 || blockLine++ == 0) // the first line of a block is the percent
+            ProgressDialog_Update(&gauge, (uint64_t)min(max(atoi(line), 0), 100));
+        else // the text lines are joined
+            snprintf(label + strlen(label), sizeof(label) - strlen(label), (label[0] == '\0') ? "%s" : " %s", line);
+    }
+
+    ProgressDialog_Close(&gauge);
+    return BOX_DIALOG_OK;
+}
+
+static int BoxDialog_FileSelect(const struct boxOptions *options)
+{
+    char start[_TINYDIR_PATH_MAX] = "";
+    char path[_TINYDIR_PATH_MAX] = "";
+
+    if (options->Text[0] != '\0' && strcmp(options->Text, ".") != 0) // the explorer starts from the working directory
+    {
+        if (chdir(options->Text) != 0)
+            return BOX_DIALOG_ERROR;
+
+        strcpy(start, options->Text);
+    }
+
+    if (!ShowFileExplorer(path, "", options->Title, 0, options->Style))
+        return BOX_DIALOG_ESC;
+
+    char answer[2 * _TINYDIR_PATH_MAX];
+    if (start[0] != '\0' && path[0] != '/' && !(path[0] != '\0' && path[1] == ':')) // relative to where the explorer started
+        snprintf(answer, sizeof(answer), "%s/%s", start, path);
+    else
+        strcpy(answer, path);
+
+    BoxDialog_Answer(options, answer);
+    return BOX_DIALOG_OK;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 2 && strcmp(argv[1], "--sync-update") == 0) // for export BOXCANVAS_SYNC_UPDATE=$(boxdialog --sync-update)
+    {
+        uint8_t supported = SyncUpdate_Detect();
+        printf("%u\n", supported);
+        return BOX_DIALOG_OK;
+    }
+
+    struct boxOptions options = {
+        .Type = BOX_NONE,
+        .Title = "",
+        .OutputDescriptor = 2,
+        .YesButton = "Yes",
+        .NoButton = "No",
+        .OkButton = "Ok",
+        .CancelButton = "Cancel",
+        .Style = DIALOG_BOX_STYLE_BLUE,
+    };
+
+    if (!BoxDialog_Parse(&options, argc, argv))
+        return BoxDialog_Usage(); // the terminal was not touched
+
+    BoxDialog_SeparateAnswer(&options);
+
+    FrameRecorder recorder;
+    const char *recordPath = getenv(FRAME_RECORDER_ENVIRONMENT);
+    uint8_t recording = (recordPath != NULL && recordPath[0] != '\0' && OutputSink_Install() && FrameRecorder_Start(&recorder, 1, 0, 0));
+
+    #if defined(unix) || defined(__unix__) || defined(__unix)
+        if (recording)
+            FrameRecorder_DumpOnSignal(&recorder, SIGUSR1, recordPath);
+    #endif
+
+    int result = BOX_DIALOG_ERROR;
+
+    switch (options.Type)
+    {
+        case BOX_MSGBOX:
+        case BOX_YESNO:     result = BoxDialog_Message(&options);       break;
+        case BOX_MENU:      result = BoxDialog_Menu(&options);          break;
+        case BOX_RANGEBOX:  result = BoxDialog_Range(&options);         break;
+        case BOX_GAUGE:     result = BoxDialog_Gauge(&options);         break;
+        case BOX_FSELECT:   result = BoxDialog_FileSelect(&options);    break;
+        default: break;
+    }
+
+    Terminal_SetStyle(CONSOLE_STYLE_TEXT_WHITE, CONSOLE_STYLE_BACKGROUND_BLACK);
+    if (options.Clear)
+        Terminal_Clear();
+    fflush(stdout);
+
+    if (recording)
+    {
+        FrameRecorder_Dump(&recorder, recordPath);
+        FrameRecorder_Stop(&recorder);
+    }
+
+    return result;
+}
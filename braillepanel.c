@@ -0,0 +1,159 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+#include "braillepanel.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const uint8_t dotBits[4][2] = { // [y][x] within a cell
+    { 0x01, 0x08 },
+    { 0x02, 0x10 },
+    { 0x04, 0x20 },
+    { 0x40, 0x80 },
+};
+
+void BraillePanel_Create(BraillePanel *panel, uint8_t X, uint8_t Y, uint8_t W, uint8_t H)
+{
+    size_t cells = (size_t)W * H;
+
+    panel->X = X;
+    panel->Y = Y;
+    panel->W = W;
+    panel->H = H;
+    panel->Dots = (uint8_t*)calloc(2, (cells > 0) ? cells : 1); // the dots and what is shown in one block
+    panel->Shown = (panel->Dots != NULL) ? panel->Dots + cells : NULL;
+    panel->ShownValid = 0;
+    panel->Next = NULL;
+
+    if (panel->Dots == NULL)
+        panel->W = panel->H = 0; // an empty panel, still safe to use
+}
+
+void BraillePanel_Destroy(BraillePanel *panel)
+{
+    free(panel->Dots);
+
+    panel->Dots = NULL;
+    panel->Shown = NULL;
+    panel->W = panel->H = 0;
+}
+
+void BraillePanel_Clear(BraillePanel *panel)
+{
+    memset(panel->Dots, 0, (size_t)panel->W * panel->H);
+}
+
+void BraillePanel_Set(BraillePanel *panel, uint16_t x, uint16_t y, uint8_t on)
+{
+    if (x >= 2 * panel->W || y >= 4 * panel->H)
+        return;
+
+    uint8_t *cell = &panel->Dots[(size_t)(y / 4) * panel->W + x / 2];
+
+    if (on)
+        *cell |= dotBits[y % 4][x % 2];
+    else
+        *cell &= ~dotBits[y % 4][x % 2];
+}
+
+static int32_t BraillePanel_Level(float value, float minValue, float maxValue, uint16_t levels) // 0 ... levels-1, or -1 for values that are not numbers
+{
+    if (value != value)
+        return -1;
+
+    float fraction = (maxValue > minValue) ? (value - minValue) / (maxValue - minValue) : 0;
+
+    if (fraction < 0) fraction = 0;
+    if (fraction > 1) fraction = 1;
+
+    return (int32_t)(fraction * (levels - 1) + 0.5f);
+}
+
+void BraillePanel_Sparkline(BraillePanel *panel, const float *values, uint32_t count, float minValue, float maxValue)
+{
+    uint16_t dotsW = 2 * panel->W;
+    uint16_t dotsH = 4 * panel->H;
+
+    BraillePanel_Clear(panel);
+    if (dotsH == 0)
+        return;
+
+    uint32_t first = (count > dotsW) ? count - dotsW : 0;
+    uint16_t left = dotsW - (count - first); // fewer values than columns start further right
+    int32_t previous = -1;
+
+    for (uint32_t index = first; index < count; index++)
+    {
+        int32_t level = BraillePanel_Level(values[index], minValue, maxValue, dotsH);
+        uint16_t x = left + (index - first);
+
+        if (level < 0) // a gap in the line
+        {
+            previous = -1;
+            continue;
+        }
+
+        int32_t y = dotsH - 1 - level;
+        int32_t from = (previous >= 0 && previous < y) ? previous : y; // the column goes from the height of the last value to this one
+        int32_t to = (previous > y) ? previous : y;
+
+        for (int32_t dot = from; dot <= to; dot++)
+            BraillePanel_Set(panel, x, dot, 1);
+
+        previous = y;
+    }
+}
+
+void BraillePanel_Histogram(BraillePanel *panel, const float *values, uint32_t count, float minValue, float maxValue)
+{
+    uint16_t dotsW = 2 * panel->W;
+    uint16_t dotsH = 4 * panel->H;
+
+    BraillePanel_Clear(panel);
+    if (count == 0)
+        return;
+
+    for (uint16_t x = 0; x < dotsW; x++)
+    {
+        uint32_t index = (uint64_t)x * count / dotsW;
+
+        if (dotsW >= 2 * count && (uint64_t)(x + 1) * count / dotsW != index)
+            continue; // the last column of each bar is left empty when the bars are wide enough to be told apart
+
+        int32_t level = BraillePanel_Level(values[index], minValue, maxValue, dotsH + 1); // 0 is an empty bar
+
+        for (int32_t dot = dotsH - level; dot < dotsH; dot++)
+            BraillePanel_Set(panel, x, dot, 1);
+    }
+}
+
+size_t BraillePanel_Glyph(uint8_t dots, uint8_t use_utf8, char *out)
+{
+    if (use_utf8)
+    {
+        out[0] = '\xE2';
+        out[1] = (char)(0xA0 | (dots >> 6));
+        out[2] = (char)(0x80 | (dots & 0x3F));
+        return 3;
+    }
+
+    uint8_t count = 0;
+    for (uint8_t bits = dots; bits != 0; bits &= bits - 1)
+        count++;
+
+    out[0] = (count == 0) ? ' ' : (count <= 2) ? (char)176 : (count <= 5) ? (char)177 : (char)178; // the shades of the code page, by how many dots are on
+    return 1;
+}
@@ -0,0 +1,51 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+#ifndef _BRAILLE_PANEL_H_
+#define _BRAILLE_PANEL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// A plot in a rectangle of cells of a box canvas: each cell is a Braille character (U+2800 ... U+28FF) of 2 by 4 dots
+// The panel is attached to the canvas and encoded together with the boxes around it, so a chart in a dialog is still one frame
+// It remembers what is on the screen too: BoxCanvas_RenderBraille sends only the cells whose dots changed, for charts redrawn many times a second
+
+#define BRAILLE_PANEL_RUN_GAP   2   // unchanged cells sent anyway to join two runs (a cursor movement costs about as much)
+
+typedef struct _BraillePanel
+{
+    uint8_t X;              // the cells of the canvas it covers
+    uint8_t Y;
+    uint8_t W;
+    uint8_t H;
+
+    uint8_t *Dots;          // W*H cells row by row, the bits as in U+2800 (dots 1 to 8)
+    uint8_t *Shown;         // the cells the terminal has
+    uint8_t ShownValid;     // 0 until the panel is rendered the first time
+
+    struct _BraillePanel *Next; // the next panel of the same canvas
+} BraillePanel;
+
+void BraillePanel_Create(BraillePanel *panel, uint8_t X, uint8_t Y, uint8_t W, uint8_t H); // 2*W by 4*H dots, all off
+void BraillePanel_Destroy(BraillePanel *panel);
+void BraillePanel_Clear(BraillePanel *panel);
+void BraillePanel_Set(BraillePanel *panel, uint16_t x, uint16_t y, uint8_t on); // x from the left, y from the top ... dots outside are ignored
+void BraillePanel_Sparkline(BraillePanel *panel, const float *values, uint32_t count, float minValue, float maxValue); // the last 2*W values, one in each column of dots with the newest on the right, joined by vertical lines
+void BraillePanel_Histogram(BraillePanel *panel, const float *values, uint32_t count, float minValue, float maxValue); // count bars from the bottom, spread over the width
+size_t BraillePanel_Glyph(uint8_t dots, uint8_t use_utf8, char *out); // the text of a cell (3 bytes in UTF-8, 1 otherwise) ... returns its length
+
+#endif // _BRAILLE_PANEL_H_
@@ -0,0 +1,657 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+#include "canvasmirror.h"
+#include "port_kbhit.h"         // the viewer waits for the socket and the keyboard together
+#include "terminalsize.h"
+#include "outputsink.h"         // the frame is flushed like the dialogs do
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(unix) || defined(__unix__) || defined(__unix)
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #define CANVAS_MIRROR_SOCKETS
+
+    #if !defined(MSG_NOSIGNAL) // a viewer that went away must not kill the producer ... where there's no such flag, SO_NOSIGPIPE is set on each socket
+        #define MSG_NOSIGNAL 0
+    #endif
+#endif
+
+static void CanvasMirror_PutHeader(char *out, uint8_t type, uint32_t sequence, uint32_t length)
+{
+    out[0] = type;
+
+    for (uint8_t byte = 0; byte < 4; byte++)
+    {
+        out[1 + byte] = (char)(sequence >> (8 * byte));
+        out[5 + byte] = (char)(length >> (8 * byte));
+    }
+}
+
+static uint32_t CanvasMirror_GetNumber(const char *in)
+{
+    const unsigned char *bytes = (const unsigned char*)in;
+    return bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static uint8_t CanvasMirror_Reserve(char **buffer, size_t *capacity, size_t size)
+{
+    if (size <= *capacity)
+        return 1;
+
+    char *grown = (char*)realloc(*buffer, size);
+    if (grown == NULL)
+        return 0;
+
+    *buffer = grown;
+    *capacity = size;
+    return 1;
+}
+
+#if defined(CANVAS_MIRROR_SOCKETS)
+
+// VIEWERS
+// =================================================================
+
+static void CanvasMirror_Drop(CanvasMirror *mirror, CanvasMirrorViewer *viewer)
+{
+    close(viewer->Descriptor);
+    free(viewer->Pending);
+
+    viewer->Descriptor = -1;
+    viewer->Pending = NULL;
+    viewer->PendingCapacity = 0;
+    viewer->PendingLength = 0;
+    mirror->NumViewers--;
+}
+
+static void CanvasMirror_Send(CanvasMirror *mirror, CanvasMirrorViewer *viewer, const char *data, size_t length) // whatever the socket does not take now is kept for later
+{
+    ssize_t sent = send(viewer->Descriptor, data, length, MSG_NOSIGNAL);
+
+    if (sent < 0)
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        {
+            CanvasMirror_Drop(mirror, viewer);
+            return;
+        }
+
+        sent = 0;
+    }
+
+    if ((size_t)sent == length)
+        return;
+
+    if (!CanvasMirror_Reserve(&viewer->Pending, &viewer->PendingCapacity, length - sent))
+    {
+        CanvasMirror_Drop(mirror, viewer); // half a message cannot be taken back
+        return;
+    }
+
+    memcpy(viewer->Pending, data + sent, length - sent);
+    viewer->PendingOffset = 0;
+    viewer->PendingLength = length - sent;
+}
+
+static uint8_t CanvasMirror_Flush(CanvasMirror *mirror, CanvasMirrorViewer *viewer) // returns 1 if the viewer took everything it was sent
+{
+    while (viewer->PendingLength > 0)
+    {
+        ssize_t sent = send(viewer->Descriptor, viewer->Pending + viewer->PendingOffset, viewer->PendingLength, MSG_NOSIGNAL);
+
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                CanvasMirror_Drop(mirror, viewer);
+
+            return 0;
+        }
+
+        viewer->PendingOffset += sent;
+        viewer->PendingLength -= sent;
+    }
+
+    return 1;
+}
+
+static void CanvasMirror_Accept(CanvasMirror *mirror)
+{
+    int descriptor;
+
+    while ((descriptor = accept(mirror->Listener, NULL, NULL)) >= 0)
+    {
+        CanvasMirrorViewer *viewer = NULL;
+
+        for (uint8_t index = 0; index < CANVAS_MIRROR_MAX_VIEWERS && viewer == NULL; index++)
+            if (mirror->Viewers[index].Descriptor < 0)
+                viewer = &mirror->Viewers[index];
+
+        if (viewer == NULL) // full
+        {
+            close(descriptor);
+            continue;
+        }
+
+        fcntl(descriptor, F_SETFL, fcntl(descriptor, F_GETFL) | O_NONBLOCK);
+
+        #if defined(SO_NOSIGPIPE)
+            int on = 1;
+            setsockopt(descriptor, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+        #endif
+
+        viewer->Descriptor = descriptor;
+        viewer->NeedsKeyframe = 1;
+        viewer->Stalled = 0;
+        viewer->PendingLength = 0;
+        mirror->NumViewers++;
+    }
+}
+
+#endif // CANVAS_MIRROR_SOCKETS
+
+// FRAMES
+// =================================================================
+
+static const char* CanvasMirror_GetKeyframe(CanvasMirror *mirror, size_t *length) // the last frame published, encoded at most once
+{
+    if (mirror->Cells == NULL)
+        return NULL;
+
+    if (mirror->Keyframe == NULL || mirror->KeyframeSequence != mirror->Sequence)
+    {
+        size_t cells = (size_t)mirror->Width * mirror->Height;
+
+        if (!CanvasMirror_Reserve(&mirror->Keyframe, &mirror->KeyframeCapacity, CANVAS_MIRROR_HEADER_SIZE + 4 + cells))
+            return NULL;
+
+        char *out = mirror->Keyframe;
+        CanvasMirror_PutHeader(out, CANVAS_MIRROR_KEYFRAME, mirror->Sequence, 4 + cells);
+        out += CANVAS_MIRROR_HEADER_SIZE;
+
+        *out++ = mirror->Width;
+        *out++ = mirror->Height;
+        *out++ = mirror->FillStyle;
+        *out++ = mirror->BackgroundStyle;
+        memcpy(out, mirror->Cells, cells);
+
+        mirror->KeyframeLength = CANVAS_MIRROR_HEADER_SIZE + 4 + cells;
+        mirror->KeyframeSequence = mirror->Sequence;
+    }
+
+    *length = mirror->KeyframeLength;
+    return mirror->Keyframe;
+}
+
+static size_t CanvasMirror_EncodeDelta(CanvasMirror *mirror, const BoxCanvas *canvas) // brings the cells up to date and returns the length of the delta (0 if nothing changed)
+{
+    uint8_t W = mirror->Width;
+    size_t worst = CANVAS_MIRROR_HEADER_SIZE + (size_t)mirror->Height * (2 * W + 6); // runs are at least a gap apart, so their headers cost less than a byte per cell
+
+    if (mirror->NumViewers == 0 || !CanvasMirror_Reserve(&mirror->Delta, &mirror->DeltaCapacity, worst))
+    {
+        for (uint8_t row = 0; row < mirror->Height; row++) // still kept, for the keyframes of the viewers to come
+            memcpy(mirror->Cells + (size_t)row * W, canvas->BlockBuffer[row], W);
+
+        for (uint8_t index = 0; index < CANVAS_MIRROR_MAX_VIEWERS; index++) // no room for the delta: the viewers connected would miss this change, so they start over from a keyframe
+            if (mirror->Viewers[index].Descriptor >= 0)
+                mirror->Viewers[index].NeedsKeyframe = 1;
+
+        return 0;
+    }
+
+    char *out = mirror->Delta + CANVAS_MIRROR_HEADER_SIZE;
+
+    for (uint8_t row = 0; row < mirror->Height; row++)
+    {
+        const uint8_t *cells = canvas->BlockBuffer[row];
+        uint8_t *shown = mirror->Cells + (size_t)row * W;
+
+        if (memcmp(cells, shown, W) == 0)
+            continue;
+
+        for (uint16_t col = 0; col < W;)
+        {
+            if (cells[col] == shown[col])
+            {
+                col++;
+                continue;
+            }
+
+            uint16_t start = col, end = col + 1; // end: one past the last cell that changed
+            for (uint16_t next = col + 1; next < W && next - start < UINT8_MAX; next++)
+            {
+                if (cells[next] != shown[next])
+                    end = next + 1;
+                else if (next - end >= CANVAS_MIRROR_RUN_GAP)
+                    break;
+            }
+
+            *out++ = row;
+            *out++ = (uint8_t)start;
+            *out++ = (uint8_t)(end - start);
+            memcpy(out, &cells[start], end - start);
+            out += end - start;
+            col = end;
+        }
+
+        memcpy(shown, cells, W);
+    }
+
+    size_t payload = out - (mirror->Delta + CANVAS_MIRROR_HEADER_SIZE);
+    if (payload == 0)
+        return 0;
+
+    CanvasMirror_PutHeader(mirror->Delta, CANVAS_MIRROR_DELTA, mirror->Sequence, payload);
+    return CANVAS_MIRROR_HEADER_SIZE + payload;
+}
+
+static uint8_t CanvasMirror_Reset(CanvasMirror *mirror, const BoxCanvas *canvas) // a new size or style: everybody starts over from a keyframe
+{
+    uint8_t *cells = (uint8_t*)realloc(mirror->Cells, (size_t)canvas->Width * canvas->Height);
+    if (cells == NULL)
+        return 0;
+
+    mirror->Cells = cells;
+    mirror->Width = canvas->Width;
+    mirror->Height = canvas->Height;
+    mirror->FillStyle = canvas->FillStyle;
+    mirror->BackgroundStyle = canvas->BackgroundStyle;
+
+    for (uint8_t row = 0; row < mirror->Height; row++)
+        memcpy(mirror->Cells + (size_t)row * mirror->Width, canvas->BlockBuffer[row], mirror->Width);
+
+    for (uint8_t index = 0; index < CANVAS_MIRROR_MAX_VIEWERS; index++)
+        mirror->Viewers[index].NeedsKeyframe = 1;
+
+    return 1;
+}
+
+// PRODUCER
+// =================================================================
+
+uint8_t CanvasMirror_Open(CanvasMirror *mirror, const char *path)
+{
+    memset(mirror, 0, sizeof(CanvasMirror));
+    mirror->Listener = -1;
+    pthread_mutex_init(&mirror->Mutex, NULL);
+
+    for (uint8_t index = 0; index < CANVAS_MIRROR_MAX_VIEWERS; index++)
+        mirror->Viewers[index].Descriptor = -1;
+
+    #if defined(CANVAS_MIRROR_SOCKETS)
+        struct sockaddr_un address;
+        if (strlen(path) >= sizeof(address.sun_path))
+            return 0;
+
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strcpy(address.sun_path, path);
+
+        int descriptor = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (descriptor < 0)
+            return 0;
+
+        unlink(path); // left behind by a producer that did not close
+
+        if (bind(descriptor, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(descriptor, CANVAS_MIRROR_MAX_VIEWERS) != 0)
+        {
+            close(descriptor);
+            return 0;
+        }
+
+        fcntl(descriptor, F_SETFL, fcntl(descriptor, F_GETFL) | O_NONBLOCK);
+        mirror->Listener = descriptor;
+        strcpy(mirror->Path, path);
+        return 1;
+    #else
+        (void)path;
+        return 0;
+    #endif
+}
+
+void CanvasMirror_Close(CanvasMirror *mirror)
+{
+    #if defined(CANVAS_MIRROR_SOCKETS)
+        pthread_mutex_lock(&mirror->Mutex);
+
+        for (uint8_t index = 0; index < CANVAS_MIRROR_MAX_VIEWERS; index++)
+            if (mirror->Viewers[index].Descriptor >= 0)
+                CanvasMirror_Drop(mirror, &mirror->Viewers[index]);
+
+        if (mirror->Listener >= 0)
+        {
+            close(mirror->Listener);
+            unlink(mirror->Path);
+            mirror->Listener = -1;
+        }
+
+        pthread_mutex_unlock(&mirror->Mutex);
+    #endif
+
+    free(mirror->Cells);
+    free(mirror->Delta);
+    free(mirror->Keyframe);
+    mirror->Cells = NULL;
+    mirror->Delta = NULL;
+    mirror->Keyframe = NULL;
+
+    pthread_mutex_destroy(&mirror->Mutex);
+}
+
+int CanvasMirror_GetDescriptor(const CanvasMirror *mirror)
+{
+    return mirror->Listener;
+}
+
+void CanvasMirror_Poll(CanvasMirror *mirror)
+{
+    #if defined(CANVAS_MIRROR_SOCKETS)
+        if (mirror->Listener < 0)
+            return;
+
+        pthread_mutex_lock(&mirror->Mutex);
+        CanvasMirror_Accept(mirror);
+
+        for (uint8_t index = 0; index < CANVAS_MIRROR_MAX_VIEWERS; index++)
+        {
+            CanvasMirrorViewer *viewer = &mirror->Viewers[index];
+            if (viewer->Descriptor < 0 || !CanvasMirror_Flush(mirror, viewer) || !viewer->NeedsKeyframe)
+                continue;
+
+            size_t length;
+            const char *keyframe = CanvasMirror_GetKeyframe(mirror, &length);
+
+            if (keyframe != NULL) // otherwise nothing was published yet
+            {
+                viewer->NeedsKeyframe = 0;
+                viewer->Stalled = 0;
+                CanvasMirror_Send(mirror, viewer, keyframe, length);
+            }
+        }
+
+        pthread_mutex_unlock(&mirror->Mutex);
+    #else
+        (void)mirror;
+    #endif
+}
+
+void CanvasMirror_Publish(CanvasMirror *mirror, const BoxCanvas *canvas)
+{
+    #if defined(CANVAS_MIRROR_SOCKETS)
+        if (mirror->Listener < 0)
+            return;
+
+        pthread_mutex_lock(&mirror->Mutex);
+        CanvasMirror_Accept(mirror);
+        mirror->Sequence++;
+
+        size_t deltaLength = 0;
+
+        if (mirror->Cells == NULL || canvas->Width != mirror->Width || canvas->Height != mirror->Height || canvas->FillStyle != mirror->FillStyle || canvas->BackgroundStyle != mirror->BackgroundStyle)
+        {
+            if (!CanvasMirror_Reset(mirror, canvas))
+            {
+                pthread_mutex_unlock(&mirror->Mutex);
+                return;
+            }
+        }
+        else
+            deltaLength = CanvasMirror_EncodeDelta(mirror, canvas);
+
+        for (uint8_t index = 0; index < CANVAS_MIRROR_MAX_VIEWERS; index++)
+        {
+            CanvasMirrorViewer *viewer = &mirror->Viewers[index];
+            if (viewer->Descriptor < 0)
+                continue;
+
+            if (!CanvasMirror_Flush(mirror, viewer)) // still busy with an older frame: this one is skipped, and a keyframe makes up for it later
+            {
+                if (viewer->Descriptor >= 0)
+                {
+                    viewer->NeedsKeyframe = 1;
+
+                    if (++viewer->Stalled > CANVAS_MIRROR_STALL_FRAMES)
+                        CanvasMirror_Drop(mirror, viewer);
+                }
+
+                continue;
+            }
+
+            viewer->Stalled = 0;
+
+            if (viewer->NeedsKeyframe)
+            {
+                size_t length;
+                const char *keyframe = CanvasMirror_GetKeyframe(mirror, &length);
+
+                if (keyframe != NULL)
+                {
+                    viewer->NeedsKeyframe = 0;
+                    CanvasMirror_Send(mirror, viewer, keyframe, length);
+                }
+            }
+            else if (deltaLength > 0)
+                CanvasMirror_Send(mirror, viewer, mirror->Delta, deltaLength);
+        }
+
+        pthread_mutex_unlock(&mirror->Mutex);
+    #else
+        (void)mirror;
+        (void)canvas;
+    #endif
+}
+
+// VIEWER
+// =================================================================
+
+#if defined(CANVAS_MIRROR_SOCKETS)
+
+struct mirrorView
+{
+    BoxCanvas Canvas;       // clipped to this terminal
+    uint8_t Created;
+    uint8_t DirtyRows[UINT8_MAX + 1];
+};
+
+static uint8_t CanvasMirror_ApplyKeyframe(struct mirrorView *view, const uint8_t *payload, uint32_t length)
+{
+    if (length < 4 || length - 4 < (uint32_t)payload[0] * payload[1])
+        return 0;
+
+    uint8_t termW, termH;
+    TerminalSize_Get(&termW, &termH);
+
+    uint8_t W = min(payload[0], termW);
+    uint8_t H = min(payload[1], termH);
+
+    if (view->Created && (view->Canvas.Width != W || view->Canvas.Height != H))
+    {
+        BoxCanvas_Destroy(&view->Canvas);
+        view->Created = 0;
+        Terminal_Clear(); // a smaller canvas leaves the rest behind
+    }
+
+    if (!view->Created)
+    {
+        BoxCanvas_Create(&view->Canvas, 0, 0, max(W, 1), max(H, 1));
+        view->Created = 1;
+    }
+
+    view->Canvas.FillStyle = (ConsoleStyleText)payload[2];
+    view->Canvas.BackgroundStyle = (ConsoleStyleBackground)payload[3];
+
+    for (uint8_t row = 0; row < H; row++)
+    {
+        memcpy(view->Canvas.BlockBuffer[row], &payload[4 + (size_t)row * payload[0]], W);
+        view->DirtyRows[row] = 1;
+    }
+
+    return 1;
+}
+
+static uint8_t CanvasMirror_ApplyDelta(struct mirrorView *view, const uint8_t *payload, uint32_t length)
+{
+    if (!view->Created) // joined in the middle ... a keyframe comes first
+        return 1;
+
+    for (uint32_t offset = 0; offset < length;)
+    {
+        if (length - offset < 3 || length - offset - 3 < payload[offset + 2])
+            return 0;
+
+        uint8_t row = payload[offset], col = payload[offset + 1], count = payload[offset + 2];
+        offset += 3;
+
+        if (row < view->Canvas.Height && col < view->Canvas.Width)
+        {
+            memcpy(&view->Canvas.BlockBuffer[row][col], &payload[offset], min(count, view->Canvas.Width - col));
+            view->DirtyRows[row] = 1;
+        }
+
+        offset += count;
+    }
+
+    return 1;
+}
+
+static void CanvasMirror_ShowRows(struct mirrorView *view) // only the rows that changed are printed
+{
+    char line[BOX_CANVAS_ROW_BYTES(UINT8_MAX)];
+    uint8_t styled = 0;
+
+    for (uint8_t row = 0; row < view->Canvas.Height && view->Created; row++)
+    {
+        if (!view->DirtyRows[row])
+            continue;
+
+        if (!styled)
+        {
+            Terminal_SetStyle(view->Canvas.FillStyle, view->Canvas.BackgroundStyle);
+            styled = 1;
+        }
+
+        OutputSink_Print(line, BoxCanvas_EncodeRows(&view->Canvas, row, 1, 1, 1, line));
+        view->DirtyRows[row] = 0;
+    }
+
+    OutputSink_Flush();
+}
+
+#endif // CANVAS_MIRROR_SOCKETS
+
+uint8_t CanvasMirror_View(const char *path)
+{
+    #if defined(CANVAS_MIRROR_SOCKETS)
+        struct sockaddr_un address;
+        if (strlen(path) >= sizeof(address.sun_path))
+            return 0;
+
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strcpy(address.sun_path, path);
+
+        int descriptor = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (descriptor < 0)
+            return 0;
+
+        if (connect(descriptor, (struct sockaddr*)&address, sizeof(address)) != 0)
+        {
+            close(descriptor);
+            return 0;
+        }
+
+        struct mirrorView view;
+        memset(&view, 0, sizeof(view));
+
+        char *buffer = NULL;
+        size_t capacity = 0, length = 0;
+        uint8_t connected = 1;
+
+        Terminal_Clear();
+
+        while (connected)
+        {
+            char event = kbhitWaitDescriptors(1000000, &descriptor, 1);
+
+            if (event == 1)
+            {
+                char key = getch();
+                if (key == 'q' || key == KEY_ESC)
+                    break;
+
+                continue;
+            }
+
+            if (event != 2)
+                continue;
+
+            if (!CanvasMirror_Reserve(&buffer, &capacity, length + 65536))
+                break;
+
+            ssize_t received = recv(descriptor, buffer + length, 65536, 0);
+            if (received <= 0)
+                break; // the producer went away
+
+            length += received;
+
+            size_t offset = 0;
+            while (connected && length - offset >= CANVAS_MIRROR_HEADER_SIZE)
+            {
+                uint32_t payload = CanvasMirror_GetNumber(buffer + offset + 5);
+
+                if (payload > CANVAS_MIRROR_MESSAGE_MAX)
+                    connected = 0;
+                else if (length - offset - CANVAS_MIRROR_HEADER_SIZE < payload)
+                    break; // the rest of it comes with the next read
+                else
+                {
+                    const uint8_t *message = (const uint8_t*)buffer + offset + CANVAS_MIRROR_HEADER_SIZE;
+
+                    if (buffer[offset] == CANVAS_MIRROR_KEYFRAME)
+                        connected = CanvasMirror_ApplyKeyframe(&view, message, payload);
+                    else if (buffer[offset] == CANVAS_MIRROR_DELTA)
+                        connected = CanvasMirror_ApplyDelta(&view, message, payload);
+
+                    offset += CANVAS_MIRROR_HEADER_SIZE + payload; // other types are skipped
+                }
+            }
+
+            memmove(buffer, buffer + offset, length - offset);
+            length -= offset;
+
+            CanvasMirror_ShowRows(&view); // everything that arrived together is drawn once
+        }
+
+        if (view.Created)
+            BoxCanvas_Destroy(&view.Canvas);
+
+        free(buffer);
+        close(descriptor);
+        return 1;
+    #else
+        (void)path;
+        return 0;
+    #endif
+}
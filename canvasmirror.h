@@ -0,0 +1,87 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+#ifndef _CANVAS_MIRROR_H_
+#define _CANVAS_MIRROR_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "boxcanvas.h"
+
+// Publishes every frame of a box canvas to the viewers connected to a Unix socket, so other terminals can watch the same screen
+// A viewer gets a keyframe (all the cells) when it connects and then only the cells that changed; the changes are encoded once for all of them
+// Sending never blocks: a viewer that cannot take a frame skips it and gets a keyframe once it catches up (or is dropped if it never does)
+//
+// Each message is a header (type, sequence and payload length, the numbers little-endian) followed by the payload:
+//   'K' keyframe: width, height, fill style, background style, then width*height box codes row by row
+//   'D' delta: runs of changed cells, each one row, column, count, then count box codes
+
+#define CANVAS_MIRROR_MAX_VIEWERS   16
+#define CANVAS_MIRROR_STALL_FRAMES  300     // a viewer that has not taken a whole frame in this many frames is dropped
+#define CANVAS_MIRROR_RUN_GAP       3       // unchanged cells sent anyway to join two runs (a new run costs as much)
+#define CANVAS_MIRROR_HEADER_SIZE   9
+#define CANVAS_MIRROR_MESSAGE_MAX   (1 << 20) // longer messages are not from a mirror: the viewer disconnects
+
+typedef enum {
+    CANVAS_MIRROR_KEYFRAME = 'K',
+    CANVAS_MIRROR_DELTA = 'D',
+} CanvasMirrorMessage;
+
+typedef struct _CanvasMirrorViewer
+{
+    int Descriptor;         // -1 = free
+    uint8_t NeedsKeyframe;
+    uint32_t Stalled;       // frames skipped in a row
+    char *Pending;          // the rest of a message the socket did not take
+    size_t PendingOffset;
+    size_t PendingLength;
+    size_t PendingCapacity;
+} CanvasMirrorViewer;
+
+typedef struct _CanvasMirror
+{
+    int Listener;           // -1 = not mirroring
+    char Path[108];
+    pthread_mutex_t Mutex;
+    CanvasMirrorViewer Viewers[CANVAS_MIRROR_MAX_VIEWERS];
+    uint8_t NumViewers;
+
+    // the last frame published
+    uint32_t Sequence;
+    uint8_t Width;
+    uint8_t Height;
+    uint8_t FillStyle;
+    uint8_t BackgroundStyle;
+    uint8_t *Cells;
+
+    char *Delta;            // encoded once per frame for all the viewers
+    size_t DeltaCapacity;
+    char *Keyframe;         // encoded only when some viewer needs it
+    size_t KeyframeCapacity;
+    size_t KeyframeLength;
+    uint32_t KeyframeSequence;
+} CanvasMirror;
+
+uint8_t CanvasMirror_Open(CanvasMirror *mirror, const char *path); // returns 0 if the socket cannot be created (the mirror is still safe to use, it just has no viewers)
+void CanvasMirror_Close(CanvasMirror *mirror); // disconnects the viewers and removes the socket
+int CanvasMirror_GetDescriptor(const CanvasMirror *mirror); // becomes readable when a viewer connects, so it can be polled together with the input (-1 if not mirroring)
+void CanvasMirror_Poll(CanvasMirror *mirror); // takes in new viewers (with a keyframe of the last frame) and sends what the slow ones did not take yet
+void CanvasMirror_Publish(CanvasMirror *mirror, const BoxCanvas *canvas); // called by BoxCanvas_Render for mirrored canvases
+
+uint8_t CanvasMirror_View(const char *path); // shows the canvas published at path on this terminal until it closes or Q / ESC is pressed ... returns 0 if it cannot connect
+
+#endif // _CANVAS_MIRROR_H_
@@ -0,0 +1,209 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+#include "chromecache.h"
+#include "renderstats.h"
+#include "outputsink.h"         // counts what is printed
+#include "port_clock.h"
+#include "arena.h"              // the canvas and the encoding are only needed until the bytes are kept
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+struct chromeEntry
+{
+    // key
+    uint8_t Width;
+    uint8_t Height;
+    ConsoleStyleText FillStyle;
+    ConsoleStyleBackground BackgroundStyle;
+    ChromeDrawer Draw;
+    uint8_t Split;
+    uint8_t UseUTF8;
+
+    // value
+    char *Bytes;            // the rows, one after the other, without cursor movements ...
+    uint32_t *RowEnds;      // ... and where each one ends
+    size_t Size;
+    uint32_t LastUse;
+};
+
+static struct chromeEntry entries[CHROME_CACHE_ENTRIES];
+static size_t cachedBytes = 0;
+static uint32_t useClock = 0;
+static pthread_mutex_t cacheMutex = PTHREAD_MUTEX_INITIALIZER; // sessions on other threads share the cache
+
+static void ChromeCache_Evict(struct chromeEntry *entry)
+{
+    cachedBytes -= entry->Size;
+    free(entry->Bytes);
+    free(entry->RowEnds);
+    memset(entry, 0, sizeof(struct chromeEntry));
+}
+
+void ChromeCache_Clear(void)
+{
+    pthread_mutex_lock(&cacheMutex);
+
+    for (uint8_t index = 0; index < CHROME_CACHE_ENTRIES; index++)
+        if (entries[index].Bytes != NULL)
+            ChromeCache_Evict(&entries[index]);
+
+    pthread_mutex_unlock(&cacheMutex);
+}
+
+static struct chromeEntry* ChromeCache_Store(uint8_t W, uint8_t H, ConsoleStyleText FillStyle, ConsoleStyleBackground BackgroundStyle, ChromeDrawer draw, uint8_t split, uint8_t use_utf8)
+{
+    Arena *scratch = Arena_Scratch();
+    ArenaMark mark = Arena_Mark(scratch);
+
+    BoxCanvas canvas;
+    BoxCanvas_CreateScratch(&canvas, 0, 0, W, H);
+    draw(&canvas, split);
+
+    uint64_t start = Clock_GetMicroseconds();
+
+    char *encoded = (char*)Arena_Alloc(scratch, (size_t)H * BOX_CANVAS_ROW_BYTES(W)); // room for the longest encoding of the rows ... only what they really take is kept
+    uint32_t *rowEnds = (uint32_t*)malloc(H * sizeof(uint32_t));
+    char *bytes = NULL;
+    size_t size = 0;
+
+    if (encoded != NULL && rowEnds != NULL)
+        for (uint8_t row = 0; row < H; row++)
+        {
+            size += BoxCanvas_EncodeRows(&canvas, row, 1, use_utf8, 0, encoded + size);
+            rowEnds[row] = size;
+        }
+
+    RenderStats_Count(RENDER_COUNTER_ENCODE_TIME, Clock_GetMicroseconds() - start);
+    RenderStats_Count(RENDER_COUNTER_CELLS, (uint32_t)W * H);
+
+    if (encoded != NULL && rowEnds != NULL && size <= CHROME_CACHE_MAX_BYTES && (bytes = (char*)malloc(size)) != NULL)
+        memcpy(bytes, encoded, size);
+
+    Arena_Release(scratch, mark);
+
+    if (bytes == NULL)
+    {
+        free(rowEnds);
+        return NULL;
+    }
+
+    struct chromeEntry *slot = NULL;
+    for (;;) // make room: a free slot, and the memory for the new bytes
+    {
+        struct chromeEntry *oldest = NULL;
+        slot = NULL;
+
+        for (uint8_t index = 0; index < CHROME_CACHE_ENTRIES; index++)
+        {
+            if (entries[index].Bytes == NULL)
+                slot = &entries[index];
+            else if (oldest == NULL || entries[index].LastUse < oldest->LastUse)
+                oldest = &entries[index];
+        }
+
+        if (slot != NULL && cachedBytes + size <= CHROME_CACHE_MAX_BYTES)
+            break;
+
+        ChromeCache_Evict(oldest);
+    }
+
+    slot->Width = W;
+    slot->Height = H;
+    slot->FillStyle = FillStyle;
+    slot->BackgroundStyle = BackgroundStyle;
+    slot->Draw = draw;
+    slot->Split = split;
+    slot->UseUTF8 = use_utf8;
+    slot->Bytes = bytes;
+    slot->RowEnds = rowEnds;
+    slot->Size = size;
+    cachedBytes += size;
+
+    return slot;
+}
+
+void ChromeCache_Render(uint8_t X, uint8_t Y, uint8_t W, uint8_t H, ConsoleStyleText FillStyle, ConsoleStyleBackground BackgroundStyle, ChromeDrawer draw, uint8_t split)
+{
+    #if (defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN32__))
+        uint8_t use_utf8 = (GetConsoleOutputCP() == CP_UTF8);
+    #else
+        uint8_t use_utf8 = 1; // always use utf-8 under UNIX
+    #endif
+
+    struct chromeEntry *entry = NULL;
+    pthread_mutex_lock(&cacheMutex); // only while the entry is looked up and copied ... printing may block on a slow terminal
+
+    for (uint8_t index = 0; index < CHROME_CACHE_ENTRIES && entry == NULL; index++)
+        if (entries[index].Bytes != NULL && entries[index].Width == W && entries[index].Height == H && entries[index].Draw == draw && entries[index].Split == split &&
+            entries[index].FillStyle == FillStyle && entries[index].BackgroundStyle == BackgroundStyle && entries[index].UseUTF8 == use_utf8)
+            entry = &entries[index];
+
+    if (entry == NULL)
+        entry = ChromeCache_Store(W, H, FillStyle, BackgroundStyle, draw, split, use_utf8);
+
+    Arena *scratch = Arena_Scratch();
+    ArenaMark mark = Arena_Mark(scratch);
+
+    char *bytes = NULL;
+    uint32_t *rowEnds = NULL;
+
+    if (entry != NULL) // a copy of its own, as the entry may be evicted by another thread once the lock is gone
+    {
+        entry->LastUse = ++useClock;
+
+        bytes = (char*)Arena_Alloc(scratch, entry->Size);
+        rowEnds = (uint32_t*)Arena_Alloc(scratch, H * sizeof(uint32_t));
+
+        if (bytes != NULL && rowEnds != NULL)
+        {
+            memcpy(bytes, entry->Bytes, entry->Size);
+            memcpy(rowEnds, entry->RowEnds, H * sizeof(uint32_t));
+        }
+    }
+
+    pthread_mutex_unlock(&cacheMutex);
+
+    if (bytes == NULL || rowEnds == NULL) // too big to keep ... draw it the usual way
+    {
+        BoxCanvas canvas;
+        BoxCanvas_CreateScratch(&canvas, X, Y, W, H);
+        canvas.FillStyle = FillStyle;
+        canvas.BackgroundStyle = BackgroundStyle;
+        draw(&canvas, split);
+        BoxCanvas_Render(&canvas);
+
+        Arena_Release(scratch, mark);
+        return;
+    }
+
+    Terminal_SaveCursorPosition(); // same as BoxCanvas_Render
+    Terminal_SetStyle(FillStyle, BackgroundStyle);
+
+    for (uint8_t row = 0; row < H; row++) // the rows are the same wherever the dialog is ... only the cursor movements depend on where it is
+    {
+        uint32_t rowStart = (row == 0) ? 0 : rowEnds[row - 1];
+
+        Terminal_SetCursorPosition(X, Y + row);
+        OutputSink_Print(bytes + rowStart, rowEnds[row] - rowStart);
+    }
+
+    Arena_Release(scratch, mark);
+    Terminal_RestoreCursorSavedPosition();
+}
@@ -0,0 +1,33 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+#ifndef _CHROME_CACHE_H_
+#define _CHROME_CACHE_H_
+
+#include <stdint.h>
+#include "boxcanvas.h"          // draws boxing using ascii/unicode characters
+
+// Keeps the encoded text of dialog frames, so a dialog that opens again with the same size and colors only prints what was encoded the first time
+
+#define CHROME_CACHE_ENTRIES    32          // frames kept at most ...
+#define CHROME_CACHE_MAX_BYTES  262144      // ... and the memory they may take (the least recently used ones go first)
+
+typedef void (*ChromeDrawer)(BoxCanvas *canvas, uint8_t split); // draws the boxes of a kind of dialog on an empty canvas of its size (and is what tells the kinds apart) ... split is the row a dialog of that kind is divided at, for the kinds whose parts change size (0 = none)
+
+void ChromeCache_Render(uint8_t X, uint8_t Y, uint8_t W, uint8_t H, ConsoleStyleText FillStyle, ConsoleStyleBackground BackgroundStyle, ChromeDrawer draw, uint8_t split); // same as rendering a canvas drawn by draw
+void ChromeCache_Clear(void);
+
+#endif // _CHROME_CACHE_H_
@@ -0,0 +1,247 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+#include "dirwatch.h"
+#include "arena.h"
+#include <stdio.h>
+#include <string.h>
+
+static size_t DirWatch_Find(const tinydir_dir *dir, const tinydir_file *file, uint8_t *found) // binary search in the sorted listing: where the file is, or where it belongs
+{
+    size_t first = 0, last = dir->n_files;
+    *found = 0;
+
+    while (first < last)
+    {
+        size_t middle = first + (last - first) / 2;
+        int order = _tinydir_file_cmp(&dir->_files[middle], file);
+
+        if (order == 0) // the comparison ignores case, so "Readme" and "README" sit in one run ... only the exact name is this file
+        {
+            size_t index = middle;
+            while (index > 0 && _tinydir_file_cmp(&dir->_files[index - 1], file) == 0)
+                index--;
+
+            for (; index < dir->n_files && _tinydir_file_cmp(&dir->_files[index], file) == 0; index++)
+            {
+                if (strcmp(dir->_files[index].name, file->name) == 0)
+                {
+                    *found = 1;
+                    return index;
+                }
+            }
+
+            return index; // a new spelling goes after the run
+        }
+
+        if (order < 0)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    return first;
+}
+
+static size_t DirWatch_InsertFile(DirWatch *watch, tinydir_dir *dir, const char *name, char *path, tinydir_file *file)
+{
+    if (snprintf(path, _TINYDIR_PATH_MAX, "%s/%s", dir->path, name) >= _TINYDIR_PATH_MAX)
+        return DIR_WATCH_NOT_FOUND; // too long for tinydir
+
+    if (tinydir_file_open(file, path) == -1)
+        return DIR_WATCH_NOT_FOUND; // already gone again
+
+    uint8_t found;
+    size_t index = DirWatch_Find(dir, file, &found);
+
+    if (found) // replaced by a rename ... the new one may be something else
+    {
+        memcpy(&dir->_files[index], file, sizeof(tinydir_file));
+        return index;
+    }
+
+    if (dir->_files != watch->Listing) // tinydir allocates the exact size, so a listing that was never grown here is full
+    {
+        watch->Listing = dir->_files;
+        watch->Capacity = dir->n_files;
+    }
+
+    if (dir->n_files == watch->Capacity) // there's no realloc in tinydir's allocator, so grow with some room for the next files
+    {
+        size_t capacity = dir->n_files + dir->n_files / 2 + 16;
+
+        tinydir_file *files = (tinydir_file *)_TINYDIR_MALLOC(sizeof(tinydir_file) * capacity);
+        if (files == NULL)
+            return DIR_WATCH_NOT_FOUND;
+
+        memcpy(files, dir->_files, sizeof(tinydir_file) * dir->n_files);
+        _TINYDIR_FREE(dir->_files);
+
+        dir->_files = files;
+        watch->Listing = files;
+        watch->Capacity = capacity;
+    }
+
+    memmove(&dir->_files[index + 1], &dir->_files[index], sizeof(tinydir_file) * (dir->n_files - index));
+    memcpy(&dir->_files[index], file, sizeof(tinydir_file));
+    dir->n_files++;
+
+    return index;
+}
+
+size_t DirWatch_Insert(DirWatch *watch, tinydir_dir *dir, const char *name)
+{
+    Arena *scratch = Arena_Scratch(); // a path and a file are kilobytes each ... not for the stack
+    ArenaMark mark = Arena_Mark(scratch);
+
+    char *path = (char*)Arena_Alloc(scratch, _TINYDIR_PATH_MAX);
+    tinydir_file *file = (tinydir_file*)Arena_Alloc(scratch, sizeof(tinydir_file));
+    size_t index = (path != NULL && file != NULL) ? DirWatch_InsertFile(watch, dir, name, path, file) : DIR_WATCH_NOT_FOUND;
+
+    Arena_Release(scratch, mark);
+    return index;
+}
+
+size_t DirWatch_Remove(tinydir_dir *dir, const char *name, uint8_t is_dir)
+{
+    Arena *scratch = Arena_Scratch();
+    ArenaMark mark = Arena_Mark(scratch);
+
+    tinydir_file *file = (tinydir_file*)Arena_Alloc(scratch, sizeof(tinydir_file)); // only what the comparison looks at
+    if (file == NULL)
+        return DIR_WATCH_NOT_FOUND;
+
+    strncpy(file->name, name, _TINYDIR_FILENAME_MAX - 1);
+    file->name[_TINYDIR_FILENAME_MAX - 1] = '\0';
+    file->is_dir = is_dir;
+
+    uint8_t found;
+    size_t index = DirWatch_Find(dir, file, &found);
+    Arena_Release(scratch, mark);
+
+    if (!found)
+        return DIR_WATCH_NOT_FOUND;
+
+    memmove(&dir->_files[index], &dir->_files[index + 1], sizeof(tinydir_file) * (dir->n_files - index - 1));
+    dir->n_files--;
+
+    return index;
+}
+
+#if defined(__linux__)
+
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <errno.h>
+
+uint8_t DirWatch_Open(DirWatch *watch, const char *path)
+{
+    watch->Listing = NULL;
+    watch->Capacity = 0;
+    watch->Length = 0;
+    watch->Offset = 0;
+    watch->Descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (watch->Descriptor < 0)
+        return 0;
+
+    if (inotify_add_watch(watch->Descriptor, path, IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR) < 0)
+    {
+        DirWatch_Close(watch);
+        return 0;
+    }
+
+    return 1;
+}
+
+void DirWatch_Close(DirWatch *watch)
+{
+    if (watch->Descriptor >= 0)
+        close(watch->Descriptor); // the watch goes away with it
+
+    watch->Descriptor = -1;
+}
+
+DirWatchChange DirWatch_Next(DirWatch *watch, char *name, uint8_t *is_dir)
+{
+    if (watch->Descriptor < 0)
+        return DIR_WATCH_NONE;
+
+    for (;;)
+    {
+        if (watch->Offset >= watch->Length) // everything that was read is consumed
+        {
+            ssize_t length = read(watch->Descriptor, watch->Buffer, sizeof(watch->Buffer));
+            if (length <= 0)
+                return DIR_WATCH_NONE; // EAGAIN: nothing else happened
+
+            watch->Length = length;
+            watch->Offset = 0;
+        }
+
+        const struct inotify_event *event = (const struct inotify_event *)((const char *)watch->Buffer + watch->Offset);
+        watch->Offset += sizeof(struct inotify_event) + event->len;
+
+        if (event->mask & (IN_Q_OVERFLOW | IN_DELETE_SELF | IN_MOVE_SELF))
+            return DIR_WATCH_RESCAN;
+
+        if (event->len == 0)
+            continue; // IN_IGNORED and such
+
+        strncpy(name, event->name, _TINYDIR_FILENAME_MAX - 1);
+        name[_TINYDIR_FILENAME_MAX - 1] = '\0';
+        *is_dir = (event->mask & IN_ISDIR) ? 1 : 0;
+
+        if (event->mask & (IN_CREATE | IN_MOVED_TO))
+            return DIR_WATCH_ADDED;
+
+        if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+            return DIR_WATCH_REMOVED;
+    }
+}
+
+#else // no notifications ... the listing is only read again when the directory is browsed again
+
+uint8_t DirWatch_Open(DirWatch *watch, const char *path)
+{
+    watch->Descriptor = -1;
+    watch->Listing = NULL;
+    watch->Capacity = 0;
+    watch->Length = 0;
+    watch->Offset = 0;
+    (void)path;
+
+    return 0;
+}
+
+void DirWatch_Close(DirWatch *watch)
+{
+    watch->Descriptor = -1;
+}
+
+DirWatchChange DirWatch_Next(DirWatch *watch, char *name, uint8_t *is_dir)
+{
+    (void)watch; (void)name; (void)is_dir;
+    return DIR_WATCH_NONE;
+}
+
+#endif
+
+int DirWatch_GetDescriptor(const DirWatch *watch)
+{
+    return watch->Descriptor;
+}
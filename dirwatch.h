@@ -0,0 +1,54 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+#ifndef _DIR_WATCH_H_
+#define _DIR_WATCH_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "tinydir.h"            // get this file at https://github.com/cxong/tinydir
+
+// Follows the files created, removed and renamed in a directory (inotify under Linux) and applies them to a sorted tinydir listing in place
+
+#define DIR_WATCH_BUFFER    4096        // bytes of notifications read at once
+#define DIR_WATCH_NOT_FOUND ((size_t)-1)
+
+typedef enum {
+    DIR_WATCH_NONE,         // nothing else happened
+    DIR_WATCH_ADDED,        // a file was created or moved into the directory
+    DIR_WATCH_REMOVED,      // a file was deleted or moved out of the directory
+    DIR_WATCH_RESCAN,       // notifications were lost (or the directory itself went away): read the whole listing again
+} DirWatchChange;
+
+typedef struct _DirWatch
+{
+    int Descriptor;
+    const tinydir_file *Listing; // the files array that was grown here ...
+    size_t Capacity;        // ... and how many files fit in it
+    size_t Length;          // of the notifications in the buffer
+    size_t Offset;          // of the next one
+    uint64_t Buffer[DIR_WATCH_BUFFER / sizeof(uint64_t)]; // aligned for the notification structures
+} DirWatch;
+
+uint8_t DirWatch_Open(DirWatch *watch, const char *path); // returns 0 if the directory cannot be watched (the watch is still safe to use, it just never reports anything)
+void DirWatch_Close(DirWatch *watch);
+int DirWatch_GetDescriptor(const DirWatch *watch); // becomes readable when something changed, so it can be polled together with the input (-1 if not watching)
+DirWatchChange DirWatch_Next(DirWatch *watch, char *name, uint8_t *is_dir); // returns the next change, and the file it happened to (name must hold _TINYDIR_FILENAME_MAX)
+
+size_t DirWatch_Insert(DirWatch *watch, tinydir_dir *dir, const char *name); // adds the file at its sorted place (or refreshes it, if it's there already) ... returns its index (open the watch again whenever the listing is read again)
+size_t DirWatch_Remove(tinydir_dir *dir, const char *name, uint8_t is_dir); // returns the index the file had
+
+#endif // _DIR_WATCH_H_
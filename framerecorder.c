@@ -0,0 +1,471 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+#include "framerecorder.h"
+#include "port_clock.h"
+#include "port_kbhit.h"         // the key codes
+#include "session.h"            // the terminal of each thread
+#include "terminalsize.h"
+#include "textwidth.h"          // the output is checked to be UTF-8 before it goes in the JSON
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static FrameRecorder *_Atomic activeRecorder = NULL;
+static atomic_uint writers = 0; // threads recording right now ... the rings are not freed while there are any
+
+static uint64_t FrameRecorder_PowerOfTwo(uint64_t value)
+{
+    uint64_t power = 1;
+    while (power < value)
+        power <<= 1;
+
+    return power;
+}
+
+uint8_t FrameRecorder_Start(FrameRecorder *recorder, int descriptor, size_t bytes, size_t events)
+{
+    memset(recorder, 0, sizeof(FrameRecorder));
+    uint64_t numBytes = FrameRecorder_PowerOfTwo((bytes > 0) ? bytes : FRAME_RECORDER_BYTES);
+    uint64_t numEvents = FrameRecorder_PowerOfTwo((events > 0) ? events : FRAME_RECORDER_EVENTS);
+
+    recorder->Descriptor = descriptor;
+    recorder->Bytes = (char*)malloc(numBytes);
+    recorder->BytesMask = numBytes - 1;
+    recorder->Events = (FrameRecorderEvent*)calloc(numEvents, sizeof(FrameRecorderEvent)); // all stamps 0: not written
+    recorder->EventsMask = numEvents - 1;
+
+    TerminalSize_Get(&recorder->Width, &recorder->Height);
+    if (recorder->Width == 0 || recorder->Height == 0) // not a terminal ... players need some size
+    {
+        recorder->Width = 80;
+        recorder->Height = 24;
+    }
+    recorder->StartTime = Clock_GetMicroseconds();
+    recorder->StartWallclock = (int64_t)time(NULL);
+
+    FrameRecorder *none = NULL;
+    if (recorder->Bytes == NULL || recorder->Events == NULL || !atomic_compare_exchange_strong(&activeRecorder, &none, recorder))
+    {
+        free(recorder->Bytes);
+        free(recorder->Events);
+        recorder->Bytes = NULL;
+        recorder->Events = NULL;
+        return 0;
+    }
+
+    return 1;
+}
+
+static FrameRecorder* FrameRecorder_Enter(int descriptor) // the recorder for the descriptor, if any ... FrameRecorder_Leave() after recording
+{
+    if (atomic_load_explicit(&activeRecorder, memory_order_relaxed) == NULL) // all it costs when nothing is recorded
+        return NULL;
+
+    atomic_fetch_add(&writers, 1); // before looking again, so Stop either sees the writer or the writer sees it stopped
+    FrameRecorder *recorder = atomic_load(&activeRecorder);
+
+    if (recorder == NULL || recorder->Descriptor != descriptor)
+    {
+        atomic_fetch_sub(&writers, 1);
+        return NULL;
+    }
+
+    return recorder;
+}
+
+static void FrameRecorder_Leave(void)
+{
+    atomic_fetch_sub_explicit(&writers, 1, memory_order_release);
+}
+
+static void FrameRecorder_Publish(FrameRecorder *recorder, FrameRecorderEventType type, uint64_t offset, uint32_t size)
+{
+    uint64_t time = Clock_GetMicroseconds() - recorder->StartTime;
+    uint64_t number = atomic_fetch_add_explicit(&recorder->EventsReserved, 1, memory_order_relaxed);
+    FrameRecorderEvent *event = &recorder->Events[number & recorder->EventsMask];
+
+    atomic_store_explicit(&event->Stamp, 0, memory_order_relaxed); // readers skip it from now on ...
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&event->Time, time, memory_order_relaxed);
+    atomic_store_explicit(&event->Offset, offset, memory_order_relaxed);
+    atomic_store_explicit(&event->Size, size, memory_order_relaxed);
+    atomic_store_explicit(&event->Type, (uint8_t)type, memory_order_relaxed);
+
+    atomic_store_explicit(&event->Stamp, number + 1, memory_order_release); // ... until it's complete
+}
+
+static void FrameRecorder_Copy(FrameRecorder *recorder, FrameRecorderEventType type, const char *buffer, size_t size)
+{
+    uint64_t capacity = recorder->BytesMask + 1;
+    if (size > capacity) // only the end of it fits
+    {
+        buffer += size - capacity;
+        size = capacity;
+    }
+
+    uint64_t offset = atomic_fetch_add_explicit(&recorder->BytesReserved, size, memory_order_relaxed);
+    uint64_t start = offset & recorder->BytesMask;
+    size_t first = (size_t)((start + size <= capacity) ? size : capacity - start); // the rest wraps around to the start of the ring
+
+    memcpy(&recorder->Bytes[start], buffer, first);
+    if (first < size)
+        memcpy(recorder->Bytes, &buffer[first], size - first);
+
+    FrameRecorder_Publish(recorder, type, offset, (uint32_t)size);
+}
+
+void FrameRecorder_Output(int descriptor, const char *buffer, size_t size)
+{
+    FrameRecorder *recorder = FrameRecorder_Enter(descriptor);
+    if (recorder == NULL)
+        return;
+
+    FrameRecorder_Copy(recorder, FRAME_RECORDER_OUTPUT, buffer, size);
+    FrameRecorder_Leave();
+}
+
+void FrameRecorder_Frame(int descriptor, uint64_t writeMicroseconds)
+{
+    FrameRecorder *recorder = FrameRecorder_Enter(descriptor);
+    if (recorder == NULL)
+        return;
+
+    FrameRecorder_Publish(recorder, FRAME_RECORDER_FRAME, atomic_load_explicit(&recorder->BytesReserved, memory_order_relaxed), (uint32_t)writeMicroseconds);
+    FrameRecorder_Leave();
+}
+
+void FrameRecorder_Key(char key)
+{
+    FrameRecorder *recorder = FrameRecorder_Enter(Session_Current()->OutputDescriptor);
+    if (recorder == NULL)
+        return;
+
+    const char *sequence;
+    switch (key) // back to what the terminal sent
+    {
+        case KEY_ARROW_UP:      sequence = "\x1b[A";    break;
+        case KEY_ARROW_DOWN:    sequence = "\x1b[B";    break;
+        case KEY_ARROW_RIGHT:   sequence = "\x1b[C";    break;
+        case KEY_ARROW_LEFT:    sequence = "\x1b[D";    break;
+        case KEY_PAGE_UP:       sequence = "\x1b[5~";   break;
+        case KEY_PAGE_DOWN:     sequence = "\x1b[6~";   break;
+        case KEY_ENTER:         // the terminal sent a carriage return ... the line discipline made it a new line
+        case KEY_RETURN:        sequence = "\r";        break;
+        case KEY_BACKSPACE:     sequence = "\x7f";      break; // windows reports '\b'
+        default:                sequence = NULL;        break;
+    }
+
+    if (sequence != NULL)
+        FrameRecorder_Copy(recorder, FRAME_RECORDER_INPUT, sequence, strlen(sequence));
+    else
+        FrameRecorder_Copy(recorder, FRAME_RECORDER_INPUT, &key, 1);
+
+    FrameRecorder_Leave();
+}
+
+// DUMPING
+// =================================================================
+
+static uint8_t FrameRecorder_Incomplete(const char *text, size_t length) // the start of a character whose other bytes are in the next write
+{
+    unsigned char lead = (unsigned char)text[0];
+    size_t needed = (lead >= 0xC2 && lead <= 0xDF) ? 2 : (lead >= 0xE0 && lead <= 0xEF) ? 3 : (lead >= 0xF0 && lead <= 0xF4) ? 4 : 0;
+
+    if (needed <= length)
+        return 0;
+
+    for (size_t index = 1; index < length; index++)
+        if (((unsigned char)text[index] & 0xC0) != 0x80)
+            return 0;
+
+    return 1;
+}
+
+static size_t FrameRecorder_WriteJson(FILE *file, const char *text, size_t length) // a JSON string of the bytes ... returns how many bytes at the end were left for the next write (the start of a character)
+{
+    fputc('"', file);
+
+    for (size_t index = 0; index < length; index++)
+    {
+        unsigned char ch = (unsigned char)text[index];
+
+        if (ch == '"' || ch == '\\')
+            fprintf(file, "\\%c", ch);
+        else if (ch < 0x20 || ch == 0x7F)
+            fprintf(file, "\\u%04x", ch);
+        else if (ch < 0x80)
+            fputc(ch, file);
+        else
+        {
+            uint32_t codepoint;
+            size_t size = TextWidth_Decode(&text[index], length - index, &codepoint);
+
+            if (size > 0)
+            {
+                fwrite(&text[index], sizeof(char), size, file);
+                index += size - 1;
+            }
+            else if (FrameRecorder_Incomplete(&text[index], length - index))
+            {
+                fputc('"', file);
+                return length - index;
+            }
+            else
+                fputs("\\ufffd", file); // not UTF-8, which JSON must be
+        }
+    }
+
+    fputc('"', file);
+    return 0;
+}
+
+static uint8_t FrameRecorder_ReadEvent(FrameRecorder *recorder, uint64_t number, FrameRecorderRecord *copy, char *data) // returns 0 if the event (or its bytes) was overwritten, or is still being written
+{
+    FrameRecorderEvent *event = &recorder->Events[number & recorder->EventsMask];
+
+    if (atomic_load_explicit(&event->Stamp, memory_order_acquire) != number + 1)
+        return 0;
+
+    copy->Time = atomic_load_explicit(&event->Time, memory_order_relaxed);
+    copy->Offset = atomic_load_explicit(&event->Offset, memory_order_relaxed);
+    copy->Size = atomic_load_explicit(&event->Size, memory_order_relaxed);
+    copy->Type = atomic_load_explicit(&event->Type, memory_order_relaxed);
+
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&event->Stamp, memory_order_relaxed) != number + 1)
+        return 0;
+
+    if (copy->Type == FRAME_RECORDER_FRAME)
+        return 1;
+
+    uint64_t capacity = recorder->BytesMask + 1;
+    uint64_t start = copy->Offset & recorder->BytesMask;
+    size_t first = (size_t)((start + copy->Size <= capacity) ? copy->Size : capacity - start);
+
+    memcpy(data, &recorder->Bytes[start], first);
+    memcpy(&data[first], recorder->Bytes, copy->Size - first);
+
+    atomic_thread_fence(memory_order_acquire);
+    return (atomic_load_explicit(&recorder->BytesReserved, memory_order_relaxed) <= copy->Offset + capacity); // nothing was written over them meanwhile
+}
+
+uint8_t FrameRecorder_Dump(FrameRecorder *recorder, const char *path)
+{
+    size_t pathLength = strlen(path);
+    char *framesPath = (char*)malloc(pathLength + sizeof(".frames"));
+    char *data = (char*)malloc(recorder->BytesMask + 1 + 4); // one event, after what was left of the last one
+    if (framesPath == NULL || data == NULL)
+    {
+        free(framesPath);
+        free(data);
+        return 0;
+    }
+
+    sprintf(framesPath, "%s.frames", path);
+    FILE *cast = fopen(path, "wb");
+    FILE *frames = fopen(framesPath, "wb");
+
+    if (cast != NULL && frames != NULL)
+    {
+        const char *term = getenv("TERM");
+        fprintf(cast, "{\"version\": 2, \"width\": %u, \"height\": %u, \"timestamp\": %lld, \"env\": {\"TERM\": ", recorder->Width, recorder->Height, (long long)recorder->StartWallclock);
+        FrameRecorder_WriteJson(cast, (term != NULL) ? term : "", (term != NULL) ? strlen(term) : 0);
+        fprintf(cast, "}}\n");
+        fprintf(frames, "# frame\ttime [us]\tbytes\twrite [us]\n");
+
+        uint64_t last = atomic_load_explicit(&recorder->EventsReserved, memory_order_acquire);
+        uint64_t first = (last > recorder->EventsMask + 1) ? last - (recorder->EventsMask + 1) : 0;
+        uint64_t lost = 0, time = 0, frameBytes = 0, frameNumber = 0;
+        size_t carried = 0; // the start of a character, from the end of the last write
+
+        for (uint64_t number = first; number < last; number++)
+        {
+            FrameRecorderRecord event;
+            if (!FrameRecorder_ReadEvent(recorder, number, &event, &data[4]))
+            {
+                lost++;
+                carried = 0;
+                continue;
+            }
+
+            time = (event.Time > time) ? event.Time : time; // the threads may have taken their times out of order
+
+            if (event.Type == FRAME_RECORDER_FRAME)
+            {
+                fprintf(frames, "%llu\t%llu\t%llu\t%u\n", (unsigned long long)frameNumber++, (unsigned long long)time, (unsigned long long)frameBytes, event.Size);
+                frameBytes = 0;
+                continue;
+            }
+
+            char *text = &data[4];
+            size_t length = event.Size;
+
+            if (event.Type == FRAME_RECORDER_OUTPUT)
+            {
+                frameBytes += length;
+                text -= carried; // still there, just before the new bytes
+                length += carried;
+            }
+
+            fprintf(cast, "[%llu.%06llu, \"%c\", ", (unsigned long long)(time / 1000000), (unsigned long long)(time % 1000000), event.Type);
+            size_t left = FrameRecorder_WriteJson(cast, text, length);
+            fprintf(cast, "]\n");
+
+            if (event.Type == FRAME_RECORDER_OUTPUT)
+            {
+                memmove(&data[4 - left], &text[length - left], left);
+                carried = left;
+            }
+        }
+
+        if (lost > 0)
+            fprintf(frames, "# %llu events were overwritten or still being written\n", (unsigned long long)lost);
+    }
+
+    uint8_t written = (cast != NULL && frames != NULL);
+    if (cast != NULL && fclose(cast) != 0)
+        written = 0;
+    if (frames != NULL && fclose(frames) != 0)
+        written = 0;
+
+    free(framesPath);
+    free(data);
+    return written;
+}
+
+// DUMPING ON A SIGNAL
+// =================================================================
+
+#if defined(unix) || defined(__unix__) || defined(__unix)
+
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+
+static int signalPipe[2] = { -1, -1 }; // the handler only writes a byte: the thread does the dumping
+static struct sigaction signalPrevious;
+
+static void FrameRecorder_SignalHandler(int signalNumber)
+{
+    int savedErrno = errno;
+    char byte = (char)signalNumber;
+
+    if (write(signalPipe[1], &byte, 1) < 0)
+        (void)0; // already one waiting
+
+    errno = savedErrno;
+}
+
+static void* FrameRecorder_SignalThread(void *argument)
+{
+    FrameRecorder *recorder = (FrameRecorder*)argument;
+    char byte;
+    ssize_t got;
+
+    while ((got = read(signalPipe[0], &byte, 1)) != 0) // until the pipe is closed by Stop
+    {
+        if (got < 0 && errno != EINTR)
+            break;
+
+        if (got > 0)
+            FrameRecorder_Dump(recorder, recorder->SignalPath);
+    }
+
+    return NULL;
+}
+
+uint8_t FrameRecorder_DumpOnSignal(FrameRecorder *recorder, int signalNumber, const char *path)
+{
+    if (recorder->SignalNumber != 0 || signalPipe[0] != -1 || pipe(signalPipe) != 0)
+        return 0;
+
+    recorder->SignalPath = strdup(path);
+    recorder->SignalNumber = signalNumber;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = FrameRecorder_SignalHandler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    if (recorder->SignalPath == NULL || pthread_create(&recorder->SignalThread, NULL, FrameRecorder_SignalThread, recorder) != 0)
+    {
+        close(signalPipe[0]);
+        close(signalPipe[1]);
+        signalPipe[0] = signalPipe[1] = -1;
+        free(recorder->SignalPath);
+        recorder->SignalPath = NULL;
+        recorder->SignalNumber = 0;
+        return 0;
+    }
+
+    sigaction(signalNumber, &action, &signalPrevious);
+    return 1;
+}
+
+static void FrameRecorder_StopSignal(FrameRecorder *recorder)
+{
+    if (recorder->SignalNumber == 0)
+        return;
+
+    sigaction(recorder->SignalNumber, &signalPrevious, NULL);
+
+    close(signalPipe[1]); // the thread finishes the dump it's in, and ends
+    pthread_join(recorder->SignalThread, NULL);
+    close(signalPipe[0]);
+    signalPipe[0] = signalPipe[1] = -1;
+
+    free(recorder->SignalPath);
+    recorder->SignalPath = NULL;
+    recorder->SignalNumber = 0;
+}
+
+#else
+
+uint8_t FrameRecorder_DumpOnSignal(FrameRecorder *recorder, int signalNumber, const char *path)
+{
+    (void)recorder; // there are no signals to ask for it with
+    (void)signalNumber;
+    (void)path;
+    return 0;
+}
+
+static void FrameRecorder_StopSignal(FrameRecorder *recorder)
+{
+    (void)recorder;
+}
+
+#endif
+
+void FrameRecorder_Stop(FrameRecorder *recorder)
+{
+    FrameRecorder_StopSignal(recorder);
+
+    FrameRecorder *self = recorder;
+    if (!atomic_compare_exchange_strong(&activeRecorder, &self, NULL))
+        return; // was not recording
+
+    while (atomic_load(&writers) > 0) // a write that saw it on still copies into the rings
+        Clock_SleepMicroseconds(100);
+
+    free(recorder->Bytes);
+    free(recorder->Events);
+    recorder->Bytes = NULL;
+    recorder->Events = NULL;
+}
@@ -0,0 +1,90 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+#ifndef _FRAME_RECORDER_H_
+#define _FRAME_RECORDER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+// Keeps the last frames written to a terminal, and the keys read from it, so what an operator saw can be looked at afterwards
+// The output sink copies each write into a ring of bytes (one memcpy) and notes it in a ring of events; nothing is locked, and the oldest frames are overwritten
+// Only the terminal of one descriptor is recorded, by one recorder at a time; while none is recording, the sink pays a single load of a pointer
+// The sink sees the terminal of the process only once it is installed: call OutputSink_Install() before starting, or only the sessions and the writes that bypass stdio are recorded
+//
+// FrameRecorder_Dump writes what is kept as an asciicast v2 file ("o" for the output, "i" for the keys), and the timing of each frame next to it (path + ".frames")
+
+#define FRAME_RECORDER_BYTES        (1 << 22)   // output kept, if not told otherwise (rounded up to a power of two)
+#define FRAME_RECORDER_EVENTS       (1 << 14)   // writes and keys kept, if not told otherwise (same)
+#define FRAME_RECORDER_ENVIRONMENT  "BOXCANVAS_RECORD" // the file boxdialog records to, when set
+
+typedef enum {
+    FRAME_RECORDER_OUTPUT = 'o',    // bytes written to the terminal
+    FRAME_RECORDER_INPUT = 'i',     // a key read from it (as the sequence the terminal sends for it)
+    FRAME_RECORDER_FRAME = 'f',     // the end of a write ... Size is how long it took [us]
+} FrameRecorderEventType;
+
+typedef struct _FrameRecorderEvent // the fields are atomic only so a dump may read them while they are overwritten (and then throw them away)
+{
+    atomic_uint_fast64_t Stamp;     // the number of the event + 1 once it's written (anything else while it's being written)
+    atomic_uint_fast64_t Time;      // [us] since the recording started
+    atomic_uint_fast64_t Offset;    // of the bytes, counted from the start of the recording (the ring holds the last of them)
+    atomic_uint Size;
+    atomic_uchar Type;              // FrameRecorderEventType
+} FrameRecorderEvent;
+
+typedef struct _FrameRecorderRecord // an event as it was read
+{
+    uint64_t Time;
+    uint64_t Offset;
+    uint32_t Size;
+    uint8_t Type;
+} FrameRecorderRecord;
+
+typedef struct _FrameRecorder
+{
+    int Descriptor;                 // of the terminal that is recorded
+    uint8_t Width;                  // of that terminal, as the recording started
+    uint8_t Height;
+    uint64_t StartTime;             // [us] Clock_GetMicroseconds()
+    int64_t StartWallclock;         // [s] since the epoch
+
+    char *Bytes;
+    uint64_t BytesMask;             // size - 1
+    atomic_uint_fast64_t BytesReserved;     // ever
+    FrameRecorderEvent *Events;
+    uint64_t EventsMask;
+    atomic_uint_fast64_t EventsReserved;    // ever
+
+    // dumping on a signal
+    int SignalNumber;               // 0 = none
+    char *SignalPath;
+    pthread_t SignalThread;
+} FrameRecorder;
+
+uint8_t FrameRecorder_Start(FrameRecorder *recorder, int descriptor, size_t bytes, size_t events); // records what goes to descriptor (0 bytes or events = the defaults) ... returns 0 if out of memory, or if another recorder is on
+void FrameRecorder_Stop(FrameRecorder *recorder); // waits for the writes being recorded, then frees the rings
+uint8_t FrameRecorder_Dump(FrameRecorder *recorder, const char *path); // safe while recording ... returns 0 if the files cannot be written
+uint8_t FrameRecorder_DumpOnSignal(FrameRecorder *recorder, int signalNumber, const char *path); // a thread dumps to path whenever the signal arrives (UNIX only, returns 0 elsewhere)
+
+// recording (used by the library)
+void FrameRecorder_Output(int descriptor, const char *buffer, size_t size);
+void FrameRecorder_Frame(int descriptor, uint64_t writeMicroseconds);
+void FrameRecorder_Key(char key); // on the terminal of the calling thread
+
+#endif // _FRAME_RECORDER_H_
@@ -0,0 +1,134 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+#include "framescheduler.h"
+#include "port_kbhit.h"         // portable kbhit and getch functions
+#include "port_clock.h"         // monotonic time
+#include "syncupdate.h"         // atomic repaint of each frame
+#include "terminalsize.h"       // cached terminal size and resize notifications
+#include "outputsink.h"         // measures what is written
+#include "renderstats.h"        // counters
+#include <stdio.h>
+
+static uint16_t defaultRate = FRAME_SCHEDULER_DEFAULT_RATE;
+
+void FrameScheduler_SetDefaultRate(uint16_t framesPerSecond)
+{
+    defaultRate = (framesPerSecond == 0) ? FRAME_SCHEDULER_DEFAULT_RATE : framesPerSecond;
+}
+
+void FrameScheduler_Create(FrameScheduler *scheduler, uint16_t framesPerSecond)
+{
+    if (framesPerSecond == 0)
+        framesPerSecond = defaultRate;
+
+    scheduler->FrameInterval = 1000000 / framesPerSecond;
+    scheduler->LastPresent = 0;
+    scheduler->DirtySince = Clock_GetMicroseconds();
+    scheduler->Dirty = 1; // nothing was drawn yet, so the first frame is always due
+    scheduler->ResizeDescriptor = TerminalSize_GetDescriptor();
+    scheduler->WatchDescriptor = -1;
+}
+
+void FrameScheduler_Watch(FrameScheduler *scheduler, int descriptor)
+{
+    scheduler->WatchDescriptor = descriptor;
+}
+
+void FrameScheduler_Invalidate(FrameScheduler *scheduler)
+{
+    if (scheduler->Dirty)
+        return; // keep the time of the first change, that's what the latency is measured against
+
+    scheduler->Dirty = 1;
+    scheduler->DirtySince = Clock_GetMicroseconds();
+}
+
+FrameEvent FrameScheduler_Wait(FrameScheduler *scheduler)
+{
+    for (;;)
+    {
+        if (TerminalSize_Changed())
+            return FRAME_EVENT_RESIZE;
+
+        uint32_t timeout = KBHIT_WAIT_FOREVER; // nothing to draw ... just sleep until there's a key
+        uint64_t due = 0;
+
+        if (scheduler->Dirty)
+        {
+            if (scheduler->LastPresent == 0) // the dialog must show up before it starts consuming keys
+                return FRAME_EVENT_PRESENT;
+
+            uint64_t now = Clock_GetMicroseconds();
+            due = scheduler->LastPresent + scheduler->FrameInterval;
+
+            // keys that already arrived are consumed before drawing, so a burst of keys (key repeat, pasting, slow links) costs one frame instead of one frame per key ...
+            // ... unless the burst is so long that the user would stop seeing any feedback
+            if (now - scheduler->DirtySince < (uint64_t)scheduler->FrameInterval * FRAME_SCHEDULER_MAX_LATENCY && kbhit())
+                return FRAME_EVENT_INPUT;
+
+            if (now >= due)
+                return FRAME_EVENT_PRESENT;
+
+            timeout = due - now; // too early to draw: use the remaining time to wait for more input
+        }
+
+        if (scheduler->ResizeDescriptor < 0 && timeout > FRAME_SCHEDULER_RESIZE_POLL)
+            timeout = FRAME_SCHEDULER_RESIZE_POLL; // nobody will wake us up on resize, so check the size now and then
+
+        int descriptors[2];
+        uint8_t numDescriptors = 0, watchReady = 0;
+
+        if (scheduler->WatchDescriptor >= 0)
+        {
+            descriptors[numDescriptors++] = scheduler->WatchDescriptor;
+            watchReady = 2; // the first one ... see kbhitWaitDescriptors
+        }
+
+        if (scheduler->ResizeDescriptor >= 0)
+            descriptors[numDescriptors++] = scheduler->ResizeDescriptor;
+
+        char ready = kbhitWaitDescriptors(timeout, descriptors, numDescriptors);
+
+        if (ready == 1)
+            return FRAME_EVENT_INPUT;
+
+        if (ready != 0 && ready == watchReady)
+            return FRAME_EVENT_WATCH;
+
+        if (ready == 0 && scheduler->Dirty && Clock_GetMicroseconds() >= due)
+            return FRAME_EVENT_PRESENT;
+
+        // otherwise the size changed (or may have changed) ... check again
+    }
+}
+
+void FrameScheduler_BeginFrame(FrameScheduler *scheduler)
+{
+    (void)scheduler;
+    SyncUpdate_Begin(); // the terminal holds the repaint until the frame is complete
+}
+
+void FrameScheduler_EndFrame(FrameScheduler *scheduler)
+{
+    SyncUpdate_End();
+    OutputSink_Flush(); // push the whole frame to the terminal at once
+    RenderStats_Count(RENDER_COUNTER_FRAMES, 1);
+
+    scheduler->Dirty = 0;
+    scheduler->LastPresent = Clock_GetMicroseconds();
+}
@@ -0,0 +1,52 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+#ifndef _FRAME_SCHEDULER_H_
+#define _FRAME_SCHEDULER_H_
+
+#include <stdint.h>
+
+#define FRAME_SCHEDULER_DEFAULT_RATE    60  // frames per second
+#define FRAME_SCHEDULER_MAX_LATENCY     4   // frame intervals the input may delay a dirty frame before it is presented anyway
+#define FRAME_SCHEDULER_RESIZE_POLL     250000 // [us] how often the size is checked where the terminal does not notify resizes
+
+typedef enum {
+    FRAME_EVENT_INPUT,      // a key is waiting to be read with getchNavigation()
+    FRAME_EVENT_PRESENT,    // the frame is dirty and it's time to draw it
+    FRAME_EVENT_RESIZE,     // the terminal size changed: get the new one with TerminalSize_Get() and redo the layout
+    FRAME_EVENT_WATCH,      // the descriptor given to FrameScheduler_Watch() can be read
+} FrameEvent;
+
+typedef struct _FrameScheduler
+{
+    uint32_t FrameInterval;     // minimum time between two presented frames [us]
+    uint64_t LastPresent;       // when the last frame was finished [us]
+    uint64_t DirtySince;        // when the first change after the last frame happened [us]
+    uint8_t Dirty;
+    int ResizeDescriptor;       // woken up by the terminal size change notifications
+    int WatchDescriptor;        // woken up by the caller's own notifications (-1 for none)
+} FrameScheduler;
+
+void FrameScheduler_SetDefaultRate(uint16_t framesPerSecond);
+void FrameScheduler_Create(FrameScheduler *scheduler, uint16_t framesPerSecond); // 0 framesPerSecond means "default rate"
+void FrameScheduler_Watch(FrameScheduler *scheduler, int descriptor); // -1 stops watching
+void FrameScheduler_Invalidate(FrameScheduler *scheduler);
+FrameEvent FrameScheduler_Wait(FrameScheduler *scheduler);
+void FrameScheduler_BeginFrame(FrameScheduler *scheduler);
+void FrameScheduler_EndFrame(FrameScheduler *scheduler);
+
+#endif // _FRAME_SCHEDULER_H_
@@ -0,0 +1,412 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+#include "lineindex.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(unix) || defined(__unix__) || defined(__unix)
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#elif (defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN32__))
+    #include <windows.h>
+#endif
+
+// MAPPING
+// =================================================================
+
+static uint8_t LineIndex_Map(LineIndex *index, const char *path)
+{
+    #if defined(unix) || defined(__unix__) || defined(__unix)
+        int fd = open(path, O_RDONLY);
+        if (fd == -1)
+            return 0;
+
+        struct stat info;
+        if (fstat(fd, &info) == -1 || !S_ISREG(info.st_mode))
+        {
+            close(fd);
+            return 0;
+        }
+
+        index->Size = (uint64_t)info.st_size;
+        index->Data = NULL;
+
+        if (index->Size > 0) // an empty file cannot be mapped, and there's nothing to show anyway
+        {
+            void *data = mmap(NULL, (size_t)index->Size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED)
+            {
+                close(fd);
+                return 0;
+            }
+
+            index->Data = (const char*)data;
+        }
+
+        close(fd); // the mapping keeps the file
+        return 1;
+    #elif (defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN32__))
+        index->FileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        index->MappingHandle = NULL;
+        index->Data = NULL;
+
+        if (index->FileHandle == INVALID_HANDLE_VALUE)
+            return 0;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(index->FileHandle, &size))
+        {
+            CloseHandle(index->FileHandle);
+            return 0;
+        }
+
+        index->Size = (uint64_t)size.QuadPart;
+
+        if (index->Size > 0)
+        {
+            index->MappingHandle = CreateFileMappingA(index->FileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (index->MappingHandle != NULL)
+                index->Data = (const char*)MapViewOfFile(index->MappingHandle, FILE_MAP_READ, 0, 0, 0);
+
+            if (index->Data == NULL)
+            {
+                if (index->MappingHandle != NULL)
+                    CloseHandle(index->MappingHandle);
+
+                CloseHandle(index->FileHandle);
+                return 0;
+            }
+        }
+
+        return 1;
+    #else
+        (void)index;
+        (void)path;
+        return 0;
+    #endif
+}
+
+static void LineIndex_Unmap(LineIndex *index)
+{
+    #if defined(unix) || defined(__unix__) || defined(__unix)
+        if (index->Data != NULL)
+            munmap((void*)index->Data, (size_t)index->Size);
+    #elif (defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN32__))
+        if (index->Data != NULL)
+            UnmapViewOfFile(index->Data);
+
+        if (index->MappingHandle != NULL)
+            CloseHandle(index->MappingHandle);
+
+        CloseHandle(index->FileHandle);
+    #endif
+
+    index->Data = NULL;
+}
+
+// INDEXING
+// =================================================================
+
+static void LineIndex_Notify(LineIndex *index)
+{
+    #if defined(unix) || defined(__unix__) || defined(__unix)
+        if (index->ProgressPipe[1] != -1 && write(index->ProgressPipe[1], "", 1) == -1)
+            (void)0; // pipe full: the viewer has not caught up with the last update yet
+    #else
+        (void)index;
+    #endif
+}
+
+static uint8_t LineIndex_AddCheckpoint(LineIndex *index, uint64_t offset)
+{
+    pthread_mutex_lock(&index->Mutex);
+
+    if (index->NumCheckpoints == index->Capacity)
+    {
+        uint64_t capacity = index->Capacity * 2;
+        uint64_t *checkpoints = (uint64_t*)realloc(index->Checkpoints, capacity * sizeof(uint64_t));
+
+        if (checkpoints == NULL)
+        {
+            pthread_mutex_unlock(&index->Mutex);
+            return 0;
+        }
+
+        index->Checkpoints = checkpoints;
+        index->Capacity = capacity;
+    }
+
+    index->Checkpoints[index->NumCheckpoints++] = offset;
+
+    pthread_mutex_unlock(&index->Mutex);
+    return 1;
+}
+
+static void* LineIndex_Thread(void *arg)
+{
+    LineIndex *index = (LineIndex*)arg;
+    uint64_t offset = 0;
+    uint64_t lines = 0;
+
+    while (offset < index->Size && !atomic_load(&index->Cancel))
+    {
+        uint64_t end = offset + LINE_INDEX_CHUNK;
+        if (end > index->Size)
+            end = index->Size;
+
+        const char *position = index->Data + offset;
+        const char *chunkEnd = index->Data + end;
+
+        while ((position = (const char*)memchr(position, '\n', (size_t)(chunkEnd - position))) != NULL)
+        {
+            position++;
+            lines++;
+
+            if (lines % LINE_INDEX_STRIDE == 0 && position < index->Data + index->Size)
+                if (!LineIndex_AddCheckpoint(index, (uint64_t)(position - index->Data)))
+                    atomic_store(&index->Cancel, 1); // out of memory: stop here, the lines after are found by scanning
+        }
+
+        offset = end;
+        atomic_store(&index->IndexedLines, lines);
+        atomic_store(&index->IndexedBytes, offset);
+
+        LineIndex_Notify(index);
+    }
+
+    if (offset == index->Size)
+    {
+        if (index->Size > 0 && index->Data[index->Size - 1] != '\n')
+            atomic_store(&index->IndexedLines, lines + 1); // the last line has no line break
+
+        atomic_store(&index->Complete, 1);
+        LineIndex_Notify(index);
+    }
+
+    return NULL;
+}
+
+// PUBLIC API
+// =================================================================
+
+uint8_t LineIndex_Open(LineIndex *index, const char *path)
+{
+    memset(index, 0, sizeof(LineIndex));
+    index->ProgressPipe[0] = index->ProgressPipe[1] = -1;
+
+    if (!LineIndex_Map(index, path))
+        return 0;
+
+    index->Capacity = 256;
+    index->Checkpoints = (uint64_t*)malloc(index->Capacity * sizeof(uint64_t));
+    if (index->Checkpoints == NULL)
+    {
+        LineIndex_Unmap(index);
+        return 0;
+    }
+
+    index->Checkpoints[0] = 0;
+    index->NumCheckpoints = 1;
+    pthread_mutex_init(&index->Mutex, NULL);
+
+    #if defined(unix) || defined(__unix__) || defined(__unix)
+        if (pipe(index->ProgressPipe) == 0)
+        {
+            fcntl(index->ProgressPipe[0], F_SETFL, fcntl(index->ProgressPipe[0], F_GETFL) | O_NONBLOCK);
+            fcntl(index->ProgressPipe[1], F_SETFL, fcntl(index->ProgressPipe[1], F_GETFL) | O_NONBLOCK);
+        }
+        else
+            index->ProgressPipe[0] = index->ProgressPipe[1] = -1;
+    #endif
+
+    if (index->Size == 0)
+        atomic_store(&index->Complete, 1);
+    else
+        index->ThreadStarted = (pthread_create(&index->Thread, NULL, LineIndex_Thread, index) == 0); // without it, lines are found by scanning from the start
+
+    return 1;
+}
+
+void LineIndex_Close(LineIndex *index)
+{
+    if (index->ThreadStarted)
+    {
+        atomic_store(&index->Cancel, 1);
+        pthread_join(index->Thread, NULL);
+    }
+
+    #if defined(unix) || defined(__unix__) || defined(__unix)
+        if (index->ProgressPipe[0] != -1)
+        {
+            close(index->ProgressPipe[0]);
+            close(index->ProgressPipe[1]);
+        }
+    #endif
+
+    pthread_mutex_destroy(&index->Mutex);
+    free(index->Checkpoints);
+    LineIndex_Unmap(index);
+
+    memset(index, 0, sizeof(LineIndex));
+    index->ProgressPipe[0] = index->ProgressPipe[1] = -1;
+}
+
+int LineIndex_GetDescriptor(const LineIndex *index)
+{
+    return index->ProgressPipe[0];
+}
+
+void LineIndex_Drain(LineIndex *index)
+{
+    #if defined(unix) || defined(__unix__) || defined(__unix)
+        char buffer[64];
+
+        if (index->ProgressPipe[0] != -1)
+            while (read(index->ProgressPipe[0], buffer, sizeof(buffer)) > 0)
+                (void)0;
+    #else
+        (void)index;
+    #endif
+}
+
+uint64_t LineIndex_Lines(LineIndex *index, uint8_t *complete)
+{
+    if (complete != NULL)
+        *complete = atomic_load(&index->Complete);
+
+    return atomic_load(&index->IndexedLines);
+}
+
+static uint64_t LineIndex_CountLines(const LineIndex *index, uint64_t from, uint64_t to) // line breaks in [from, to)
+{
+    uint64_t count = 0;
+    const char *position = index->Data + from;
+    const char *end = index->Data + to;
+
+    while (position < end && (position = (const char*)memchr(position, '\n', (size_t)(end - position))) != NULL)
+    {
+        position++;
+        count++;
+    }
+
+    return count;
+}
+
+uint64_t LineIndex_Seek(LineIndex *index, uint64_t line)
+{
+    pthread_mutex_lock(&index->Mutex);
+
+    uint64_t checkpoint = line / LINE_INDEX_STRIDE;
+    if (checkpoint >= index->NumCheckpoints)
+        checkpoint = index->NumCheckpoints - 1; // not indexed yet: scan from the furthest one known
+
+    uint64_t offset = index->Checkpoints[checkpoint];
+
+    pthread_mutex_unlock(&index->Mutex);
+
+    for (uint64_t remaining = line - checkpoint * LINE_INDEX_STRIDE; remaining > 0 && offset < index->Size; remaining--)
+        offset = LineIndex_NextLine(index, offset);
+
+    return (offset < index->Size || (line == 0)) ? offset : LINE_INDEX_NOT_FOUND;
+}
+
+uint64_t LineIndex_LineOf(LineIndex *index, uint64_t offset)
+{
+    pthread_mutex_lock(&index->Mutex);
+
+    uint64_t first = 0, last = index->NumCheckpoints; // find the last checkpoint at or before the offset
+    while (last - first > 1)
+    {
+        uint64_t middle = first + (last - first) / 2;
+
+        if (index->Checkpoints[middle] <= offset)
+            first = middle;
+        else
+            last = middle;
+    }
+
+    uint64_t start = index->Checkpoints[first];
+
+    pthread_mutex_unlock(&index->Mutex);
+
+    return first * LINE_INDEX_STRIDE + LineIndex_CountLines(index, start, offset);
+}
+
+uint64_t LineIndex_NextLine(const LineIndex *index, uint64_t offset)
+{
+    if (offset >= index->Size)
+        return index->Size;
+
+    const char *lineBreak = (const char*)memchr(index->Data + offset, '\n', (size_t)(index->Size - offset));
+
+    return (lineBreak == NULL) ? index->Size : (uint64_t)(lineBreak - index->Data) + 1;
+}
+
+uint64_t LineIndex_LineStart(const LineIndex *index, uint64_t offset)
+{
+    if (offset > index->Size)
+        offset = index->Size;
+
+    while (offset > 0 && index->Data[offset - 1] != '\n')
+        offset--;
+
+    return offset;
+}
+
+uint64_t LineIndex_PreviousLine(const LineIndex *index, uint64_t offset)
+{
+    return (offset == 0) ? 0 : LineIndex_LineStart(index, offset - 1); // step over the line break that ends the previous line
+}
+
+static uint64_t LineIndex_Find(const LineIndex *index, uint64_t from, uint64_t to, const char *text, size_t length) // first occurrence that starts in [from, to)
+{
+    if (to > index->Size - length + 1)
+        to = index->Size - length + 1;
+
+    const char *position = index->Data + from;
+    const char *end = index->Data + to;
+
+    while (position < end && (position = (const char*)memchr(position, text[0], (size_t)(end - position))) != NULL)
+    {
+        if (memcmp(position, text, length) == 0)
+            return (uint64_t)(position - index->Data);
+
+        position++;
+    }
+
+    return LINE_INDEX_NOT_FOUND;
+}
+
+uint64_t LineIndex_Search(const LineIndex *index, uint64_t from, const char *text)
+{
+    size_t length = strlen(text);
+
+    if (length == 0 || length > index->Size)
+        return LINE_INDEX_NOT_FOUND;
+
+    if (from > index->Size)
+        from = index->Size;
+
+    uint64_t found = LineIndex_Find(index, from, index->Size, text, length);
+
+    if (found == LINE_INDEX_NOT_FOUND)
+        found = LineIndex_Find(index, 0, from, text, length); // wrap around
+
+    return found;
+}
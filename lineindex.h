@@ -0,0 +1,70 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+#ifndef _LINE_INDEX_H_
+#define _LINE_INDEX_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+// A memory-mapped text file and the offsets of its lines, found by a thread in the background.
+// Only every LINE_INDEX_STRIDE-th line is recorded: the lines in between are found by scanning from there, so the index stays small for files of any size.
+
+#define LINE_INDEX_STRIDE       1024                // lines between two recorded offsets
+#define LINE_INDEX_CHUNK        (4 * 1024 * 1024)   // bytes scanned between two updates of the progress
+#define LINE_INDEX_NOT_FOUND    UINT64_MAX
+
+typedef struct _LineIndex
+{
+    const char *Data;           // the whole file
+    uint64_t Size;
+
+    uint64_t *Checkpoints;      // offset of the lines 0, STRIDE, 2*STRIDE ...
+    uint64_t NumCheckpoints;
+    uint64_t Capacity;
+    pthread_mutex_t Mutex;      // over the checkpoints, which the thread keeps adding
+
+    atomic_uint_fast64_t IndexedBytes;  // how far the thread got ...
+    atomic_uint_fast64_t IndexedLines;  // ... and how many lines start before that
+    atomic_uchar Complete;
+    atomic_uchar Cancel;
+
+    pthread_t Thread;
+    uint8_t ThreadStarted;
+    int ProgressPipe[2];        // becomes readable as the thread makes progress (-1 if not available)
+
+    #if (defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN32__))
+        void *FileHandle;
+        void *MappingHandle;
+    #endif
+} LineIndex;
+
+uint8_t LineIndex_Open(LineIndex *index, const char *path); // maps the file and starts indexing it ... returns 0 if it cannot be read
+void LineIndex_Close(LineIndex *index);
+int LineIndex_GetDescriptor(const LineIndex *index); // becomes readable as the indexing progresses (-1 if not available) ... drain it with LineIndex_Drain()
+void LineIndex_Drain(LineIndex *index);
+
+uint64_t LineIndex_Lines(LineIndex *index, uint8_t *complete); // lines indexed so far, and whether that's all of them
+uint64_t LineIndex_Seek(LineIndex *index, uint64_t line); // offset where the line starts, or LINE_INDEX_NOT_FOUND past the end of the file
+uint64_t LineIndex_LineOf(LineIndex *index, uint64_t offset); // the line the offset is in
+uint64_t LineIndex_NextLine(const LineIndex *index, uint64_t offset); // offset of the line after the one at offset (or the size of the file, if it's the last)
+uint64_t LineIndex_LineStart(const LineIndex *index, uint64_t offset); // offset where the line that the offset is in starts
+uint64_t LineIndex_PreviousLine(const LineIndex *index, uint64_t offset); // offset of the line before the one that starts at offset
+uint64_t LineIndex_Search(const LineIndex *index, uint64_t from, const char *text); // offset of the first occurrence at or after from, wrapping around at the end (LINE_INDEX_NOT_FOUND if there's none)
+
+#endif // _LINE_INDEX_H_
@@ -17,7 +17,16 @@
 
 #include "boxcanvas.h"
 #include "terminaldialogbox.h"
+#include "renderqueue.h"
+#include "port_clock.h"
+#include "renderstats.h"
+#include "canvasmirror.h"
+#include "braillepanel.h"
+#include "widget.h"
+#include "port_kbhit.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
 
 void demo_Boxes()
 {
@@ -34,6 +43,12 @@ void demo_Boxes()
     BoxCanvas_Box(&canvas, 10, 25, 25, 8, BOX_STYLE_WEAK);
     BoxCanvas_Box(&canvas, 30, 27, 10, 4, BOX_STYLE_SHADOW | BOX_STYLE_FILL);
 
+    uint8_t colWidths[] = {8, 4, 4, 4};
+    uint8_t rowHeights[] = {1, 1, 1, 1, 1};
+    BoxDrawStyle rowLines[] = {BOX_STYLE_STRONG, BOX_STYLE_STRONG, BOX_STYLE_WEAK, BOX_STYLE_WEAK, BOX_STYLE_WEAK, BOX_STYLE_STRONG}; // strong header and border, weak lines between the rows
+    BoxDrawStyle colLines[] = {BOX_STYLE_STRONG, BOX_STYLE_STRONG, BOX_STYLE_WEAK, BOX_STYLE_WEAK, BOX_STYLE_STRONG};
+    BoxCanvas_Grid(&canvas, 65, 10, 4, colWidths, 5, rowHeights, colLines, rowLines, BOX_STYLE_SHADOW);
+
     BoxCanvas_Render(&canvas);
 
     fflush(stdin);
@@ -82,12 +97,285 @@ void demo_Slider()
     printf("\nThe value is %f\n", val);
 }
 
+void demo_Viewer(const char *path)
+{
+    int result = ShowTextViewer(path, path, DIALOG_BOX_STYLE_BLUE);
+
+    Terminal_SetStyle(CONSOLE_STYLE_TEXT_WHITE, CONSOLE_STYLE_BACKGROUND_BLACK);
+    Terminal_Clear();
+    Terminal_RestoreCursorSavedPosition();
+
+    if (!result)
+        printf("\nCould not open %s\n", path);
+}
+
+void* demo_Worker(void *argument)
+{
+    uint8_t worker = (uint8_t)(uintptr_t)argument;
+    char status[RENDER_QUEUE_TEXT_MAX];
+
+    for (uint32_t iteration = 0; iteration < 2000000; iteration++) // the workers never wait for the terminal
+    {
+        if (iteration % 1000 != 0)
+            continue;
+
+        sprintf(status, "worker %u: %7u", worker, iteration);
+        RenderQueue_Text(12, 11 + worker*4, status);
+        RenderQueue_Present();
+    }
+
+    return NULL;
+}
+
+void demo_RenderThread()
+{
+    RenderThread_Start(0, 0, 0, 0, CONSOLE_STYLE_TEXT_WHITE, CONSOLE_STYLE_BACKGROUND_BLUE, 30);
+
+    RenderQueue_Clear();
+    for (uint8_t worker = 0; worker < 4; worker++)
+        RenderQueue_Box(10, 10 + worker*4, 30, 3, BOX_STYLE_WEAK | BOX_STYLE_SHADOW);
+    RenderQueue_Present();
+
+    pthread_t workers[4];
+    for (uint8_t worker = 0; worker < 4; worker++)
+        pthread_create(&workers[worker], NULL, demo_Worker, (void*)(uintptr_t)worker);
+
+    for (uint8_t worker = 0; worker < 4; worker++)
+        pthread_join(workers[worker], NULL);
+
+    Clock_SleepMicroseconds(1000000);
+    RenderThread_Stop();
+
+    Terminal_SetStyle(CONSOLE_STYLE_TEXT_WHITE, CONSOLE_STYLE_BACKGROUND_BLACK);
+    Terminal_Clear();
+    Terminal_RestoreCursorSavedPosition();
+}
+
+void demo_List()
+{
+    static const char *services[] = {"alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel"};
+    uint32_t numItems = 1000000;
+
+    char **items = (char**)malloc(sizeof(char*) * numItems); // one option for each host and service
+    for (uint32_t index = 0; index < numItems; index++)
+    {
+        items[index] = (char*)malloc(32);
+        sprintf(items[index], "%s-%06u.example.com", services[(index * 7) % 8], index);
+    }
+
+    uint32_t selection = 0;
+    int result = ShowListBox(&selection, "Pick a host", numItems, ListBox_ArrayItem, items, DIALOG_BOX_STYLE_BLUE);
+
+    Terminal_SetStyle(CONSOLE_STYLE_TEXT_WHITE, CONSOLE_STYLE_BACKGROUND_BLACK);
+    Terminal_Clear();
+    Terminal_RestoreCursorSavedPosition();
+
+    if (!result)
+        printf("\nYou did not pick a host!\n");
+    else
+        printf("\nHost: %s\n", items[selection]);
+
+    for (uint32_t index = 0; index < numItems; index++)
+        free(items[index]);
+    free(items);
+}
+
+ProgressDialog progress;
+
+void* demo_ProgressWorker(void *argument)
+{
+    for (uint32_t iteration = 0; iteration < 25000000; iteration++) // every step is reported ... only 20 of them a second are drawn
+        ProgressDialog_Add(&progress, 1);
+
+    (void)argument;
+    return NULL;
+}
+
+void demo_Progress()
+{
+    ProgressDialog_Open(&progress, "TITLE HERE", 100000000, DIALOG_BOX_STYLE_BLUE);
+    ProgressDialog_SetLabel(&progress, "Four workers are counting");
+
+    pthread_t workers[4];
+    for (uint8_t worker = 0; worker < 4; worker++)
+        pthread_create(&workers[worker], NULL, demo_ProgressWorker, NULL);
+
+    for (uint8_t worker = 0; worker < 4; worker++)
+        pthread_join(workers[worker], NULL);
+
+    ProgressDialog_SetLabel(&progress, "Done");
+    ProgressDialog_Close(&progress);
+
+    Terminal_SetStyle(CONSOLE_STYLE_TEXT_WHITE, CONSOLE_STYLE_BACKGROUND_BLACK);
+    Terminal_Clear();
+    Terminal_RestoreCursorSavedPosition();
+}
+
+#define DEMO_MIRROR_PATH "boxcanvas.sock"
+
+void demo_MirrorProducer()
+{
+    CanvasMirror mirror;
+    CanvasMirror_Open(&mirror, DEMO_MIRROR_PATH); // run option 0 on other terminals to watch
+
+    BoxCanvas canvas;
+    BoxCanvas_Create(&canvas, 0, 0, 0, 0);
+    canvas.Mirror = &mirror;
+
+    int listener = CanvasMirror_GetDescriptor(&mirror);
+    uint8_t X = 0, Y = 0;
+    int8_t stepX = 1, stepY = 1;
+
+    for (;;) // until Q or ESC is pressed
+    {
+        char event = kbhitWaitDescriptors(33333, &listener, listener >= 0 ? 1 : 0);
+
+        if (event == 1)
+        {
+            char key = getch();
+            if (key == 'q' || key == KEY_ESC)
+                break;
+
+            continue;
+        }
+
+        if (event == 2) // a viewer connected: it gets the last frame right away
+        {
+            CanvasMirror_Poll(&mirror);
+            continue;
+        }
+
+        for (uint8_t row = Y; row < min(Y + 6, canvas.Height); row++) // only the rows of the box change, so only they are sent
+            memset(canvas.BlockBuffer[row], 0, canvas.Width);
+
+        if (X + stepX < 0 || X + stepX + 20 >= canvas.Width) stepX = -stepX;
+        if (Y + stepY < 0 || Y + stepY + 6 >= canvas.Height) stepY = -stepY;
+        X += stepX;
+        Y += stepY;
+
+        BoxCanvas_Box(&canvas, X, Y, 20, 5, BOX_STYLE_STRONG | BOX_STYLE_SHADOW);
+        BoxCanvas_Render(&canvas);
+        fflush(stdout);
+    }
+
+    BoxCanvas_Destroy(&canvas);
+    CanvasMirror_Close(&mirror);
+
+    Terminal_SetStyle(CONSOLE_STYLE_TEXT_WHITE, CONSOLE_STYLE_BACKGROUND_BLACK);
+    Terminal_Clear();
+    Terminal_RestoreCursorSavedPosition();
+}
+
+void demo_MirrorViewer()
+{
+    int result = CanvasMirror_View(DEMO_MIRROR_PATH);
+
+    Terminal_SetStyle(CONSOLE_STYLE_TEXT_WHITE, CONSOLE_STYLE_BACKGROUND_BLACK);
+    Terminal_Clear();
+    Terminal_RestoreCursorSavedPosition();
+
+    if (!result)
+        printf("\nNothing is published at %s (start option 9 first)\n", DEMO_MIRROR_PATH);
+}
+
+#define DEMO_CHART_HISTORY 80
+#define DEMO_CHART_BINS 20
+
+void demo_Charts()
+{
+    BoxCanvas canvas;
+    BoxCanvas_Create(&canvas, 2, 2, 1 + 40 + 1 + 20 + 1, 1 + 1 + 1 + 8 + 1);
+
+    uint8_t colWidths[] = {40, 20};
+    uint8_t rowHeights[] = {1, 8};
+    BoxCanvas_Grid(&canvas, 0, 0, 2, colWidths, 2, rowHeights, NULL, NULL, BOX_STYLE_STRONG);
+
+    BraillePanel history, histogram; // inside the cells of the grid
+    BraillePanel_Create(&history, 1, 3, 40, 8);
+    BraillePanel_Create(&histogram, 42, 3, 20, 8);
+    BoxCanvas_AddBraille(&canvas, &history);
+    BoxCanvas_AddBraille(&canvas, &histogram);
+
+    BoxCanvas_Render(&canvas); // the grid and the empty charts, in one frame
+
+    Terminal_SetStyle(CONSOLE_STYLE_TEXT_WHITE, CONSOLE_STYLE_BACKGROUND_GREY);
+    Terminal_SetCursorPosition(canvas.Left + 1, canvas.Top + 1);
+    PrintWidth(40, 1, "load (last 80 samples)");
+    Terminal_SetCursorPosition(canvas.Left + 42, canvas.Top + 1);
+    PrintWidth(20, 1, "distribution");
+
+    float samples[DEMO_CHART_HISTORY];
+    float bins[DEMO_CHART_BINS];
+    uint32_t numSamples = 0;
+    float load = 50;
+
+    for (;;) // 10 times a second until Q or ESC is pressed
+    {
+        if (kbhitWait(100000))
+        {
+            char key = getch();
+            if (key == 'q' || key == KEY_ESC)
+                break;
+
+            continue;
+        }
+
+        load += (float)(rand() % 21 - 10);
+        load = (load < 0) ? 0 : (load > 100) ? 100 : load;
+
+        if (numSamples == DEMO_CHART_HISTORY)
+            memmove(samples, samples + 1, --numSamples * sizeof(float));
+        samples[numSamples++] = load;
+
+        float highest = 1;
+        memset(bins, 0, sizeof(bins));
+        for (uint32_t index = 0; index < numSamples; index++)
+        {
+            uint32_t bin = min((uint32_t)(samples[index] * DEMO_CHART_BINS / 100), DEMO_CHART_BINS - 1);
+            highest = max(highest, ++bins[bin]);
+        }
+
+        BraillePanel_Sparkline(&history, samples, numSamples, 0, 100);
+        BraillePanel_Histogram(&histogram, bins, DEMO_CHART_BINS, 0, highest);
+
+        BoxCanvas_RenderBraille(&canvas); // only the cells whose dots changed
+        fflush(stdout);
+    }
+
+    BoxCanvas_RemoveBraille(&canvas, &histogram);
+    BoxCanvas_RemoveBraille(&canvas, &history);
+    BraillePanel_Destroy(&histogram);
+    BraillePanel_Destroy(&history);
+    BoxCanvas_Destroy(&canvas);
+
+    Terminal_SetStyle(CONSOLE_STYLE_TEXT_WHITE, CONSOLE_STYLE_BACKGROUND_BLACK);
+    Terminal_Clear();
+    Terminal_RestoreCursorSavedPosition();
+}
+
+void demo_PrintStats()
+{
+    BoxCanvasStats stats;
+    BoxCanvas_GetStats(&stats, RENDER_STATS_TOTAL);
+
+    printf("\n%llu frames, %llu cells, %llu bytes in %llu writes (%llu cursor moves, %llu style changes), encode %llu us, write %llu us\n",
+        (unsigned long long)stats.FramesPresented, (unsigned long long)stats.CellsEncoded, (unsigned long long)stats.BytesWritten, (unsigned long long)stats.Syscalls,
+        (unsigned long long)stats.CursorMoves, (unsigned long long)stats.StyleChanges, (unsigned long long)stats.EncodeMicroseconds, (unsigned long long)stats.WriteMicroseconds);
+}
+
 int main(int argc, char** argv)
 {
     printf("1 - demo boxes\n");
     printf("2 - demo message box\n");
     printf("3 - demo file explorer\n");
     printf("4 - demo slider bar\n");
+    printf("5 - demo render thread\n");
+    printf("6 - demo text viewer\n");
+    printf("7 - demo progress dialog\n");
+    printf("8 - demo list box\n");
+    printf("9 - demo canvas mirror\n");
+    printf("0 - demo canvas mirror viewer\n");
+    printf("b - demo braille charts\n");
     printf("\n>> ");
 
     fflush(stdin);
@@ -113,6 +401,36 @@ int main(int argc, char** argv)
             demo_Slider();
         break;
 
+        case '5':
+            demo_RenderThread();
+        break;
+
+        case '6':
+            demo_Viewer((argc > 1) ? argv[1] : "README.md");
+        break;
+
+        case '7':
+            demo_Progress();
+        break;
+
+        case '8':
+            demo_List();
+        break;
+
+        case '9':
+            demo_MirrorProducer();
+        break;
+
+        case '0':
+            demo_MirrorViewer();
+        break;
+
+        case 'b':
+            demo_Charts();
+        break;
+
         default: break;
     }
+
+    demo_PrintStats();
 }
@@ -0,0 +1,389 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+#define _GNU_SOURCE             // fopencookie
+#include "outputsink.h"
+#include "renderstats.h"        // counters
+#include "port_clock.h"         // monotonic time
+#include "session.h"            // the terminal of each thread
+#include "framerecorder.h"      // a copy of each write, when recording
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+enum { SCAN_TEXT, SCAN_ESCAPE, SCAN_CSI };
+
+static void OutputSink_Scan(uint8_t *escapeState, const char *buffer, size_t size) // counts the cursor moves and style changes in the output ... the state is kept by the session, as sequences may be split between two writes
+{
+    uint64_t cursorMoves = 0, styleChanges = 0;
+
+    for (size_t index = 0; index < size; index++)
+    {
+        char ch = buffer[index];
+
+        switch (*escapeState)
+        {
+            case SCAN_TEXT:
+                if (ch == '\x1b')
+                    *escapeState = SCAN_ESCAPE;
+            break;
+
+            case SCAN_ESCAPE:
+                *escapeState = (ch == '[') ? SCAN_CSI : SCAN_TEXT;
+            break;
+
+            case SCAN_CSI:
+                if (ch >= 0x40 && ch <= 0x7E) // final byte of the control sequence
+                {
+                    if (ch == 'H' || ch == 'f')
+                        cursorMoves++;
+                    else if (ch == 'm')
+                        styleChanges++;
+
+                    *escapeState = SCAN_TEXT;
+                }
+            break;
+        }
+    }
+
+    RenderStats_Count(RENDER_COUNTER_CURSOR_MOVES, cursorMoves);
+    RenderStats_Count(RENDER_COUNTER_STYLE_CHANGES, styleChanges);
+}
+
+static void OutputSink_FlushProcess(void); // the buffer of the process terminal, which stdout does not reach once there are sessions
+static uint8_t OutputSink_SeesStdout(void); // 1 once stdout passes through the sink, which then counts all of it
+
+static atomic_size_t printedBytes; // what the library printed to stdout since it was last flushed (counted only while the sink does not see stdout)
+
+void OutputSink_Print(const char *buffer, size_t size)
+{
+    fwrite(buffer, sizeof(char), size, stdout);
+
+    if (OutputSink_SeesStdout())
+        return; // counted on its way out
+
+    OutputSink_Scan(&Session_Current()->ScanState, buffer, size);
+    RenderStats_Count(RENDER_COUNTER_BYTES, size);
+    atomic_fetch_add_explicit(&printedBytes, size, memory_order_relaxed);
+}
+
+static void OutputSink_FlushStdout(void)
+{
+    if (OutputSink_SeesStdout())
+    {
+        fflush(stdout);
+        return;
+    }
+
+    uint64_t start = Clock_GetMicroseconds();
+    fflush(stdout);
+    uint64_t elapsed = Clock_GetMicroseconds() - start;
+
+    if (atomic_exchange_explicit(&printedBytes, 0, memory_order_relaxed) == 0)
+        return; // only the host printed ... that's not ours to count
+
+    RenderStats_Count(RENDER_COUNTER_WRITE_TIME, elapsed);
+    RenderStats_Count(RENDER_COUNTER_SYSCALLS, 1); // stdio may have written part of it before, when its buffer filled up ... those writes are not seen from here
+}
+
+#if defined(unix) || defined(__unix__) || defined(__unix)
+
+#include <unistd.h>
+#include <errno.h>
+
+static void OutputSink_WriteDescriptor(int descriptor, const char *buffer, size_t size)
+{
+    size_t total = size;
+    uint64_t syscalls = 0;
+    uint64_t start = Clock_GetMicroseconds();
+
+    FrameRecorder_Output(descriptor, buffer, size);
+
+    while (size > 0)
+    {
+        ssize_t written = write(descriptor, buffer, size);
+        syscalls++;
+
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        buffer += written;
+        size -= written;
+    }
+
+    uint64_t elapsed = Clock_GetMicroseconds() - start;
+    FrameRecorder_Frame(descriptor, elapsed);
+
+    RenderStats_Count(RENDER_COUNTER_WRITE_TIME, elapsed);
+    RenderStats_Count(RENDER_COUNTER_SYSCALLS, syscalls);
+    RenderStats_Count(RENDER_COUNTER_BYTES, total - size);
+}
+
+static void OutputSink_Append(TerminalSession *session, const char *buffer, size_t size) // a session collects its output until it's flushed
+{
+    if (session->OutputLength + size > SESSION_OUTPUT_BUFFER)
+    {
+        OutputSink_WriteDescriptor(session->OutputDescriptor, session->Output, session->OutputLength);
+        session->OutputLength = 0;
+    }
+
+    if (size >= SESSION_OUTPUT_BUFFER) // would not fit anyway
+    {
+        OutputSink_WriteDescriptor(session->OutputDescriptor, buffer, size);
+        return;
+    }
+
+    memcpy(session->Output + session->OutputLength, buffer, size);
+    session->OutputLength += size;
+}
+
+void OutputSink_WriteVector(struct iovec *segments, int count)
+{
+    TerminalSession *session = Session_Current();
+
+    for (int index = 0; index < count; index++)
+        OutputSink_Scan(&session->ScanState, (const char*)segments[index].iov_base, segments[index].iov_len);
+
+    if (!session->Stdio) // joins the rest of the frame
+    {
+        for (int index = 0; index < count; index++)
+            OutputSink_Append(session, (const char*)segments[index].iov_base, segments[index].iov_len);
+        return;
+    }
+
+    OutputSink_FlushProcess(); // what was printed before must reach the terminal before it
+
+    uint64_t bytes = 0, syscalls = 0;
+    uint64_t start = Clock_GetMicroseconds();
+
+    for (int index = 0; index < count; index++)
+        FrameRecorder_Output(STDOUT_FILENO, (const char*)segments[index].iov_base, segments[index].iov_len);
+
+    while (count > 0)
+    {
+        ssize_t written = writev(STDOUT_FILENO, segments, count);
+        syscalls++;
+
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        bytes += written;
+
+        while (count > 0 && (size_t)written >= segments->iov_len) // skip what was completely written ...
+        {
+            written -= segments->iov_len;
+            segments++;
+            count--;
+        }
+
+        if (count > 0) // ... and resume in the middle of the one that was not
+        {
+            segments->iov_base = (char*)segments->iov_base + written;
+            segments->iov_len -= written;
+        }
+    }
+
+    uint64_t elapsed = Clock_GetMicroseconds() - start;
+    FrameRecorder_Frame(STDOUT_FILENO, elapsed);
+
+    RenderStats_Count(RENDER_COUNTER_WRITE_TIME, elapsed);
+    RenderStats_Count(RENDER_COUNTER_SYSCALLS, syscalls);
+    RenderStats_Count(RENDER_COUNTER_BYTES, bytes);
+}
+
+void OutputSink_Flush(void)
+{
+    OutputSink_FlushStdout();
+
+    TerminalSession *session = Session_Current();
+    if (session->Stdio)
+        OutputSink_FlushProcess();
+    else if (session->OutputLength > 0)
+    {
+        OutputSink_WriteDescriptor(session->OutputDescriptor, session->Output, session->OutputLength);
+        session->OutputLength = 0;
+    }
+}
+
+#else
+
+void OutputSink_Flush(void)
+{
+    OutputSink_FlushStdout(); // there are no sessions here
+}
+
+#endif
+
+#if defined(__GLIBC__)
+
+static FILE *hostStream = NULL;     // stdout as the host left it ... kept open, as another thread may still be holding it
+static FILE *sinkStream = NULL;     // the process terminal, buffered like stdout always was
+static FILE *routeStream = NULL;    // stdout once there are sessions: it passes each printf on to the session of its thread
+static pthread_once_t installOnce = PTHREAD_ONCE_INIT; // the first renders may come from several threads at once
+static pthread_once_t routeOnce = PTHREAD_ONCE_INIT;
+
+static void OutputSink_WriteProcess(const char *buffer, size_t size) // what the buffer of the process terminal lets through
+{
+    OutputSink_Scan(&Session_Current()->ScanState, buffer, size);
+    OutputSink_WriteDescriptor(STDOUT_FILENO, buffer, size);
+}
+
+void OutputSink_Write(const char *buffer, size_t size)
+{
+    TerminalSession *session = Session_Current();
+
+    if (!session->Stdio)
+    {
+        OutputSink_Scan(&session->ScanState, buffer, size);
+        OutputSink_Append(session, buffer, size);
+        return;
+    }
+
+    if (routeStream != NULL) // fflush(stdout) no longer reaches the buffer of the process terminal
+        fflush(sinkStream);
+
+    OutputSink_WriteProcess(buffer, size);
+}
+
+static ssize_t OutputSink_CookieWrite(void *cookie, const char *buffer, size_t size)
+{
+    (void)cookie;
+    OutputSink_WriteProcess(buffer, size);
+
+    return size; // a failing terminal is not worth failing the printf for
+}
+
+static ssize_t OutputSink_CookieRoute(void *cookie, const char *buffer, size_t size)
+{
+    (void)cookie;
+    TerminalSession *session = Session_Current();
+
+    if (session->Stdio)
+        fwrite(buffer, sizeof(char), size, sinkStream); // the process terminal keeps its buffer, and its single write per frame
+    else
+    {
+        OutputSink_Scan(&session->ScanState, buffer, size);
+        OutputSink_Append(session, buffer, size);
+    }
+
+    return size;
+}
+
+static FILE* OutputSink_Replace(cookie_write_function_t *write, int mode, size_t size) // puts a new stream in the place of stdout
+{
+    cookie_io_functions_t functions = { .write = write };
+
+    FILE *stream = fopencookie(NULL, "w", functions);
+    if (stream == NULL)
+        return NULL;
+
+    setvbuf(stream, NULL, mode, size);
+
+    fflush(stdout);
+    if (hostStream == NULL)
+        hostStream = stdout;
+
+    stdout = stream;
+
+    return stream;
+}
+
+static void OutputSink_InstallOnce(void)
+{
+    // keep the behavior of the original stream: line buffered on a terminal, fully buffered elsewhere ... but with room for a whole frame
+    sinkStream = OutputSink_Replace(OutputSink_CookieWrite, isatty(STDOUT_FILENO) ? _IOLBF : _IOFBF, OUTPUT_SINK_BUFFER_SIZE);
+}
+
+uint8_t OutputSink_Install(void)
+{
+    pthread_once(&installOnce, OutputSink_InstallOnce);
+    return (sinkStream != NULL);
+}
+
+static void OutputSink_RouteOnce(void)
+{
+    if (!OutputSink_Install())
+        return;
+
+    // a shared buffer would mix what the threads print, and be flushed by whoever fills it ... so nothing is buffered in stdout, and each printf is handed to the terminal of its own thread right away
+    routeStream = OutputSink_Replace(OutputSink_CookieRoute, _IONBF, 0);
+}
+
+uint8_t OutputSink_Route(void)
+{
+    pthread_once(&routeOnce, OutputSink_RouteOnce);
+    return (routeStream != NULL);
+}
+
+static uint8_t OutputSink_SeesStdout(void)
+{
+    return (sinkStream != NULL);
+}
+
+static void OutputSink_FlushProcess(void)
+{
+    if (routeStream != NULL)
+        fflush(sinkStream);
+}
+
+#else
+
+void OutputSink_Write(const char *buffer, size_t size)
+{
+    OutputSink_Scan(&Session_Current()->ScanState, buffer, size);
+    RenderStats_Count(RENDER_COUNTER_BYTES, size);
+    RenderStats_Count(RENDER_COUNTER_SYSCALLS, 1);
+
+    uint64_t start = Clock_GetMicroseconds();
+    FrameRecorder_Output(1, buffer, size);
+
+    fwrite(buffer, sizeof(char), size, stdout);
+    fflush(stdout);
+
+    FrameRecorder_Frame(1, Clock_GetMicroseconds() - start);
+}
+
+uint8_t OutputSink_Install(void)
+{
+    return 0; // there's no portable way to intercept stdout, only the canvases are counted
+}
+
+uint8_t OutputSink_Route(void)
+{
+    return 0;
+}
+
+static uint8_t OutputSink_SeesStdout(void)
+{
+    return 0;
+}
+
+static inline void OutputSink_FlushProcess(void)
+{
+    // stdout is the only stream
+}
+
+#endif
@@ -0,0 +1,41 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+#ifndef _OUTPUT_SINK_H_
+#define _OUTPUT_SINK_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// What the library writes to the terminal goes through here, so it can be measured: the canvases and the chrome are counted as they are printed, and the rest where it is written.
+// stdout itself is left alone unless the host asks for it: OutputSink_Install (glibc only) puts a stream in its place that counts and records everything printed, the host's printf too.
+// Sessions need that stream, so Session_Create installs it.
+
+#define OUTPUT_SINK_BUFFER_SIZE     65536   // a whole frame fits, so it reaches the terminal in a single write
+
+uint8_t OutputSink_Install(void); // opt-in: stdout goes through the sink from now on, with a buffer of OUTPUT_SINK_BUFFER_SIZE (a setvbuf done before is lost) ... returns 1 if it does
+uint8_t OutputSink_Route(void); // stdout goes to the session of the calling thread from now on (see session.h) ... returns 0 where that's not possible
+void OutputSink_Print(const char *buffer, size_t size); // fwrite to stdout, counted
+void OutputSink_Write(const char *buffer, size_t size); // for output that bypasses stdio (must be called after fflush(stdout))
+void OutputSink_Flush(void); // sends what the calling thread printed to its terminal (stdout, and the buffer of its session)
+
+#if defined(unix) || defined(__unix__) || defined(__unix)
+    #include <sys/uio.h>
+    void OutputSink_WriteVector(struct iovec *segments, int count); // many buffers in a single writev (must be called after fflush(stdout) too)
+#endif
+
+#endif // _OUTPUT_SINK_H_
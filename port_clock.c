@@ -0,0 +1,61 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+#include "port_clock.h"
+
+#if defined(unix) || defined(__unix__) || defined(__unix)
+
+#include <time.h>
+
+uint64_t Clock_GetMicroseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now); // not affected by changes to the wall clock
+
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+void Clock_SleepMicroseconds(uint32_t microseconds)
+{
+    struct timespec duration = { .tv_sec = microseconds / 1000000, .tv_nsec = (microseconds % 1000000) * 1000 };
+    nanosleep(&duration, NULL);
+}
+
+#endif
+
+#if (defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN32__))
+
+#include <windows.h>
+
+uint64_t Clock_GetMicroseconds(void)
+{
+    static LARGE_INTEGER frequency = {0};
+    LARGE_INTEGER now;
+
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+
+    QueryPerformanceCounter(&now);
+    return (uint64_t)(now.QuadPart / frequency.QuadPart) * 1000000 + (uint64_t)(now.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+}
+
+void Clock_SleepMicroseconds(uint32_t microseconds)
+{
+    Sleep((microseconds + 999) / 1000); // windows only sleeps whole milliseconds
+}
+
+#endif
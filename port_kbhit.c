@@ -16,6 +16,8 @@
 // ===================================================================================  //
 
 #include "port_kbhit.h"
+#include "session.h"            // the terminal of each thread
+#include "framerecorder.h"      // the keys go in the recording too
 
 #if defined(unix) || defined(__unix__) || defined(__unix)
 
@@ -26,38 +28,69 @@
 #include <termios.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <string.h>
+#include <poll.h>
+#include <errno.h>
 
-char initialized = 0;
-char savedMode = 0;
-
-struct termios termOriginal, termModified;
-
-void SetMode(char mode)
+char SetMode(char mode)
 {
-    if (!initialized)
+    TerminalSession *session = Session_Current(); // each terminal has its own mode
+
+    if (!session->ModeInitialized)
     {
-        tcgetattr(0, &termOriginal);
+        tcgetattr(session->InputDescriptor, &session->ModeOriginal);
 
-        termModified = termOriginal;
-        termModified.c_lflag &= ~ICANON;
-        termModified.c_lflag &= ~ECHO;
+        session->ModeModified = session->ModeOriginal;
+        session->ModeModified.c_lflag &= ~ICANON;
+        session->ModeModified.c_lflag &= ~ECHO;
+        session->ModeInitialized = 1;
     }
 
-    if (mode == savedMode) // avoid unnecessary system-calls
-        return;
+    char previous = session->Mode;
+    if (mode == previous) // avoid unnecessary system-calls
+        return previous;
 
     if (mode == 0)
-        tcsetattr(0, TCSANOW, &termOriginal); // echo on
+        tcsetattr(session->InputDescriptor, TCSANOW, &session->ModeOriginal); // echo on
     else
-        tcsetattr(0, TCSANOW, &termModified); // echo off
+        tcsetattr(session->InputDescriptor, TCSANOW, &session->ModeModified); // echo off
+
+    session->Mode = mode;
+    return previous;
+}
+
+static char kbhitSession(TerminalSession *session, int timeoutMilliseconds) // reads ahead whatever is waiting in the descriptor of a session
+{
+    if (session->InputOffset < session->InputLength || session->InputClosed)
+        return 1;
+
+    struct pollfd input = { .fd = session->InputDescriptor, .events = POLLIN };
+    if (poll(&input, 1, timeoutMilliseconds) <= 0)
+        return 0;
 
-    savedMode = mode;
+    ssize_t length = read(session->InputDescriptor, session->Input, sizeof(session->Input));
+    if (length < 0 && (errno == EAGAIN || errno == EINTR))
+        return 0;
+
+    if (length <= 0) // hung up: from now on every key is an <esc>, so the dialogs close
+    {
+        session->InputClosed = 1;
+        return 1;
+    }
+
+    session->InputLength = length;
+    session->InputOffset = 0;
+    return 1;
 }
 
 char kbhit(void)
 {
     SetMode(1); // echo off
 
+    TerminalSession *session = Session_Current();
+    if (!session->Stdio || session->InputOffset < session->InputLength) // the process terminal only uses the buffer for keys given back
+        return kbhitSession(session, 0);
+
     int oldf = fcntl(STDIN_FILENO, F_GETFL, 0);
     fcntl(STDIN_FILENO, F_SETFL, oldf | O_NONBLOCK); // getchar blocking
 
@@ -71,6 +104,7 @@ char kbhit(void)
         return 1;
     }
 
+    clearerr(stdin); // the non-blocking read left the error flag set
     return 0;
     /*SetMode(1);
 
@@ -80,37 +114,105 @@ char kbhit(void)
     return (byteswaiting > 0);*/
 }
 
+char kbhitWaitDescriptors(uint32_t timeoutMicroseconds, const int *descriptors, uint8_t count)
+{
+    if (kbhit()) // the key may already be in the stdio buffer, where poll cannot see it
+        return 1;
+
+    if (count > KBHIT_MAX_DESCRIPTORS)
+        count = KBHIT_MAX_DESCRIPTORS;
+
+    struct pollfd waitList[1 + KBHIT_MAX_DESCRIPTORS];
+    waitList[0].fd = Session_Current()->InputDescriptor;
+    waitList[0].events = POLLIN;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        waitList[1 + i].fd = descriptors[i];
+        waitList[1 + i].events = POLLIN;
+    }
+
+    int timeoutMilliseconds = (timeoutMicroseconds == KBHIT_WAIT_FOREVER) ? -1 : (int)((timeoutMicroseconds + 999) / 1000);
+
+    if (poll(waitList, 1 + count, timeoutMilliseconds) <= 0)
+        return 0; // timeout, or interrupted by a signal
+
+    for (uint8_t i = 0; i < count; i++)
+        if (waitList[1 + i].revents & POLLIN)
+            return 2 + i;
+
+    return kbhit();
+}
+
+char kbhitWait(uint32_t timeoutMicroseconds)
+{
+    return kbhitWaitDescriptors(timeoutMicroseconds, NULL, 0);
+}
+
+char getchRaw(void)
+{
+    TerminalSession *session = Session_Current();
+    if (session->Stdio && session->InputOffset >= session->InputLength)
+        return getchar();
+
+    while (!kbhitSession(session, -1))
+        (void)0; // interrupted by a signal
+
+    if (session->InputOffset >= session->InputLength)
+        return KEY_ESC; // closed
+
+    return session->Input[session->InputOffset++];
+}
+
+void ungetchRaw(const char *keys, size_t length)
+{
+    TerminalSession *session = Session_Current();
+    size_t pending = session->InputLength - session->InputOffset; // read ahead after them
+
+    if (length > sizeof(session->Input) - pending)
+        length = sizeof(session->Input) - pending; // no room for the rest
+
+    memmove(session->Input + length, session->Input + session->InputOffset, pending);
+    memcpy(session->Input, keys, length);
+
+    session->InputOffset = 0;
+    session->InputLength = pending + length;
+}
+
 char getch(void)
 {
     SetMode(1);
-    char ch = getchar();
+    char ch = getchRaw();
     SetMode(0);
 
     return ch;
 }
 
-char getchNavigation(void)
+static char getchDecode(void) // the key, out of the sequence the terminal sends for it ... in the mode the caller set, so the bytes that follow are never echoed
 {
-    char ch = getch();
+    char ch = getchRaw();
     if (ch != 27) // start escape sequence
         return ch;
 
-    ch = getch();
+    if (!kbhitWait(KEY_ESC_TIMEOUT)) // the rest of a sequence arrives together with the escape ... if nothing follows, it was the <esc> key itself
+        return KEY_ESC;
+
+    ch = getchRaw();
     if (ch != '[')
         return ch;
 
-    ch = getch();
+    ch = getchRaw();
     if (ch == '1')
     {
-        char ch = getch();
+        char ch = getchRaw();
         if (ch != ';')
             return ch;
 
-        ch = getch();
+        ch = getchRaw();
         if (ch != '2')
             return ch;
 
-        ch = getch();
+        ch = getchRaw();
         switch (ch)
         {
             case UNIX_ARROW_ESCAPE_UP:      return KEY_PAGE_UP; break;
@@ -135,7 +237,38 @@ char getchNavigation(void)
 #endif
 
 #if (defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN32__))
-char getchNavigation(void)
+#include "port_clock.h"
+
+char SetMode(char mode)
+{
+    (void)mode; // getch of the console already takes the keys one at a time, without echo
+    return 1;
+}
+
+char kbhitWaitDescriptors(uint32_t timeoutMicroseconds, const int *descriptors, uint8_t count)
+{
+    (void)descriptors; // nothing to poll them with
+    (void)count;
+
+    uint64_t start = Clock_GetMicroseconds();
+
+    while (!kbhit()) // the console input handle is not a pollable descriptor, so we poll kbhit in small steps
+    {
+        if (timeoutMicroseconds != KBHIT_WAIT_FOREVER && Clock_GetMicroseconds() - start >= timeoutMicroseconds)
+            return 0;
+
+        Clock_SleepMicroseconds(1000);
+    }
+
+    return 1;
+}
+
+char kbhitWait(uint32_t timeoutMicroseconds)
+{
+    return kbhitWaitDescriptors(timeoutMicroseconds, NULL, 0);
+}
+
+static char getchDecode(void)
 {
     char ch = getch();
     if (ch != WINDOWS_ESCAPE)
@@ -155,3 +288,11 @@ char getchNavigation(void)
     }
 }
 #endif
+
+char getchNavigation(void)
+{
+    char key = getchDecode();
+    FrameRecorder_Key(key);
+
+    return key;
+}
@@ -18,6 +18,9 @@
 #ifndef _PORT_KBHIT_H_
 #define _PORT_KBHIT_H_
 
+#include <stdint.h>
+#include <stddef.h>
+
     #define KEY_ENTER                '\n'
     #define KEY_RETURN               '\r'
     #define KEY_ESC                   27
@@ -29,7 +32,14 @@
     #define KEY_PAGE_UP               -17
     #define KEY_PAGE_DOWN             -18
 
-    char getchNavigation(void);
+    #define KBHIT_WAIT_FOREVER        0xFFFFFFFF
+    #define KBHIT_MAX_DESCRIPTORS     8     // waited for besides the keys
+    #define KEY_ESC_TIMEOUT           50000 // [us] longest gap between the escape and the rest of a key sequence
+
+    char SetMode(char mode); // 0 = original terminal mode, 1 = no echo and no line buffering (the dialogs keep it while they are on) ... returns the mode it was in
+    char getchNavigation(void); // a key, of as many bytes as the terminal sends for it ... the mode is left alone (call SetMode(1) first)
+    char kbhitWait(uint32_t timeoutMicroseconds); // waits until a key is available (returns 1) or the timeout expires (returns 0)
+    char kbhitWaitDescriptors(uint32_t timeoutMicroseconds, const int *descriptors, uint8_t count); // same, but also returns 2+i when descriptors[i] becomes readable (up to KBHIT_MAX_DESCRIPTORS of them, and none under windows)
 
     #if (defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN32__))
         #include <conio.h> // functions kbhit(), getch() already defined here
@@ -54,6 +64,8 @@
 
         char kbhit(void); // lets declare and implement ourselves
         char getch(void);
+        char getchRaw(void); // same, but leaves the terminal mode alone (call SetMode(1) first)
+        void ungetchRaw(const char *keys, size_t length); // gives keys back, so they are read again before anything else (as many as fit in the session buffer)
     #endif // UNIX
 
 #endif
@@ -0,0 +1,320 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+#include "renderqueue.h"
+#include "framescheduler.h"     // frame rate and atomic presentation
+#include "port_clock.h"         // monotonic time
+#include "textwidth.h"          // columns of the texts
+#include "syncupdate.h"         // asked before the thread starts
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+struct renderSlot
+{
+    atomic_size_t Sequence; // tells whether the slot is free for the producer of this lap or filled for the consumer
+    RenderCommand Command;
+};
+
+struct renderText
+{
+    uint8_t X;
+    uint8_t Y;
+    uint8_t Dirty;
+    uint8_t Shown;  // columns of the text that is on the screen now ... a shorter text must blank the rest
+    ConsoleStyleText TextStyle;
+    ConsoleStyleBackground BackgroundStyle;
+    char Text[RENDER_QUEUE_TEXT_MAX];
+};
+
+static struct renderSlot queue[RENDER_QUEUE_CAPACITY];
+static atomic_size_t enqueuePosition;   // shared by all the producers
+static size_t dequeuePosition;          // only the render thread touches it
+
+static pthread_t renderThread;
+static atomic_int running = 0;
+
+// state owned by the render thread
+static BoxCanvas canvas;
+static uint8_t canvasDirty;
+static struct renderText texts[RENDER_QUEUE_MAX_TEXTS];
+static uint16_t numTexts;
+static ConsoleStyleText currentText;
+static ConsoleStyleBackground currentBackground;
+static uint32_t frameInterval;
+
+uint8_t RenderQueue_Post(const RenderCommand *command)
+{
+    size_t position = atomic_load_explicit(&enqueuePosition, memory_order_relaxed);
+
+    for (;;)
+    {
+        struct renderSlot *slot = &queue[position & (RENDER_QUEUE_CAPACITY - 1)];
+        size_t sequence = atomic_load_explicit(&slot->Sequence, memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+        if (difference == 0) // the slot is free: try to claim it
+        {
+            if (atomic_compare_exchange_weak_explicit(&enqueuePosition, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+            {
+                slot->Command = *command;
+                atomic_store_explicit(&slot->Sequence, position + 1, memory_order_release); // hand it over to the render thread
+                return 1;
+            }
+            // another producer took it, position was reloaded by the exchange
+        }
+        else if (difference < 0) // the render thread did not consume this slot yet: the queue is full
+            return 0;
+        else
+            position = atomic_load_explicit(&enqueuePosition, memory_order_relaxed);
+    }
+}
+
+static uint8_t RenderQueue_Take(RenderCommand *command)
+{
+    struct renderSlot *slot = &queue[dequeuePosition & (RENDER_QUEUE_CAPACITY - 1)];
+    size_t sequence = atomic_load_explicit(&slot->Sequence, memory_order_acquire);
+
+    if (sequence != dequeuePosition + 1) // nothing posted (or still being written)
+        return 0;
+
+    *command = slot->Command;
+    atomic_store_explicit(&slot->Sequence, dequeuePosition + RENDER_QUEUE_CAPACITY, memory_order_release); // free for the producers of the next lap
+    dequeuePosition++;
+
+    return 1;
+}
+
+uint8_t RenderQueue_Clear(void)
+{
+    RenderCommand command = { .Type = RENDER_COMMAND_CLEAR };
+    return RenderQueue_Post(&command);
+}
+
+uint8_t RenderQueue_Box(uint8_t X, uint8_t Y, uint8_t W, uint8_t H, BoxDrawStyle style)
+{
+    RenderCommand command = { .Type = RENDER_COMMAND_BOX, .X = X, .Y = Y, .W = W, .H = H, .BoxStyle = style };
+    return RenderQueue_Post(&command);
+}
+
+uint8_t RenderQueue_Style(ConsoleStyleText text, ConsoleStyleBackground background)
+{
+    RenderCommand command = { .Type = RENDER_COMMAND_STYLE, .TextStyle = text, .BackgroundStyle = background };
+    return RenderQueue_Post(&command);
+}
+
+uint8_t RenderQueue_Text(uint8_t X, uint8_t Y, const char *text)
+{
+    RenderCommand command = { .Type = RENDER_COMMAND_TEXT, .X = X, .Y = Y };
+
+    size_t length = strlen(text);
+    if (length > RENDER_QUEUE_TEXT_MAX - 1) // longer texts are cut ... between two characters, never in the middle of one
+    {
+        length = RENDER_QUEUE_TEXT_MAX - 1;
+        while (length > 0 && ((unsigned char)text[length] & 0xC0) == 0x80) // the first byte left out continues a character: that one goes too
+            length--;
+    }
+
+    memcpy(command.Text, text, length);
+
+    return RenderQueue_Post(&command);
+}
+
+uint8_t RenderQueue_Present(void)
+{
+    RenderCommand command = { .Type = RENDER_COMMAND_PRESENT };
+    return RenderQueue_Post(&command);
+}
+
+static void RenderThread_Apply(const RenderCommand *command)
+{
+    switch (command->Type)
+    {
+        case RENDER_COMMAND_CLEAR:
+            for (uint8_t row = 0; row < canvas.Height; row++)
+                memset(canvas.BlockBuffer[row], 0, canvas.Width * sizeof(uint8_t));
+
+            numTexts = 0;
+            canvasDirty = 1;
+        break;
+
+        case RENDER_COMMAND_BOX:
+            BoxCanvas_Box(&canvas, command->X, command->Y, command->W, command->H, command->BoxStyle);
+            canvasDirty = 1;
+        break;
+
+        case RENDER_COMMAND_STYLE:
+            currentText = command->TextStyle;
+            currentBackground = command->BackgroundStyle;
+        break;
+
+        case RENDER_COMMAND_TEXT:
+        {
+            uint16_t index;
+            for (index = 0; index < numTexts; index++) // a text replaces whatever was written at the same position
+                if (texts[index].X == command->X && texts[index].Y == command->Y)
+                    break;
+
+            if (index == numTexts)
+            {
+                if (numTexts == RENDER_QUEUE_MAX_TEXTS)
+                    break; // no room ... ignore it
+
+                texts[index].Shown = 0;
+                numTexts++;
+            }
+
+            struct renderText *text = &texts[index];
+            text->X = command->X;
+            text->Y = command->Y;
+            text->TextStyle = currentText;
+            text->BackgroundStyle = currentBackground;
+            text->Dirty = 1;
+            strcpy(text->Text, command->Text);
+        }
+        break;
+
+        default: break;
+    }
+}
+
+static void RenderThread_Present(FrameScheduler *scheduler)
+{
+    Terminal_Lock();
+    FrameScheduler_BeginFrame(scheduler);
+
+    if (canvasDirty) // the canvas paints over the whole area, so all texts must follow
+    {
+        BoxCanvas_Render(&canvas);
+
+        for (uint16_t index = 0; index < numTexts; index++)
+        {
+            texts[index].Dirty = 1;
+            texts[index].Shown = 0; // painted over already
+        }
+
+        canvasDirty = 0;
+    }
+
+    Terminal_SaveCursorPosition();
+    for (uint16_t index = 0; index < numTexts; index++)
+    {
+        if (!texts[index].Dirty)
+            continue;
+
+        Terminal_SetCursorPosition(canvas.Left + texts[index].X, canvas.Top + texts[index].Y);
+        Terminal_SetStyle(texts[index].TextStyle, texts[index].BackgroundStyle);
+        fputs(texts[index].Text, stdout);
+
+        size_t columns = TextWidth_String(texts[index].Text);
+        for (size_t column = columns; column < texts[index].Shown; column++)
+            fputc(' ', stdout);
+
+        texts[index].Shown = (uint8_t)columns;
+        texts[index].Dirty = 0;
+    }
+    Terminal_RestoreCursorSavedPosition();
+
+    FrameScheduler_EndFrame(scheduler);
+    Terminal_Unlock();
+}
+
+static void* RenderThread_Main(void *argument)
+{
+    FrameScheduler scheduler;
+    FrameScheduler_Create(&scheduler, 0);
+    scheduler.FrameInterval = frameInterval;
+    scheduler.Dirty = 0; // the first frame is the first PRESENT
+
+    RenderCommand command;
+    uint8_t presentPending = 0;
+
+    for (;;)
+    {
+        uint8_t stopping = !atomic_load(&running);
+
+        while (RenderQueue_Take(&command)) // apply everything that was posted, so many posts make a single frame
+        {
+            if (command.Type == RENDER_COMMAND_PRESENT)
+                presentPending = 1;
+            else
+                RenderThread_Apply(&command);
+        }
+
+        uint64_t now = Clock_GetMicroseconds();
+        uint64_t due = scheduler.LastPresent + scheduler.FrameInterval;
+
+        if (presentPending && (now >= due || stopping))
+        {
+            RenderThread_Present(&scheduler);
+            presentPending = 0;
+        }
+
+        if (stopping)
+            break;
+
+        // there is no wake-up call (that would cost the producers a system call), so the thread looks at the queue once per frame
+        Clock_SleepMicroseconds((presentPending && due > now) ? (uint32_t)(due - now) : scheduler.FrameInterval);
+    }
+
+    (void)argument;
+    return NULL;
+}
+
+uint8_t RenderThread_Start(uint8_t X, uint8_t Y, uint8_t W, uint8_t H, ConsoleStyleText FillStyle, ConsoleStyleBackground BackgroundStyle, uint16_t framesPerSecond)
+{
+    if (atomic_load(&running))
+        return 0;
+
+    BoxCanvas_Create(&canvas, X, Y, W, H);
+    canvas.FillStyle = FillStyle;
+    canvas.BackgroundStyle = BackgroundStyle;
+    canvasDirty = 1;
+    numTexts = 0;
+    currentText = FillStyle;
+    currentBackground = BackgroundStyle;
+
+    FrameScheduler scheduler; // just to get the interval of the rate
+    FrameScheduler_Create(&scheduler, framesPerSecond);
+    frameInterval = scheduler.FrameInterval;
+    SyncUpdate_Detect(); // the render thread must not read the keys
+
+    atomic_store(&enqueuePosition, 0);
+    dequeuePosition = 0;
+    for (size_t index = 0; index < RENDER_QUEUE_CAPACITY; index++)
+        atomic_store_explicit(&queue[index].Sequence, index, memory_order_relaxed);
+
+    atomic_store(&running, 1);
+    if (pthread_create(&renderThread, NULL, RenderThread_Main, NULL) != 0)
+    {
+        atomic_store(&running, 0);
+        BoxCanvas_Destroy(&canvas);
+        return 0;
+    }
+
+    return 1;
+}
+
+void RenderThread_Stop(void)
+{
+    if (!atomic_exchange(&running, 0))
+        return;
+
+    pthread_join(renderThread, NULL);
+    BoxCanvas_Destroy(&canvas);
+}
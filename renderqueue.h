@@ -0,0 +1,62 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+#ifndef _RENDER_QUEUE_H_
+#define _RENDER_QUEUE_H_
+
+#include <stdint.h>
+#include "boxcanvas.h"
+
+// A render thread owns the terminal and draws what the other threads post to a lock-free queue
+// Posting never blocks nor makes system calls: when the queue is full the command is dropped and the post returns 0
+
+#define RENDER_QUEUE_CAPACITY       1024    // must be a power of 2
+#define RENDER_QUEUE_TEXT_MAX       64      // longest text carried by a single command (including the '\0')
+#define RENDER_QUEUE_MAX_TEXTS      256     // texts kept on the screen at the same time
+
+typedef enum {
+    RENDER_COMMAND_CLEAR,       // erase all boxes and texts
+    RENDER_COMMAND_BOX,         // draw a box on the canvas
+    RENDER_COMMAND_STYLE,       // style of the texts that follow
+    RENDER_COMMAND_TEXT,        // put a text at a position, replacing the text that was there
+    RENDER_COMMAND_PRESENT,     // the changes so far make a frame
+} RenderCommandType;
+
+typedef struct _RenderCommand
+{
+    uint8_t Type;
+    uint8_t X;
+    uint8_t Y;
+    uint8_t W;
+    uint8_t H;
+    uint8_t BoxStyle;
+    ConsoleStyleText TextStyle;
+    ConsoleStyleBackground BackgroundStyle;
+    char Text[RENDER_QUEUE_TEXT_MAX];
+} RenderCommand;
+
+uint8_t RenderThread_Start(uint8_t X, uint8_t Y, uint8_t W, uint8_t H, ConsoleStyleText FillStyle, ConsoleStyleBackground BackgroundStyle, uint16_t framesPerSecond); // the area of the canvas - 0 width or height means "fullscreen"
+void RenderThread_Stop(void); // draws what is still in the queue, then joins the thread
+
+uint8_t RenderQueue_Post(const RenderCommand *command);
+uint8_t RenderQueue_Clear(void);
+uint8_t RenderQueue_Box(uint8_t X, uint8_t Y, uint8_t W, uint8_t H, BoxDrawStyle style);
+uint8_t RenderQueue_Style(ConsoleStyleText text, ConsoleStyleBackground background);
+uint8_t RenderQueue_Text(uint8_t X, uint8_t Y, const char *text);
+uint8_t RenderQueue_Present(void);
+
+#endif // _RENDER_QUEUE_H_
@@ -0,0 +1,67 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+#include "renderstats.h"
+#include <stdatomic.h>
+
+static atomic_uint_fast64_t counters[RENDER_STATS_NUM_SCOPES][RENDER_NUM_COUNTERS]; // relaxed atomics: nothing is ordered by them, they only need to add up
+static _Thread_local RenderStatsScope currentScope = RENDER_STATS_OTHER;
+
+RenderStatsScope RenderStats_SetScope(RenderStatsScope scope)
+{
+    RenderStatsScope previous = currentScope;
+    currentScope = scope;
+
+    return previous;
+}
+
+void RenderStats_Count(RenderCounter counter, uint64_t amount)
+{
+    atomic_fetch_add_explicit(&counters[RENDER_STATS_TOTAL][counter], amount, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counters[currentScope][counter], amount, memory_order_relaxed);
+}
+
+void BoxCanvas_GetStats(BoxCanvasStats *stats, RenderStatsScope scope)
+{
+    atomic_uint_fast64_t *scopeCounters = counters[scope];
+
+    stats->FramesPresented      = atomic_load_explicit(&scopeCounters[RENDER_COUNTER_FRAMES], memory_order_relaxed);
+    stats->CellsEncoded         = atomic_load_explicit(&scopeCounters[RENDER_COUNTER_CELLS], memory_order_relaxed);
+    stats->BytesWritten         = atomic_load_explicit(&scopeCounters[RENDER_COUNTER_BYTES], memory_order_relaxed);
+    stats->CursorMoves          = atomic_load_explicit(&scopeCounters[RENDER_COUNTER_CURSOR_MOVES], memory_order_relaxed);
+    stats->StyleChanges         = atomic_load_explicit(&scopeCounters[RENDER_COUNTER_STYLE_CHANGES], memory_order_relaxed);
+    stats->Syscalls             = atomic_load_explicit(&scopeCounters[RENDER_COUNTER_SYSCALLS], memory_order_relaxed);
+    stats->EncodeMicroseconds   = atomic_load_explicit(&scopeCounters[RENDER_COUNTER_ENCODE_TIME], memory_order_relaxed);
+    stats->WriteMicroseconds    = atomic_load_explicit(&scopeCounters[RENDER_COUNTER_WRITE_TIME], memory_order_relaxed);
+}
+
+void BoxCanvas_ResetStats(RenderStatsScope scope)
+{
+    for (uint8_t counter = 0; counter < RENDER_NUM_COUNTERS; counter++)
+    {
+        if (scope == RENDER_STATS_TOTAL)
+        {
+            for (uint8_t index = 0; index < RENDER_STATS_NUM_SCOPES; index++)
+                atomic_store_explicit(&counters[index][counter], 0, memory_order_relaxed);
+        }
+        else // the total goes down by as much, so it still adds up to the scopes
+        {
+            uint_fast64_t cleared = atomic_exchange_explicit(&counters[scope][counter], 0, memory_order_relaxed);
+            atomic_fetch_sub_explicit(&counters[RENDER_STATS_TOTAL][counter], cleared, memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,67 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+#ifndef _RENDER_STATS_H_
+#define _RENDER_STATS_H_
+
+#include <stdint.h>
+
+typedef enum {
+    RENDER_STATS_TOTAL,             // everything
+    RENDER_STATS_MESSAGE_BOX,       // only while ShowMessageBox is open
+    RENDER_STATS_SLIDER_BOX,        // only while ShowSliderBox is open
+    RENDER_STATS_FILE_EXPLORER,     // only while ShowFileExplorer is open
+    RENDER_STATS_TEXT_VIEWER,       // only while ShowTextViewer is open
+    RENDER_STATS_LIST_BOX,          // only while ShowListBox is open
+    RENDER_STATS_PROGRESS_DIALOG,   // only the thread of a ProgressDialog
+    RENDER_STATS_OTHER,             // drawing outside of the dialogs
+    RENDER_STATS_NUM_SCOPES
+} RenderStatsScope;
+
+typedef enum {
+    RENDER_COUNTER_FRAMES,          // frames presented
+    RENDER_COUNTER_CELLS,           // canvas cells encoded
+    RENDER_COUNTER_BYTES,           // bytes written to the terminal
+    RENDER_COUNTER_CURSOR_MOVES,    // cursor positioning sequences written
+    RENDER_COUNTER_STYLE_CHANGES,   // SGR sequences written
+    RENDER_COUNTER_SYSCALLS,        // write calls made
+    RENDER_COUNTER_ENCODE_TIME,     // [us] spent encoding canvases
+    RENDER_COUNTER_WRITE_TIME,      // [us] spent in write calls
+    RENDER_NUM_COUNTERS
+} RenderCounter;
+
+typedef struct _BoxCanvasStats
+{
+    uint64_t FramesPresented;
+    uint64_t CellsEncoded;
+    uint64_t BytesWritten;
+    uint64_t CursorMoves;
+    uint64_t StyleChanges;
+    uint64_t Syscalls;
+    uint64_t EncodeMicroseconds;
+    uint64_t WriteMicroseconds;
+} BoxCanvasStats;
+
+// reading the counters
+void BoxCanvas_GetStats(BoxCanvasStats *stats, RenderStatsScope scope);
+void BoxCanvas_ResetStats(RenderStatsScope scope); // RENDER_STATS_TOTAL resets all of them ... any other scope is taken out of the total too
+
+// counting (used by the library)
+RenderStatsScope RenderStats_SetScope(RenderStatsScope scope); // the scope of the calling thread, returns the previous one so it can be restored
+void RenderStats_Count(RenderCounter counter, uint64_t amount);
+
+#endif // _RENDER_STATS_H_
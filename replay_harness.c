@@ -0,0 +1,380 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+// Replays scripted keys into the dialogs through a pseudo-terminal and measures how long each key takes to show up on the screen.
+// The harness plays the terminal: it answers the synchronized-update query, so every frame ends with "ESC [ ? 2026 l" and can be timed.
+//
+//      replay_harness [scenario] ...       (no scenario runs all of them)
+
+#define _GNU_SOURCE             // nftw, forkpty
+#include "terminaldialogbox.h"
+#include "port_clock.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(unix) || defined(__unix__) || defined(__unix)
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <ftw.h>
+#if defined(__APPLE__)
+    #include <util.h>
+#else
+    #include <pty.h>
+#endif
+
+#define REPLAY_TERMINAL_WIDTH       120
+#define REPLAY_TERMINAL_HEIGHT      40
+#define REPLAY_TREE_DIRECTORIES     10
+#define REPLAY_TREE_FILES           10000   // per directory
+#define REPLAY_FRAME_TIMEOUT        2000000 // [us] a key with no frame after this long is counted as "no frame"
+#define REPLAY_MAX_KEYS             8192
+
+#define KEYS_UP         "\x1b[A"
+#define KEYS_DOWN       "\x1b[B"
+#define KEYS_RIGHT      "\x1b[C"
+#define KEYS_LEFT       "\x1b[D"
+#define KEYS_ENTER      "\n"
+#define KEYS_BACKSPACE  "\x7f"
+#define KEYS_ESC        "\x1b"
+
+struct replayStep
+{
+    const char *Keys;           // each step is sent as a single key
+    uint16_t Repeat;
+    uint32_t Pace;              // [us] between two keys ... 0 is a storm: the keys are sent as fast as the pty takes them
+};
+
+struct replayScenario
+{
+    const char *Name;
+    void (*Run)(void);          // runs the dialog in the child process
+    const struct replayStep *Steps;
+};
+
+static char treePath[] = "/tmp/replay_treeXXXXXX";
+
+// ---------------------------------------------------------------- dialogs, run in the child
+
+static void Replay_Menu(void)
+{
+    char *options[20];
+    char labels[20][16];
+
+    for (uint8_t index = 0; index < 20; index++)
+    {
+        sprintf(labels[index], "Option %u", index);
+        options[index] = labels[index];
+    }
+
+    ShowMessageBox("Replay", "Arrow storm over a menu", 20, options, DIALOG_BOX_STYLE_BLUE);
+}
+
+static void Replay_Slider(void)
+{
+    ShowSliderBox("Replay", "Arrow storm over a slider", 0, 50, 100, 0.1, DIALOG_BOX_STYLE_GREY);
+}
+
+static void Replay_Explorer(void)
+{
+    char path[4096] = "";
+
+    if (chdir(treePath) == 0)
+        ShowFileExplorer(path, "txt", "Replay", 0, DIALOG_BOX_STYLE_RED);
+}
+
+// ---------------------------------------------------------------- scripts
+
+#define BOUNCE_STORM    { KEYS_DOWN, 19, 0 },       { KEYS_UP, 19, 0 }         // from the first option to the last and back, as fast as possible
+#define BOUNCE_REPEAT   { KEYS_DOWN, 19, 30000 },   { KEYS_UP, 19, 30000 }     // same, at the speed of key repeat
+
+static const struct replayStep stepsMenu[] = {
+    BOUNCE_STORM, BOUNCE_STORM, BOUNCE_STORM, BOUNCE_STORM, BOUNCE_STORM, BOUNCE_STORM, BOUNCE_STORM, BOUNCE_STORM,
+    BOUNCE_REPEAT, BOUNCE_REPEAT,
+    { KEYS_ENTER,   1,      0 },
+    { NULL,         0,      0 }
+};
+
+static const struct replayStep stepsSlider[] = {
+    { KEYS_RIGHT,   400,    0 },
+    { KEYS_LEFT,    100,    30000 },
+    { KEYS_ENTER,   1,      0 },
+    { NULL,         0,      0 }
+};
+
+static const struct replayStep stepsTyping[] = {
+    { KEYS_RIGHT,   5,      20000 },    // "." (selected) ".." d0 d1 d2 d3
+    { KEYS_ENTER,   1,      0 },
+    { "f",          1,      20000 },
+    { "0",          2,      20000 },
+    { "3",          1,      20000 },
+    { "_",          1,      20000 },
+    { "4",          2,      20000 },
+    { "2",          2,      20000 },
+    { ".",          1,      20000 },
+    { "t",          1,      20000 },
+    { "x",          1,      20000 },
+    { "t",          1,      20000 },
+    { KEYS_BACKSPACE, 6,    20000 },
+    { KEYS_ESC,     1,      100000 },
+    { NULL,         0,      0 }
+};
+
+// into d0 and back, into d1 and back ... the files are spread in pages, so the arrows scroll through them too
+// the first item starts selected, but after a hop nothing is: the first right selects "."; backspace edits the name, which deselects
+static const struct replayStep stepsHops[] = {
+    { KEYS_RIGHT,   2,      5000 }, { KEYS_ENTER, 1, 20000 }, { KEYS_DOWN, 100, 0 }, { KEYS_BACKSPACE, 1, 5000 }, { KEYS_RIGHT, 2, 5000 }, { KEYS_ENTER, 1, 20000 },
+    { KEYS_RIGHT,   4,      5000 }, { KEYS_ENTER, 1, 20000 }, { KEYS_DOWN, 100, 0 }, { KEYS_BACKSPACE, 1, 5000 }, { KEYS_RIGHT, 2, 5000 }, { KEYS_ENTER, 1, 20000 },
+    { KEYS_RIGHT,   5,      5000 }, { KEYS_ENTER, 1, 20000 }, { KEYS_DOWN, 100, 0 }, { KEYS_BACKSPACE, 1, 5000 }, { KEYS_RIGHT, 2, 5000 }, { KEYS_ENTER, 1, 20000 },
+    { KEYS_RIGHT,   6,      5000 }, { KEYS_ENTER, 1, 20000 }, { KEYS_DOWN, 100, 0 }, { KEYS_BACKSPACE, 1, 5000 }, { KEYS_RIGHT, 2, 5000 }, { KEYS_ENTER, 1, 20000 },
+    { KEYS_ESC,     1,      100000 },
+    { NULL,         0,      0 }
+};
+
+static const struct replayScenario scenarios[] = {
+    { "menu",       Replay_Menu,        stepsMenu },
+    { "slider",     Replay_Slider,      stepsSlider },
+    { "typing",     Replay_Explorer,    stepsTyping },
+    { "hops",       Replay_Explorer,    stepsHops },
+};
+
+// ---------------------------------------------------------------- the file tree
+
+static uint8_t Replay_CreateTree(void)
+{
+    if (mkdtemp(treePath) == NULL)
+        return 0;
+
+    char path[256];
+    for (uint16_t directory = 0; directory < REPLAY_TREE_DIRECTORIES; directory++)
+    {
+        sprintf(path, "%s/d%u", treePath, directory);
+        mkdir(path, 0755);
+
+        for (uint16_t file = 0; file < REPLAY_TREE_FILES; file++)
+        {
+            sprintf(path, "%s/d%u/f%02u_%04u.txt", treePath, directory, directory, file);
+            int fd = open(path, O_CREAT | O_WRONLY, 0644);
+            if (fd >= 0)
+                close(fd);
+        }
+    }
+
+    return 1;
+}
+
+static int Replay_RemoveEntry(const char *path, const struct stat *info, int flag, struct FTW *walk)
+{
+    (void)info; (void)flag; (void)walk;
+    return remove(path);
+}
+
+// ---------------------------------------------------------------- the terminal side
+
+struct replayResult
+{
+    uint64_t SendTime[REPLAY_MAX_KEYS];
+    uint32_t NumKeys;
+    uint64_t *FrameEnds;
+    uint32_t NumFrames;
+    uint32_t FramesCapacity;
+    uint64_t Bytes;
+    char Tail[16];              // end of the previous read, for markers split between two reads
+};
+
+static uint8_t Replay_IsPrefix(const char *text, const char *marker) // text is the beginning of the marker, but not all of it
+{
+    size_t length = strlen(text);
+    return (length < strlen(marker) && strncmp(text, marker, length) == 0);
+}
+
+static void Replay_Scan(struct replayResult *result, int master, const char *data, size_t length)
+{
+    static const char frameEnd[] = "\x1b[?2026l";
+    static const char modeQuery[] = "\x1b[?2026$p";
+    static const char attributesQuery[] = "\x1b[c";
+
+    char window[sizeof(result->Tail) + 4096];
+    size_t tailLength = strlen(result->Tail);
+
+    memcpy(window, result->Tail, tailLength);
+    memcpy(window + tailLength, data, length);
+    window[tailLength + length] = '\0';
+
+    uint64_t now = Clock_GetMicroseconds();
+
+    for (char *marker = window; (marker = strstr(marker, frameEnd)) != NULL; marker += sizeof(frameEnd) - 1)
+    {
+        if (result->NumFrames == result->FramesCapacity)
+        {
+            result->FramesCapacity = result->FramesCapacity ? result->FramesCapacity * 2 : 1024;
+            result->FrameEnds = (uint64_t*)realloc(result->FrameEnds, result->FramesCapacity * sizeof(uint64_t));
+        }
+
+        result->FrameEnds[result->NumFrames++] = now;
+    }
+
+    if (strstr(window, modeQuery) != NULL) // claim support, so the frames are delimited
+        if (write(master, "\x1b[?2026;2$y", 11) < 0) (void)0;
+
+    if (strstr(window, attributesQuery) != NULL)
+        if (write(master, "\x1b[?62;22c", 9) < 0) (void)0;
+
+    result->Tail[0] = '\0'; // keep a marker that is not complete yet for the next read
+    char *last = strrchr(window, '\x1b');
+
+    if (last != NULL && (Replay_IsPrefix(last, frameEnd) || Replay_IsPrefix(last, modeQuery) || Replay_IsPrefix(last, attributesQuery)))
+        strcpy(result->Tail, last);
+}
+
+static void Replay_Pump(struct replayResult *result, int master, uint64_t until) // reads the output until the given time
+{
+    char buffer[4096];
+
+    for (;;)
+    {
+        uint64_t now = Clock_GetMicroseconds();
+        if (now >= until)
+            return;
+
+        struct pollfd output = { .fd = master, .events = POLLIN };
+        if (poll(&output, 1, (int)((until - now + 999) / 1000)) <= 0)
+            continue;
+
+        ssize_t length = read(master, buffer, sizeof(buffer));
+        if (length <= 0)
+            return; // the child closed the terminal
+
+        result->Bytes += length;
+        Replay_Scan(result, master, buffer, length);
+    }
+}
+
+static int Replay_CompareLatency(const void *a, const void *b)
+{
+    uint64_t first = *(const uint64_t*)a, second = *(const uint64_t*)b;
+    return (first > second) - (first < second);
+}
+
+static void Replay_Report(const char *name, struct replayResult *result)
+{
+    uint64_t latencies[REPLAY_MAX_KEYS];
+    uint32_t numLatencies = 0, frame = 0;
+
+    for (uint32_t key = 0; key < result->NumKeys; key++) // a key is on the screen when the first frame that ends after it was sent is complete
+    {
+        while (frame < result->NumFrames && result->FrameEnds[frame] < result->SendTime[key])
+            frame++;
+
+        if (frame < result->NumFrames && result->FrameEnds[frame] - result->SendTime[key] <= REPLAY_FRAME_TIMEOUT)
+            latencies[numLatencies++] = result->FrameEnds[frame] - result->SendTime[key];
+    }
+
+    qsort(latencies, numLatencies, sizeof(uint64_t), Replay_CompareLatency);
+
+    printf("%-8s %6u keys %6u frames %6u no frame | latency us: p50 %7llu  p99 %7llu  max %7llu | %8.1f bytes/key\n",
+        name, result->NumKeys, result->NumFrames, result->NumKeys - numLatencies,
+        numLatencies ? (unsigned long long)latencies[numLatencies / 2] : 0,
+        numLatencies ? (unsigned long long)latencies[(numLatencies * 99) / 100] : 0,
+        numLatencies ? (unsigned long long)latencies[numLatencies - 1] : 0,
+        result->NumKeys ? (double)result->Bytes / result->NumKeys : 0.0);
+}
+
+static void Replay_Run(const struct replayScenario *scenario)
+{
+    struct winsize size = { .ws_row = REPLAY_TERMINAL_HEIGHT, .ws_col = REPLAY_TERMINAL_WIDTH };
+    int master;
+
+    fflush(stdout);
+    pid_t child = forkpty(&master, NULL, NULL, &size);
+    if (child < 0)
+    {
+        perror("forkpty");
+        return;
+    }
+
+    if (child == 0)
+    {
+        scenario->Run();
+        fflush(stdout);
+        _exit(0);
+    }
+
+    struct replayResult *result = (struct replayResult*)calloc(1, sizeof(struct replayResult));
+
+    Replay_Pump(result, master, Clock_GetMicroseconds() + 300000); // let the dialog open
+    result->Bytes = 0; // only what the keys cost
+
+    for (const struct replayStep *step = scenario->Steps; step->Keys != NULL; step++)
+        for (uint16_t repeat = 0; repeat < step->Repeat && result->NumKeys < REPLAY_MAX_KEYS; repeat++)
+        {
+            result->SendTime[result->NumKeys++] = Clock_GetMicroseconds();
+            if (write(master, step->Keys, strlen(step->Keys)) < 0)
+                break;
+
+            Replay_Pump(result, master, Clock_GetMicroseconds() + step->Pace);
+        }
+
+    Replay_Pump(result, master, Clock_GetMicroseconds() + 500000); // the last frames
+
+    kill(child, SIGTERM);
+    waitpid(child, NULL, 0);
+    close(master);
+
+    Replay_Report(scenario->Name, result);
+
+    free(result->FrameEnds);
+    free(result);
+}
+
+int main(int argc, char** argv)
+{
+    if (!Replay_CreateTree())
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    for (size_t index = 0; index < sizeof(scenarios) / sizeof(scenarios[0]); index++)
+    {
+        uint8_t selected = (argc < 2);
+        for (int arg = 1; arg < argc; arg++)
+            selected |= (strcmp(argv[arg], scenarios[index].Name) == 0);
+
+        if (selected)
+            Replay_Run(&scenarios[index]);
+    }
+
+    nftw(treePath, Replay_RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+    return 0;
+}
+
+#else
+
+int main(int argc, char** argv)
+{
+    printf("The replay harness needs pseudo-terminals (UNIX only)\n");
+    return 1;
+}
+
+#endif
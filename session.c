@@ -0,0 +1,115 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+#include "session.h"
+#include "outputsink.h"         // routes stdout to the session of each thread
+#include "port_kbhit.h"         // portable kbhit and getch functions
+#include "../BrailleCanvas/BrailleCanvas/terminal.h" // -- get this file (and the matching .c file too) in the repo "BrailleCanvas" at: https://github.com/luizfeldmann/BrailleCanvas
+#include <stdlib.h>
+#include <string.h>
+
+static TerminalSession processSession = {
+    .InputDescriptor = 0,
+    .OutputDescriptor = 1,
+    .Stdio = 1,
+    .SyncSupported = -1,
+    .Lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static _Thread_local TerminalSession *boundSession = NULL;
+
+#if defined(unix) || defined(__unix__) || defined(__unix)
+
+uint8_t Session_Create(TerminalSession *session, int inputDescriptor, int outputDescriptor)
+{
+    if (!OutputSink_Route()) // stdout must be able to tell the threads apart
+        return 0;
+
+    memset(session, 0, sizeof(TerminalSession));
+    session->InputDescriptor = inputDescriptor;
+    session->OutputDescriptor = outputDescriptor;
+    session->SyncSupported = -1;
+
+    session->Output = (char*)malloc(SESSION_OUTPUT_BUFFER);
+    if (session->Output == NULL)
+        return 0;
+
+    pthread_mutex_init(&session->Lock, NULL);
+
+    return 1;
+}
+
+void Session_Destroy(TerminalSession *session)
+{
+    if (session->ModeInitialized && session->Mode != 0)
+        tcsetattr(session->InputDescriptor, TCSANOW, &session->ModeOriginal); // leave the terminal as it was found
+
+    if (boundSession == session)
+        boundSession = NULL;
+
+    pthread_mutex_destroy(&session->Lock);
+    free(session->Output);
+    session->Output = NULL;
+}
+
+#else
+
+uint8_t Session_Create(TerminalSession *session, int inputDescriptor, int outputDescriptor)
+{
+    (void)session; (void)inputDescriptor; (void)outputDescriptor;
+    return 0; // the console is the only terminal
+}
+
+void Session_Destroy(TerminalSession *session)
+{
+    (void)session;
+}
+
+#endif
+
+TerminalSession* Session_Bind(TerminalSession *session)
+{
+    TerminalSession *previous = boundSession;
+    boundSession = (session == &processSession) ? NULL : session;
+
+    return previous;
+}
+
+TerminalSession* Session_Current(void)
+{
+    return (boundSession != NULL) ? boundSession : &processSession;
+}
+
+int Session_Lock(void)
+{
+    TerminalSession *session = Session_Current();
+
+    if (session->Stdio)
+        return Terminal_Lock(); // the process terminal keeps the lock it always had, that other code may also hold
+
+    return pthread_mutex_lock(&session->Lock);
+}
+
+int Session_Unlock(void)
+{
+    TerminalSession *session = Session_Current();
+
+    if (session->Stdio)
+        return Terminal_Unlock();
+
+    return pthread_mutex_unlock(&session->Lock);
+}
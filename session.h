@@ -0,0 +1,76 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+#ifndef _SESSION_H_
+#define _SESSION_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+// A terminal the library draws on and reads keys from. Without sessions everything goes to the process terminal (stdin / stdout), as always.
+// A thread bound to a session (Session_Bind) draws on that one instead, through the same API, so one process can serve many terminals (ptys, sockets) at once.
+
+#define SESSION_OUTPUT_BUFFER   65536   // a whole frame fits, so it reaches the terminal in a single write
+#define SESSION_INPUT_BUFFER    64
+
+#if defined(unix) || defined(__unix__) || defined(__unix)
+    #include <termios.h>
+#endif
+
+typedef struct _TerminalSession
+{
+    int InputDescriptor;
+    int OutputDescriptor;
+    uint8_t Stdio;              // the process terminal: read through stdin and written through stdout
+
+    // input (keys read ahead, since the descriptor is read in blocks)
+    char Input[SESSION_INPUT_BUFFER];
+    uint8_t InputLength;
+    uint8_t InputOffset;
+    uint8_t InputClosed;
+
+    // output (written on Session_Flush, or when full)
+    char *Output;
+    size_t OutputLength;
+    uint8_t ScanState;          // of the escape sequence scanner, as sequences may be split between writes
+
+    // terminal mode
+    uint8_t ModeInitialized;
+    uint8_t Mode;               // see SetMode
+    #if defined(unix) || defined(__unix__) || defined(__unix)
+        struct termios ModeOriginal;
+        struct termios ModeModified;
+    #endif
+
+    // what is known about the terminal
+    uint8_t Width;
+    uint8_t Height;
+    uint8_t SizeKnown;
+    int8_t SyncSupported;       // -1 = not queried yet
+
+    pthread_mutex_t Lock;       // held by the dialog that is on the screen
+} TerminalSession;
+
+uint8_t Session_Create(TerminalSession *session, int inputDescriptor, int outputDescriptor); // returns 0 if sessions are not supported here (UNIX with glibc) ... from then on stdout reaches the terminals through OutputSink_Flush()
+void Session_Destroy(TerminalSession *session); // restores the terminal mode ... the descriptors are not closed
+TerminalSession* Session_Bind(TerminalSession *session); // the calling thread draws on this session from now on (NULL = the process terminal) ... returns the previous one
+TerminalSession* Session_Current(void); // never NULL
+
+int Session_Lock(void); // keeps other threads off the terminal of the calling thread ... returns 0 on success (same as Terminal_Lock)
+int Session_Unlock(void);
+
+#endif // _SESSION_H_
@@ -0,0 +1,143 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+#include "syncupdate.h"
+#include "port_kbhit.h"         // portable kbhit and getch functions
+#include "port_clock.h"         // monotonic time
+#include "session.h"            // the terminal of each thread
+#include "outputsink.h"         // pushes the query out
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SYNC_UPDATE_QUERY_TIMEOUT   200000 // [us] - terminals that do not answer the primary device attributes are not expected to exist, this is just a safety net
+
+#if defined(unix) || defined(__unix__) || defined(__unix)
+
+#include <unistd.h>
+
+enum { QUERY_TEXT, QUERY_ESCAPE, QUERY_CSI, QUERY_REPORT };
+
+static void SyncUpdate_KeepKeys(char *keys, size_t *numKeys, const char *bytes, size_t length) // keys typed ahead of the answer
+{
+    for (size_t index = 0; index < length && *numKeys < SESSION_INPUT_BUFFER; index++)
+        keys[(*numKeys)++] = bytes[index];
+}
+
+uint8_t SyncUpdate_Detect(void)
+{
+    TerminalSession *session = Session_Current(); // each terminal answers for itself
+
+    if (session->SyncSupported >= 0)
+        return session->SyncSupported;
+
+    const char *known = getenv(SYNC_UPDATE_ENVIRONMENT); // already asked by whoever started us
+    if (known != NULL && (known[0] == '0' || known[0] == '1'))
+        return (session->SyncSupported = known[0] - '0');
+
+    session->SyncSupported = 0;
+
+    if (!isatty(session->InputDescriptor) || !isatty(session->OutputDescriptor)) // nobody to answer the query
+        return 0;
+
+    char previousMode = SetMode(1); // the answer must not be echoed nor wait for a new line
+
+    // ask for mode 2026, then for the primary device attributes ... every terminal answers the latter, so once it arrives we know the former will not
+    fputs("\x1b[?2026$p" "\x1b[c", stdout);
+    OutputSink_Flush();
+
+    // the keys typed ahead arrive mixed with the reports: the reports are the sequences that start with "ESC [ ?", everything else is given back to be read as keys
+    uint8_t state = QUERY_TEXT; // how much of "ESC [ ?" was read
+    char answer[128], keys[SESSION_INPUT_BUFFER];
+    size_t length = 0, numKeys = 0;
+    uint64_t start = Clock_GetMicroseconds();
+
+    while (length < sizeof(answer) - 4) // room for "ESC [ ?" and the end
+    {
+        uint64_t elapsed = Clock_GetMicroseconds() - start;
+        if (elapsed >= SYNC_UPDATE_QUERY_TIMEOUT || !kbhitWait(SYNC_UPDATE_QUERY_TIMEOUT - elapsed))
+            break;
+
+        char ch = getchRaw();
+
+        if (state == QUERY_REPORT)
+        {
+            answer[length++] = ch;
+
+            if (ch >= 0x40 && ch <= 0x7E) // final byte
+            {
+                if (ch == 'c')
+                    break; // the device attributes report "ESC [ ? ... c" comes last
+
+                state = QUERY_TEXT;
+            }
+        }
+        else if (state == QUERY_CSI && ch == '?')
+        {
+            memcpy(&answer[length], "\x1b[?", 3);
+            length += 3;
+            state = QUERY_REPORT;
+        }
+        else if (state == QUERY_ESCAPE && ch == '[')
+            state = QUERY_CSI;
+        else
+        {
+            SyncUpdate_KeepKeys(keys, &numKeys, "\x1b[", (state == QUERY_CSI) ? 2 : (state == QUERY_ESCAPE) ? 1 : 0); // the start of a key sequence, not of a report
+            state = (ch == '\x1b') ? QUERY_ESCAPE : QUERY_TEXT;
+
+            if (state == QUERY_TEXT)
+                SyncUpdate_KeepKeys(keys, &numKeys, &ch, 1);
+        }
+    }
+
+    if (state == QUERY_ESCAPE || state == QUERY_CSI) // a key sequence cut short by the timeout
+        SyncUpdate_KeepKeys(keys, &numKeys, "\x1b[", (state == QUERY_CSI) ? 2 : 1);
+
+    ungetchRaw(keys, numKeys);
+
+    answer[length] = '\0';
+    SetMode(previousMode);
+
+    // the report is "ESC [ ? 2026 ; Ps $ y" where Ps is 1 (set), 2 (reset) or 3 (permanently set); 0 (unknown) and 4 (permanently reset) are not usable
+    char *report = strstr(answer, "\x1b[?2026;");
+    if (report != NULL && report[8] >= '1' && report[8] <= '3' && report[9] == '$')
+        session->SyncSupported = 1;
+
+    return session->SyncSupported;
+}
+
+#else
+
+uint8_t SyncUpdate_Detect(void)
+{
+    Session_Current()->SyncSupported = 0; // the windows console is not queried
+    return 0;
+}
+
+#endif
+
+void SyncUpdate_Begin(void)
+{
+    if (Session_Current()->SyncSupported == 1) // only what SyncUpdate_Detect found ... a frame never queries, it may be drawn by a thread that does not own the keys
+        fputs("\x1b[?2026h", stdout);
+}
+
+void SyncUpdate_End(void)
+{
+    if (Session_Current()->SyncSupported == 1)
+        fputs("\x1b[?2026l", stdout);
+}
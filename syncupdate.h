@@ -0,0 +1,33 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+#ifndef _SYNC_UPDATE_H_
+#define _SYNC_UPDATE_H_
+
+#include <stdint.h>
+
+// Synchronized output (DEC private mode 2026): the terminal holds the repaint between Begin and End, so a frame shows up at once instead of piece by piece
+// The terminal is queried only once (DECRQM), by SyncUpdate_Detect on the thread that reads its keys - the dialogs do it when they open; until then, and on terminals that do not answer, Begin and End write nothing
+// Programs started many times in a row (such as boxdialog from a script) can skip the query: the environment variable holds the answer, 1 or 0
+
+#define SYNC_UPDATE_ENVIRONMENT     "BOXCANVAS_SYNC_UPDATE"
+
+uint8_t SyncUpdate_Detect(void);    // returns 1 if the terminal supports it ... the keys typed ahead are kept for getch
+void SyncUpdate_Begin(void);
+void SyncUpdate_End(void);
+
+#endif // _SYNC_UPDATE_H_
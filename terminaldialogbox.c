@@ -20,28 +20,22 @@
 #include "port_kbhit.h"         // portable kbhit and getch functions
 #include "tinydir.h"            // get this file at https://github.com/cxong/tinydir
 #include "boxcanvas.h"          // draws boxing using ascii/unicode characters
+#include "framescheduler.h"     // paces the redraws to a maximum frame rate
+#include "terminalsize.h"       // cached terminal size
+#include "renderstats.h"        // counts what each dialog costs
+#include "dirwatch.h"           // live updates of the browsed directory
+#include "chromecache.h"        // the dialog frames are encoded once
+#include "session.h"            // the terminal of each thread
+#include "lineindex.h"          // large files are mapped and indexed in the background
+#include "port_clock.h"         // the progress dialog samples at its own pace
+#include "widget.h"             // the dialogs are trees of widgets that only redraw what changed
+#include "arena.h"              // scratch memory reused from one dialog to the next
+#include "syncupdate.h"         // asked when a dialog opens
 #include <stdio.h>              // printf, fwrite etc
 #include <ctype.h>              // upper, lower, numerical and alphabetical types
+#include <stdlib.h>             // strtoull
 
-struct dialogBoxStyle
-{
-    // box
-    ConsoleStyleText        BoxText;
-    ConsoleStyleBackground  BoxBack;
-    // title
-    ConsoleStyleText        TitleText;
-    ConsoleStyleBackground  TitleBack;
-    // message
-    ConsoleStyleText        ContentText;
-    ConsoleStyleBackground  ContentBack;
-    // options
-    ConsoleStyleText        OptionsText_Active;
-    ConsoleStyleBackground  OptionsBack_Active;
-    ConsoleStyleText        OptionsText_Normal;
-    ConsoleStyleBackground  OptionsBack_Normal;
-};
-
-struct dialogBoxStyle stylePalette[] = {
+static const WidgetStyle stylePalette[] = { // shared by all sessions, so it must not change
                                                     /* 0 */
     {   .BoxText            = CONSOLE_STYLE_TEXT_WHITE,     .BoxBack            = CONSOLE_STYLE_BACKGROUND_GREY,
         .TitleText          = CONSOLE_STYLE_TEXT_BLACK,     .TitleBack          = CONSOLE_STYLE_BACKGROUND_WHITE,
@@ -62,498 +56,1258 @@ struct dialogBoxStyle stylePalette[] = {
         .OptionsText_Normal = CONSOLE_STYLE_TEXT_WHITE,     .OptionsBack_Normal = CONSOLE_STYLE_BACKGROUND_RED}
 };
 
-void PrintWidth(uint8_t width, uint8_t centered, const char* text)
+struct textBox // what the size of a message or slider box depends on
 {
-    //if (width % 2 == 1) // if it's odd
-    //    width--; // make it even
+    const char *Title;
+    const char *Text;
+    uint8_t NumOptions;
+    char **Options;
+    TextWrap *Wrap;         // of the text of a message box
+};
 
-    uint8_t len = strlen(text);
-    if (len > width)
-        printf("%.*s..%s", width/2 -1, text, &text[strlen(text) - width/2 + 1] );
-    else if (len == width)
-        printf("%s", text);
-    else
-    {
-        uint8_t leftComplete = centered ? (width-len)/2 : 0;
-        uint8_t rightComplete = width - len - leftComplete;
+static void SliderBox_Layout(WidgetArea *area, void *context)
+{
+    const struct textBox *box = (const struct textBox*)context;
 
-        for (;leftComplete>0;leftComplete--)
-            printf(" ");
+    uint8_t termW, termH;
+    TerminalSize_Get(&termW, &termH);
 
-        printf("%s", text);
+    area->H = 7; // top border (title) / text / values / slider / blank / bottom border
+    area->W = min(max(max(TextWidth_String(box->Title),TextWidth_String(box->Text)) + 2, termW/2), termW); // left border / content / right border
 
-        for (;rightComplete>0;rightComplete--)
-            printf(" ");
-    }
+    // center on terminal
+    area->X = (termW - area->W)/2;
+    area->Y = (termH - area->H)/2;
 }
 
-float ShowSliderBox(const char *title, const char *text, float minValue, float curValue, float maxValue, float increment, DialogBoxStyle styleSelector)
+static void MessageBox_Layout(WidgetArea *area, void *context)
 {
-    #if (defined(unix) || defined(__unix__) || defined(__unix))
-        uint8_t bSliderboxUseUTF8 = 1;
-    #elif (defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN32__))
-        uint8_t bSliderboxUseUTF8 = (GetConsoleOutputCP() == CP_UTF8);
-    #endif
+    const struct textBox *box = (const struct textBox*)context;
 
-    // get the dimensions
     uint8_t termW, termH;
-    Terminal_GetSize(&termW, &termH);
+    TerminalSize_Get(&termW, &termH);
+
+    size_t columns = TextWidth_String(box->Title); // what cannot be wrapped
+    for (uint8_t optIndex = 0; optIndex < box->NumOptions; optIndex++)
+        columns = max(columns, TextWidth_String(box->Options[optIndex]));
 
-    uint8_t dialogHeight = 7; // top border (title) / text / values / slider / blank / bottom border
-    uint8_t dialogWidth = min(max(max(strlen(title),strlen(text)) + 2, termW/2), termW); // left border / content / right border
+    const TextWrapLayout *text = TextWrap_Get(box->Wrap, TEXT_WRAP_UNLIMITED); // as wide as its longest line, if that fits ...
+    size_t textColumns = (text != NULL) ? text->Columns : 0;
+    size_t maxColumns = max(3*termW/4, columns); // ... or wrapped to most of the terminal
+    columns = min(max(columns, textColumns), maxColumns);
+
+    text = TextWrap_Get(box->Wrap, (uint16_t)max(columns, 1));
+    size_t numLines = (text != NULL) ? text->NumLines : 1;
+    numLines = max(min(numLines, (size_t)max(termH - box->NumOptions - 4, 1)), 1); // the lines that do not fit in the terminal are cut off
+
+    area->H = numLines + box->NumOptions + 3; // top border (title) / text / divider / option1...optionN / bottom border
+    area->W = columns + 2; // left border / content / right border
 
     // center on terminal
-    uint8_t dialogX = (termW - dialogWidth)/2;
-    uint8_t dialogY = (termH - dialogHeight)/2;
+    area->X = (termW - area->W)/2;
+    area->Y = (termH - area->H)/2;
+}
 
-    // get the style from the palette
-    struct dialogBoxStyle* style = &stylePalette[styleSelector];
+// the boxes of each dialog, drawn once for each size and style (see ChromeCache_Render)
 
-    // create and configure canvas
-    BoxCanvas canvas;
-    BoxCanvas_Create(&canvas, dialogX, dialogY, dialogWidth, dialogHeight);
-    canvas.BackgroundStyle  = style->BoxBack;
-    canvas.FillStyle        = style->BoxText;
+static void SliderBox_DrawChrome(BoxCanvas *canvas, uint8_t split)
+{
+    BoxCanvas_Box(canvas, 0, 0, canvas->Width, canvas->Height, BOX_STYLE_STRONG | BOX_STYLE_SHADOW);   // window
+    (void)split;
+}
 
-    BoxCanvas_Box(&canvas, 0, 0, dialogWidth, dialogHeight, BOX_STYLE_STRONG | BOX_STYLE_SHADOW);   // window
+static void MessageBox_DrawChrome(BoxCanvas *canvas, uint8_t split)
+{
+    BoxCanvas_Box(canvas, 0, 0, canvas->Width, canvas->Height, BOX_STYLE_STRONG | BOX_STYLE_SHADOW);   // the big box
+    BoxCanvas_Box(canvas, 0, 0, canvas->Width, split + 1,      BOX_STYLE_WEAK   | BOX_STYLE_NOSHADOW); // the small box, as tall as the text
+}
 
-    // draw to the screen
-    Terminal_Lock();
-    Terminal_SaveCursorPosition();
+static void FileExplorer_DrawChrome(BoxCanvas *canvas, uint8_t split)
+{
+    BoxCanvas_Box(canvas, 0, 0, canvas->Width, canvas->Height, BOX_STYLE_STRONG | BOX_STYLE_SHADOW ); // outside border
+    BoxCanvas_Box(canvas, 0, 0, canvas->Width, 3,              BOX_STYLE_WEAK   | BOX_STYLE_NOSHADOW); // box for "folder name"
+    BoxCanvas_Box(canvas, 0, 0, canvas->Width, 5,              BOX_STYLE_STRONG | BOX_STYLE_NOSHADOW); // box for "file name"
+    (void)split;
+}
 
-    // draw the form
-    BoxCanvas_Render(&canvas);
-    BoxCanvas_Destroy(&canvas);
+static void FileExplorer_Layout(WidgetArea *area, void *context)
+{
+    uint8_t termW, termH;
+    TerminalSize_Get(&termW, &termH);
 
-    // print title
-    Terminal_SetCursorPosition(dialogX+1,dialogY);
-    Terminal_SetStyle(style->TitleText, style->TitleBack);
-    PrintWidth(dialogWidth-2,1,title);
+    area->W = 3*termW/4;
+    area->H = 3*termH/4;
+    area->X = termW/8;
+    area->Y = termH/8;
 
-    // print message
-    Terminal_SetCursorPosition(dialogX+1,dialogY+2);
-    Terminal_SetStyle(style->ContentText, style->ContentBack);
-    PrintWidth(dialogWidth-2,1,text);
+    (void)context;
+}
 
-    // print the slider-bar
-    char slider[1000];
+static WidgetAction Dialog_CloseOnEnter(WidgetDialog *dialog, char key, uint8_t used) // for the dialogs that can only be accepted
+{
+    (void)dialog;
+    (void)used;
+    return (key == KEY_ENTER || key == KEY_RETURN) ? WIDGET_CLOSE : WIDGET_CONTINUE;
+}
 
-    DRAWSLIDER:
+static WidgetAction Dialog_CloseOnEnterOrEsc(WidgetDialog *dialog, char key, uint8_t used) // for the dialogs that can be dismissed
+{
+    (void)dialog;
+    (void)used;
+    return (key == KEY_ENTER || key == KEY_RETURN || key == KEY_ESC) ? WIDGET_CLOSE : WIDGET_CONTINUE;
+}
 
-    // min max values
-    slider[0] = '\0';
+static char SliderBox_Show(const char *title, const char *text, float minValue, float *value, float maxValue, float increment, DialogBoxStyle styleSelector, WidgetAction (*onKey)(WidgetDialog*, char, uint8_t)) // returns the key that closed it
+{
+    struct textBox box = { .Title = title, .Text = text };
 
-    size_t formatWidth = sprintf(slider, "%4.2f", minValue); // min value
+    Widget window, message, slider;
+    Widget_InitPanel(&window, NULL, (WidgetPlacement){0, 0, 0, 0}, SliderBox_DrawChrome, title, WIDGET_TITLE_FULL);
+    Widget_InitLabel(&message, &window, (WidgetPlacement){1, 2, -1, 3}, text, WIDGET_ROLE_CONTENT, 1);
+    Widget_InitSlider(&slider, &window, (WidgetPlacement){1, 3, -1, 6}, minValue, *value, maxValue, increment); // values / slider / current value
 
-    for (uint8_t i = 0; i < (dialogWidth-4 - formatWidth*2); i++)
-        strcat(slider, " ");                                // spaces
+    WidgetDialog dialog;
+    WidgetDialog_Init(&dialog, &window, &stylePalette[styleSelector], SliderBox_Layout, &box, RENDER_STATS_SLIDER_BOX);
+    dialog.Focus = &slider;
+    dialog.OnKey = onKey;
 
-    sprintf(slider, "%.*s%4.2f", (int)min(strlen(slider), sizeof(slider)-formatWidth-1),slider, maxValue);
+    char kb = WidgetDialog_Run(&dialog);
+    if (kb != KEY_ESC)
+        *value = slider.Slider.Value;
 
-    Terminal_SetStyle(style->OptionsText_Normal, style->OptionsBack_Normal);
-    Terminal_SetCursorPosition(dialogX+2,dialogY+3);
-    printf("%s", slider);
+    return kb;
+}
 
-    // bar
-    uint8_t sliderLength = dialogWidth - 6;
-    slider[0] = '\0';
-    sprintf(slider, bSliderboxUseUTF8 ? "\xE2\x94\x9C" : "|"); // starter
+float ShowSliderBox(const char *title, const char *text, float minValue, float curValue, float maxValue, float increment, DialogBoxStyle styleSelector)
+{
+    SliderBox_Show(title, text, minValue, &curValue, maxValue, increment, styleSelector, Dialog_CloseOnEnter);
+    return curValue;
+}
 
-    uint8_t markerPosition = (uint8_t) (sliderLength * (curValue - minValue) / (maxValue - minValue));
+uint8_t ShowRangeBox(const char *title, const char *text, float minValue, float *value, float maxValue, float increment, DialogBoxStyle styleSelector)
+{
+    return (SliderBox_Show(title, text, minValue, value, maxValue, increment, styleSelector, Dialog_CloseOnEnterOrEsc) != KEY_ESC);
+}
 
-    for (uint8_t i = 0; i < sliderLength; i++)
-        if (i == markerPosition)
-            strcat(slider, bSliderboxUseUTF8 ? "\xE2\x95\x91" : "X");
-        else
-            strcat(slider, bSliderboxUseUTF8 ? "\xE2\x94\x80" : "-");
+static uint8_t MessageBox_Show(const char *title, const char *text, uint8_t numOptions, char* options[], DialogBoxStyle styleSelector, WidgetAction (*onKey)(WidgetDialog*, char, uint8_t))
+{
+    numOptions = min(numOptions, MESSAGE_BOX_MAX_OPTIONS); // they are placed from the bottom, as far as a signed placement goes
 
-    strcat(slider, bSliderboxUseUTF8 ? "\xE2\x94\xA4" : "|");
+    TextWrap wrap;
+    TextWrap_Init(&wrap, text);
+    struct textBox box = { .Title = title, .Text = text, .NumOptions = numOptions, .Options = options, .Wrap = &wrap };
 
-    Terminal_SetCursorPosition(dialogX+2,dialogY+4);
-    Terminal_SetStyle(style->OptionsText_Active, style->OptionsBack_Active);
-    printf("%s", slider);
+    Widget window, message, buttons; // the options are placed from the bottom, so the text takes the rows left above them
+    Widget_InitPanel(&window, NULL, (WidgetPlacement){0, 0, 0, 0}, MessageBox_DrawChrome, title, WIDGET_TITLE_FULL);
+    window.Panel.Split = -(int8_t)(numOptions + 2);
+    Widget_InitParagraph(&message, &window, (WidgetPlacement){1, 1, -1, -(int8_t)(numOptions + 2)}, &wrap, WIDGET_ROLE_CONTENT, 1);
+    Widget_InitButtons(&buttons, &window, (WidgetPlacement){1, -(int8_t)(numOptions + 1), -1, -1}, numOptions, options);
 
-    // current value
-    slider[0] = '\0';
-    for (uint8_t i = 0; i < dialogWidth-2; i++)
-        if (i == markerPosition + 2 - ((markerPosition > sliderLength/2) ? formatWidth-1 : 0) )
-            i = sprintf(slider, "%.*s%4.2f", (int)min(strlen(slider), sizeof(slider)-4-1), slider, curValue);
-        else
-            strcat(slider, " ");
+    WidgetDialog dialog;
+    WidgetDialog_Init(&dialog, &window, &stylePalette[styleSelector], MessageBox_Layout, &box, RENDER_STATS_MESSAGE_BOX);
+    dialog.Focus = &buttons;
+    dialog.OnKey = onKey;
 
-    Terminal_SetStyle(style->OptionsText_Normal, style->OptionsBack_Normal);
-    Terminal_SetCursorPosition(dialogX+1,dialogY+5);
-    printf("%s", slider);
+    char kb = WidgetDialog_Run(&dialog);
+    TextWrap_Destroy(&wrap);
 
-    for (;;)
+    if (kb == 0) // cannot let anything else mess the screen while the dialog is on
+        return 0;
+
+    if (kb == KEY_ESC)
+        return MESSAGE_BOX_ESC;
+
+    return (uint8_t)buttons.List.Selected;
+}
+
+uint8_t ShowMessageBox(const char *title, const char *text, uint8_t numOptions, char* options[], DialogBoxStyle styleSelector)
+{
+    return MessageBox_Show(title, text, numOptions, options, styleSelector, Dialog_CloseOnEnter);
+}
+
+uint8_t ShowChoiceBox(const char *title, const char *text, uint8_t numOptions, char* options[], DialogBoxStyle styleSelector)
+{
+    return MessageBox_Show(title, text, numOptions, options, styleSelector, Dialog_CloseOnEnterOrEsc);
+}
+
+struct fileExplorer
+{
+    tinydir_dir Dir;
+    DirWatch Watch;
+    char FolderPath[_TINYDIR_PATH_MAX];
+    char FileName[_TINYDIR_PATH_MAX];
+    char ItemText[_TINYDIR_PATH_MAX + 2];   // of the file being drawn
+    tinydir_file Entry;                     // read by the listing and the keys
+    const char *FilterExtension;
+    char *OutFilename;
+    uint8_t FileMustExist;
+
+    Widget Window;
+    Widget Folder;
+    Widget File;
+    Widget Files;
+    Widget Pages;
+    char PagesText[100];
+    TextWidthCache Widths;  // of the files, measured when first shown
+};
+
+static const char* FileExplorer_GetItem(void *context, uint32_t index)
+{
+    struct fileExplorer *explorer = (struct fileExplorer*)context;
+    tinydir_file *file = &explorer->Entry; // too big for the stack of every thread
+
+    if (tinydir_readfile_n(&explorer->Dir, file, index) == -1)
+        return "Tinydir error";
+
+    if (file->is_dir)
+        sprintf(explorer->ItemText, "[%s]", file->name);
+    else
+        sprintf(explorer->ItemText, "%s", file->name);
+
+    return explorer->ItemText;
+}
+
+static void FileExplorer_Rewatch(DirWatch *watch, FrameScheduler *scheduler, const char *path) // after the listing was read again
+{
+    DirWatch_Close(watch);
+    DirWatch_Open(watch, path);
+    FrameScheduler_Watch(scheduler, DirWatch_GetDescriptor(watch));
+}
+
+static DirWatchChange FileExplorer_ApplyChanges(DirWatch *watch, tinydir_dir *dir, int64_t *SelectionIndex, const char *filename, size_t *redrawFirst)
+{
+    char name[_TINYDIR_FILENAME_MAX];
+    uint8_t is_dir;
+    DirWatchChange change, applied = DIR_WATCH_NONE;
+
+    while ((change = DirWatch_Next(watch, name, &is_dir)) != DIR_WATCH_NONE)
     {
-        char kb =  getchNavigation();
+        if (change == DIR_WATCH_RESCAN)
+            return DIR_WATCH_RESCAN; // the caller reads it all again
 
-        if (kb == KEY_ENTER || kb == KEY_RETURN)
-            break;
+        size_t numFiles = dir->n_files;
+        size_t index = (change == DIR_WATCH_ADDED) ? DirWatch_Insert(watch, dir, name) : DirWatch_Remove(dir, name, is_dir);
 
-        if (kb == KEY_ARROW_LEFT && curValue - increment >= minValue)
+        if (index == DIR_WATCH_NOT_FOUND)
+            continue;
+
+        // the files after the change moved one place, and the selection moves with its file
+        if (dir->n_files > numFiles)
         {
-            curValue -= increment;
-            goto DRAWSLIDER;
+            if (*SelectionIndex >= 0 && index <= (size_t)*SelectionIndex)
+                (*SelectionIndex)++;
+            else if (*SelectionIndex < 0 && strcmp(name, filename) == 0)
+                *SelectionIndex = index; // the name being typed just came into existence
         }
-
-        else if (kb == KEY_ARROW_RIGHT && curValue + increment <= maxValue )
+        else if (dir->n_files < numFiles)
         {
-            curValue += increment;
-            goto DRAWSLIDER;
+            if (index == (size_t)*SelectionIndex)
+                *SelectionIndex = -1; // keep the name, but nothing is selected
+            else if (*SelectionIndex >= 0 && index < (size_t)*SelectionIndex)
+                (*SelectionIndex)--;
         }
-    }
 
-    Terminal_RestoreCursorSavedPosition();
-    Terminal_Unlock();
+        *redrawFirst = min(*redrawFirst, index); // the files before it are still right on the screen
+        applied = change;
+    }
 
-    return curValue;
+    return applied;
 }
 
-uint8_t ShowMessageBox(const char *title, const char *text, uint8_t numOptions, char* options[], DialogBoxStyle styleSelector)
+static void FileExplorer_Reopen(struct fileExplorer *explorer, FrameScheduler *scheduler) // discard the listing and read it again
 {
-    if (Terminal_Lock() != 0) // cannot let anything else mess the screen while the dialog is on
-        return 0;
-
-    uint8_t termW, termH;
-    Terminal_GetSize(&termW, &termH);
-    Terminal_SaveCursorPosition();
+    tinydir_close(&explorer->Dir);
+    tinydir_open_sorted(&explorer->Dir, explorer->FolderPath);
+    FileExplorer_Rewatch(&explorer->Watch, scheduler, explorer->FolderPath);
+    Widget_SetItems(&explorer->Files, explorer->Dir.n_files);
+}
 
-    uint8_t dialogHeight = numOptions + 4; // top border (title) / text / divider / option1...optionN / bottom border
-    uint8_t dialogWidth = max(strlen(title),strlen(text));
-    for (uint8_t optIndex = 0; optIndex < numOptions; optIndex++)
-        dialogWidth = max(dialogWidth, strlen(options[optIndex]));
-    dialogWidth += 2; // left border / content / right border
+static void FileExplorer_OnWatch(WidgetDialog *dialog)
+{
+    struct fileExplorer *explorer = (struct fileExplorer*)dialog->Context;
 
-    // center on terminal
-    uint8_t dialogX = (termW - dialogWidth)/2;
-    uint8_t dialogY = (termH - dialogHeight)/2;
+    int64_t selection = explorer->Files.List.Selected;
+    size_t redrawFirst = (size_t)-1;
 
-    struct dialogBoxStyle* style = &stylePalette[styleSelector]; // get the style from the palette
+    DirWatchChange change = FileExplorer_ApplyChanges(&explorer->Watch, &explorer->Dir, &selection, explorer->FileName, &redrawFirst);
 
-    // create and configure canvas
-    BoxCanvas canvas;
-    BoxCanvas_Create(&canvas, dialogX, dialogY, dialogWidth, dialogHeight);
+    if (change == DIR_WATCH_RESCAN)
+        FileExplorer_Reopen(explorer, &dialog->Scheduler);
+    else if (change != DIR_WATCH_NONE) // only the files from the first one that changed are drawn again
+    {
+        Widget_ItemsChanged(&explorer->Files, explorer->Dir.n_files, (uint32_t)min(redrawFirst, UINT32_MAX));
+        Widget_Select(&explorer->Files, selection);
+    }
+}
 
-    canvas.BackgroundStyle  = style->BoxBack;
-    canvas.FillStyle        = style->BoxText;
+static void FileExplorer_BeforeRender(WidgetDialog *dialog)
+{
+    struct fileExplorer *explorer = (struct fileExplorer*)dialog->Context;
+    uint32_t page, numPages;
 
-    BoxCanvas_Box(&canvas, 0, 0, dialogWidth, dialogHeight, BOX_STYLE_STRONG | BOX_STYLE_SHADOW);   // the big box
-    BoxCanvas_Box(&canvas, 0, 0, dialogWidth, 3,            BOX_STYLE_WEAK   | BOX_STYLE_NOSHADOW); // the small box
-    BoxCanvas_Render(&canvas);
+    Widget_ListPage(&explorer->Files, &page, &numPages);
 
-    // print title
-    Terminal_SetCursorPosition(dialogX+1,dialogY);
-    Terminal_SetStyle(style->TitleText, style->TitleBack);
-    PrintWidth(dialogWidth-2,1,title);
+    if (numPages > 1) // if more than 1, then show a status bar indicating that...
+        sprintf(explorer->PagesText, "Page %u/%u", page+1, numPages);
+    else
+        explorer->PagesText[0] = '\0';
 
-    // print message
-    Terminal_SetCursorPosition(dialogX+1,dialogY+1);
-    Terminal_SetStyle(style->ContentText, style->ContentBack);
-    PrintWidth(dialogWidth-2,1,text);
+    Widget_SetText(&explorer->Pages, explorer->PagesText);
+}
 
-    // print the options
-    uint8_t selectedOption = 0;
+static WidgetAction FileExplorer_OnKey(WidgetDialog *dialog, char kb, uint8_t used)
+{
+    struct fileExplorer *explorer = (struct fileExplorer*)dialog->Context;
+    tinydir_file *file = &explorer->Entry;
 
-    DRAWOPTIONS:
-    for (uint8_t opt = 0; opt < numOptions; opt++)
+    if (used) // the arrows moved the selection: its name goes to the filename
     {
-        Terminal_SetCursorPosition(dialogX+1,dialogY+3+opt);
-        if (opt == selectedOption)
-            Terminal_SetStyle(style->OptionsText_Active, style->OptionsBack_Active);
-        else
-            Terminal_SetStyle(style->OptionsText_Normal, style->OptionsBack_Normal);
+        if (tinydir_readfile_n(&explorer->Dir, file, explorer->Files.List.Selected) != -1)
+            strcpy(explorer->FileName, file->name);
 
-        PrintWidth(dialogWidth-2,1,options[opt]);
+        Widget_Invalidate(&explorer->File);
+        return WIDGET_CONTINUE;
     }
 
-    READKB:
-    switch (getchNavigation())
+    switch (kb)
     {
-        case KEY_ARROW_UP:
-            if (selectedOption>0)
-                selectedOption--;
-            goto DRAWOPTIONS;
-        break;
-
-        case KEY_ARROW_DOWN:
-            if (selectedOption<numOptions-1)
-                selectedOption++;
-            goto DRAWOPTIONS;
-        break;
+        case KEY_BACKSPACE: // backspace
+            if (strlen(explorer->FileName) == 0)
+                return WIDGET_CONTINUE;
 
-        case KEY_ENTER:
-        case KEY_RETURN: // on <enter> just exit the loop and follow along ...
+            explorer->FileName[strlen(explorer->FileName) - 1] = '\0';
             break;
 
-        default: goto READKB; break; // unknown key will repeat the loop
+        case KEY_ESC: // esc key
+            return WIDGET_CLOSE;
+
+        case KEY_ENTER:
+        case KEY_RETURN: // enter key to navigate or accept file
+            if (explorer->Files.List.Selected >= 0) // something is selected
+            {
+                if (tinydir_readfile_n(&explorer->Dir, file, explorer->Files.List.Selected) == -1) // read failure
+                    return WIDGET_CONTINUE;
+
+                if (file->is_dir) // browse new directory
+                {
+                    if (tinydir_open_subdir_n(&explorer->Dir, explorer->Files.List.Selected) != -1) // open success
+                    {
+                        strcpy(explorer->FolderPath, explorer->Dir.path); // update folderpath
+                        FileExplorer_Rewatch(&explorer->Watch, &dialog->Scheduler, explorer->FolderPath);
+                        strcpy(explorer->FileName, ""); // clear filename
+                        Widget_SetItems(&explorer->Files, explorer->Dir.n_files); // de-select item on new folder
+                        Widget_Invalidate(&explorer->Folder);
+                        Widget_Invalidate(&explorer->File);
+                    }
+                    else // failed to open ... may cause error - discard current session and reopen
+                        FileExplorer_Reopen(explorer, &dialog->Scheduler);
+                }
+                else if (strcmp(file->extension, explorer->FilterExtension) == 0 || strlen(explorer->FilterExtension) == 0) // accept the file if the extension matches (or there is no filter)
+                {
+                    strcpy(explorer->OutFilename, file->path);
+                    return WIDGET_CLOSE;
+                }
+            }
+            else if (!explorer->FileMustExist) // nothing is selected, but it does not have to be
+            {
+                char *ptrDot;
+                char *ext = &explorer->FileName[0]; // we begin with the full file name
+
+                while ((ptrDot = strstr(ext, ".")) > 0) // while there is dot in the name...
+                    ext = ptrDot+1; // we move past it ... until there is no more dots
+
+                if (strcmp(explorer->FilterExtension, ext) == 0 || strlen(explorer->FilterExtension) == 0)
+                {
+                    sprintf(explorer->OutFilename, "%s/%s", explorer->Dir.path, explorer->FileName);
+                    return WIDGET_CLOSE;
+                }
+            }
+            return WIDGET_CONTINUE;
+
+        default:
+            if (!(isalnum(kb) || kb == '.' || kb == '_' || kb == ' '))
+                return WIDGET_CONTINUE; // this character serves no purpose
+
+            if (strlen(explorer->FileName) >= _TINYDIR_FILENAME_MAX-1)
+                return WIDGET_CONTINUE;
+
+            sprintf(&explorer->FileName[strlen(explorer->FileName)], "%c", kb);
+            break;
     }
 
-    BoxCanvas_Destroy(&canvas);
+    // the user typed a filename: select the file with that name if there is any
+    int64_t selection = -1;
 
-    Terminal_RestoreCursorSavedPosition();
-    Terminal_Unlock();
+    for (size_t index = 0; index < explorer->Dir.n_files; index++)
+        if (tinydir_readfile_n(&explorer->Dir, file, index) != -1)
+            if (strcmp(file->name, explorer->FileName) == 0 && strlen(file->name)>0)
+            {
+                selection = index;
+                break;
+            }
 
-    return selectedOption;
-}
+    Widget_Select(&explorer->Files, selection);
+    Widget_Invalidate(&explorer->File);
 
+    return WIDGET_CONTINUE;
+}
 
 uint8_t ShowFileExplorer(char *out_filename, const char* filterextension, const char* title, uint8_t fileMustExist, DialogBoxStyle styleSelector)
 {
-    if (Terminal_Lock() != 0)
+    Arena *scratch = Arena_Scratch(); // the state is tens of kilobytes of paths: kept off the stack, and reused by the next dialog
+    ArenaMark mark = Arena_Mark(scratch);
+    struct fileExplorer *explorer = (struct fileExplorer*)Arena_Alloc(scratch, sizeof(struct fileExplorer));
+    if (explorer == NULL)
         return 0;
 
-    uint8_t termW, termH;
-    Terminal_GetSize(&termW, &termH);
-    Terminal_SaveCursorPosition();
+    strcpy(explorer->FolderPath, ".");
+    strcpy(explorer->FileName, "");
+    explorer->FilterExtension = filterextension;
+    explorer->OutFilename = out_filename;
+    explorer->FileMustExist = fileMustExist;
 
-    uint16_t diagW = 3*termW/4;
-    uint16_t diagH = 3*termH/4;
-    uint16_t diagX = termW/8;
-    uint16_t diagY = termH/8;
-
-    struct dialogBoxStyle* style = &stylePalette[styleSelector];
-
-    // dimensions of browser
-    uint8_t numRows = diagH-7;
-    uint8_t numCols = 4;
-    uint8_t widCols = (diagW-2)/numCols;
-    uint8_t clearBack = 1;
-
-    // draw the form
-    BoxCanvas canvas;
-    BoxCanvas_Create(&canvas, diagX, diagY, diagW, diagH);
-    canvas.BackgroundStyle  = style->BoxBack;
-    canvas.FillStyle        = style->BoxText;
-    BoxCanvas_Box(&canvas, 0, 0, diagW, diagH, BOX_STYLE_STRONG | BOX_STYLE_SHADOW ); // outside border
-    BoxCanvas_Box(&canvas, 0, 0, diagW, 3,     BOX_STYLE_WEAK   | BOX_STYLE_NOSHADOW); // box for "folder name"
-    BoxCanvas_Box(&canvas, 0, 0, diagW, 5,     BOX_STYLE_STRONG | BOX_STYLE_NOSHADOW); // box for "file name"
-    BoxCanvas_Render(&canvas);
-    BoxCanvas_Destroy(&canvas);
-
-    // draw the title
-    Terminal_SetCursorPosition(diagX+diagW/4,diagY);
-    Terminal_SetStyle(style->TitleText, style->TitleBack);
-    PrintWidth(diagW/2,1,title);
-
-    uint8_t currentPage = 0;
-    int16_t SelectionIndex = 0; // must be signed because value -1 is used to indicate "nothing selected"
-    char folderpath[_TINYDIR_PATH_MAX] = ".";
-    char filename[_TINYDIR_PATH_MAX] = "";
-
-    tinydir_dir dir;
-    tinydir_file file;
-
-    if (tinydir_open_sorted(&dir, folderpath) == -1)
+    if (tinydir_open_sorted(&explorer->Dir, explorer->FolderPath) == -1)
         printf("Tinydir error");
 
-    char kb;
-    for (;;) // keep in this loop reading keyboard
+    Widget_InitPanel(&explorer->Window, NULL, (WidgetPlacement){0, 0, 0, 0}, FileExplorer_DrawChrome, title, WIDGET_TITLE_HALF);
+    Widget_InitTextField(&explorer->Folder, &explorer->Window, (WidgetPlacement){1, 1, -2, 2}, "Directory: ", explorer->FolderPath, sizeof(explorer->FolderPath));
+    Widget_InitTextField(&explorer->File, &explorer->Window, (WidgetPlacement){1, 3, -2, 4}, "File name: ", explorer->FileName, _TINYDIR_FILENAME_MAX);
+    Widget_InitList(&explorer->Files, &explorer->Window, (WidgetPlacement){1, 5, -1, -2}, explorer->Dir.n_files, FileExplorer_GetItem, explorer, 4, WIDGET_LIST_PAGED | WIDGET_LIST_SPACED);
+    Widget_InitLabel(&explorer->Pages, &explorer->Window, (WidgetPlacement){1, -2, -1, -1}, "", WIDGET_ROLE_TITLE, 1);
+    explorer->Files.List.Selected = (explorer->Dir.n_files > 0) ? 0 : -1;
+    TextWidthCache_Init(&explorer->Widths);
+    Widget_CacheWidths(&explorer->Files, &explorer->Widths);
+
+    WidgetDialog dialog;
+    WidgetDialog_Init(&dialog, &explorer->Window, &stylePalette[styleSelector], FileExplorer_Layout, explorer, RENDER_STATS_FILE_EXPLORER);
+    dialog.Focus = &explorer->Files;
+    dialog.Cursor = &explorer->File;
+    dialog.OnKey = FileExplorer_OnKey;
+    dialog.OnWatch = FileExplorer_OnWatch;
+    dialog.BeforeRender = FileExplorer_BeforeRender;
+
+    DirWatch_Open(&explorer->Watch, explorer->FolderPath); // files created and deleted while the dialog is open show up without reading the directory again
+    FrameScheduler_Watch(&dialog.Scheduler, DirWatch_GetDescriptor(&explorer->Watch));
+
+    char kb = WidgetDialog_Run(&dialog);
+
+    DirWatch_Close(&explorer->Watch);
+    tinydir_close(&explorer->Dir);
+    TextWidthCache_Destroy(&explorer->Widths);
+    Arena_Release(scratch, mark);
+
+    return (kb == KEY_ESC || kb == 0) ? 0 : 1; // if we close because of ESC key, then return 0 (failure)
+}
+
+static void TextViewer_Layout(WidgetArea *area)
+{
+    uint8_t termW, termH;
+    TerminalSize_Get(&termW, &termH);
+
+    area->W = max(termW - 2, 20); // room for the shadow
+    area->H = max(termH - 2, 6);
+    area->X = 0;
+    area->Y = 0;
+}
+
+static void TextViewer_DrawChrome(BoxCanvas *canvas, uint8_t split)
+{
+    BoxCanvas_Box(canvas, 0, 0,                  canvas->Width, canvas->Height, BOX_STYLE_STRONG | BOX_STYLE_SHADOW);   // window
+    BoxCanvas_Box(canvas, 0, canvas->Height - 3, canvas->Width, 3,              BOX_STYLE_WEAK   | BOX_STYLE_NOSHADOW); // status bar
+    (void)split;
+}
+
+static void TextViewer_PrintLine(const LineIndex *index, uint64_t start, uint64_t column, uint8_t width, uint64_t matchOffset, size_t matchLength, const WidgetStyle* style)
+{
+    char buffer[4 * UINT8_MAX + 16]; // up to 3 bytes a column (the replacement character), with room for some combining marks
+    size_t length = 0;
+    size_t matchFirst = SIZE_MAX, matchLast = SIZE_MAX; // the bytes of the buffer that are highlighted, if any
+    uint8_t used = 0; // columns filled
+
+    if (start < index->Size)
     {
-        FORCE_REDRAW:
+        uint64_t end = LineIndex_NextLine(index, start);
+        while (end > start && (index->Data[end - 1] == '\n' || index->Data[end - 1] == '\r'))
+            end--;
+
+        const char *text = index->Data + start;
+        size_t lineLength = end - start;
+
+        size_t skipped;
+        size_t offset = TextWidth_Truncate(text, lineLength, column, &skipped); // the columns scrolled off to the left
+
+        if (skipped < column && offset < lineLength) // a wide character cut by the left edge: its visible half is blank
+        {
+            uint8_t columns;
+            offset += TextWidth_Next(text + offset, lineLength - offset, &columns);
+
+            for (; skipped + columns > column + used && used < width; used++)
+                buffer[length++] = ' ';
+        }
 
-        // clear old files from the file view
-        if (clearBack) // we don't do it every cycle because it's time consuming and makes the screen flicker .. it must be requested when, for instance, a new directory is browsed or when the page number changes (whenever the number of items in screen may change)
+        uint64_t matchStart = 0, matchEnd = 0; // in the line
+        if (matchOffset != LINE_INDEX_NOT_FOUND && matchOffset + matchLength > start && matchOffset < end)
         {
-            Terminal_SetStyle(style->BoxText, style->BoxBack);
-            Terminal_ClearArea(diagX+1, diagY+5, diagW-2, numRows+1); // clear all rows + the page counter
-            clearBack = 0;
+            matchStart = (matchOffset > start) ? matchOffset - start : 0;
+            matchEnd = matchOffset + matchLength - start;
         }
 
-        // draw the folder path
-        Terminal_SetStyle(style->TitleText, style->TitleBack);
-        Terminal_SetCursorPosition(diagX+1,diagY+1);
-        printf("Directory: ");
-        Terminal_SetStyle(style->ContentText, style->ContentBack);
-        PrintWidth(diagW-14,0,folderpath);
+        while (offset < lineLength)
+        {
+            uint8_t columns;
+            size_t size = TextWidth_Next(text + offset, lineLength - offset, &columns);
+
+            if (used + columns > width || length + max(size, 3) + (width - used) > sizeof(buffer)) // the padding must still fit
+                break;
+
+            if (matchFirst == SIZE_MAX && offset >= matchStart && offset < matchEnd)
+                matchFirst = length;
+            else if (matchFirst != SIZE_MAX && matchLast == SIZE_MAX && offset >= matchEnd)
+                matchLast = length;
+
+            unsigned char c = (unsigned char)text[offset];
+            if (size == 1 && c >= 0x80) // not valid UTF-8
+            {
+                memcpy(&buffer[length], "\xEF\xBF\xBD", 3);
+                length += 3;
+            }
+            else if (size == 1 && (c < ' ' || c == 127))
+                buffer[length++] = ' '; // tabs and control characters would move the cursor
+            else
+            {
+                memcpy(&buffer[length], &text[offset], size);
+                length += size;
+            }
+
+            used += columns;
+            offset += size;
+        }
+
+        if (matchFirst != SIZE_MAX && matchLast == SIZE_MAX)
+            matchLast = length;
+    }
+
+    for (; used < width; used++)
+        buffer[length++] = ' ';
+
+    Terminal_SetStyle(style->ContentText, style->ContentBack);
+    fwrite(buffer, 1, min(matchFirst, length), stdout);
 
-        // draw filename
-        Terminal_SetStyle(style->TitleText, style->TitleBack);
-        Terminal_SetCursorPosition(diagX+1,diagY+3);
-        printf("File name: ");
+    if (matchFirst != SIZE_MAX)
+    {
+        Terminal_SetStyle(style->OptionsText_Active, style->OptionsBack_Active);
+        fwrite(&buffer[matchFirst], 1, matchLast - matchFirst, stdout);
         Terminal_SetStyle(style->ContentText, style->ContentBack);
-        PrintWidth(diagW-14,0,filename);
+        fwrite(&buffer[matchLast], 1, length - matchLast, stdout);
+    }
+}
+
+uint8_t ShowTextViewer(const char *title, const char *path, DialogBoxStyle styleSelector)
+{
+    LineIndex index; // the file is mapped, not read: only the lines on the screen are ever touched here
+    if (!LineIndex_Open(&index, path))
+        return 0;
+
+    if (Session_Lock() != 0)
+    {
+        LineIndex_Close(&index);
+        return 0;
+    }
+
+    char previousMode = SetMode(1); // once for the whole dialog (see WidgetDialog_Run)
+    SyncUpdate_Detect();
+    Terminal_SaveCursorPosition();
+    RenderStatsScope previousScope = RenderStats_SetScope(RENDER_STATS_TEXT_VIEWER);
+
+    WidgetArea area, shownArea;
+    TextViewer_Layout(&area);
 
-        uint8_t numPages = (dir.n_files / (numRows * numCols)); // count how many pages are required to display all items in this directory
-        if (dir.n_files % (numRows * numCols) != 0)
-            numPages++;
+    const WidgetStyle* style = &stylePalette[styleSelector];
 
-        if (numPages > 1) // if more than 1, then show a status bar indicating that...
+    uint8_t drawChrome = 1; // the form and title are only drawn on the first frame and after a resize
+    uint8_t drawContent = 1; // the lines are only drawn again when the view moves ... the status bar is drawn every frame
+    uint8_t shown = 0;
+
+    uint64_t topLine = 0;   // first line on the screen ...
+    uint64_t topOffset = 0; // ... and where it starts in the file
+    uint64_t column = 0;    // first character shown of each line
+
+    char prompt = 0;        // 'g' while a line number is typed, '/' while a search is typed
+    char input[64] = "";
+    char search[64] = "";
+    char message[100] = "";
+    uint64_t matchOffset = LINE_INDEX_NOT_FOUND;
+
+    FrameScheduler scheduler;
+    FrameScheduler_Create(&scheduler, 0);
+    FrameScheduler_Watch(&scheduler, LineIndex_GetDescriptor(&index)); // the line count in the status bar follows the indexing
+
+    char kb;
+    for (;;) // keep in this loop reading keyboard
+    {
+        FrameEvent event = FrameScheduler_Wait(&scheduler);
+
+        if (event == FRAME_EVENT_WATCH)
         {
-            char pageDescriptor[100];
-            sprintf(pageDescriptor, "Page %u/%d", currentPage+1, numPages);
+            uint8_t complete;
+            LineIndex_Drain(&index);
+            LineIndex_Lines(&index, &complete);
 
-            Terminal_SetCursorPosition(diagX+1, diagY+diagH-2);
-            Terminal_SetStyle(style->TitleText, style->TitleBack);
-            PrintWidth(diagW-2,1,pageDescriptor); // centered
+            if (complete)
+                FrameScheduler_Watch(&scheduler, -1); // nothing more to follow
+
+            FrameScheduler_Invalidate(&scheduler);
+            continue;
+        }
+
+        if (event == FRAME_EVENT_RESIZE)
+        {
+            TextViewer_Layout(&area);
+
+            if (!shown || memcmp(&area, &shownArea, sizeof(area)) != 0)
+            {
+                drawChrome = 1;
+                FrameScheduler_Invalidate(&scheduler);
+            }
+            continue;
         }
 
-        // draw browser
-        for (size_t index = 0; index < dir.n_files; index++)
+        uint16_t diagW = area.W;
+        uint16_t diagH = area.H;
+        uint16_t diagX = area.X;
+        uint16_t diagY = area.Y;
+
+        uint8_t numRows = diagH - 4; // top border / lines / status bar
+        uint8_t widRows = diagW - 2;
+
+        if (event == FRAME_EVENT_PRESENT)
         {
-            uint8_t rowTotal = index / numCols;
-            uint8_t col = index % numCols;
-            uint8_t page = rowTotal / numRows;
-            uint8_t row = rowTotal % numRows;
-            uint8_t newPage = (SelectionIndex>=0) ? (SelectionIndex / numCols) / numRows : currentPage; // if nothing selected .. dont change the page
+            FrameScheduler_BeginFrame(&scheduler);
 
-            if (newPage != currentPage) // see if we switched pages ...
+            if (drawChrome)
             {
-                clearBack = 1; // if page changed we must clear the back, because if we didn't and the number of files in the new page is smaller than the in last, thoses files would remain "ghost-printed"
-                currentPage = newPage;
-                goto FORCE_REDRAW; // .. because if we did, we must "clear back" to prevent ghost-items showing up from the previous page
+                if (shown)
+                    Widget_ClearUncoveredArea(&shownArea, &area);
+
+                // draw the form
+                ChromeCache_Render(diagX, diagY, diagW, diagH, style->BoxText, style->BoxBack, TextViewer_DrawChrome, 0);
+
+                // draw the title
+                Terminal_SetCursorPosition(diagX+diagW/4,diagY);
+                Terminal_SetStyle(style->TitleText, style->TitleBack);
+                PrintWidth(diagW/2,1,title);
+
+                shownArea = area;
+                shown = 1;
+                drawChrome = 0;
+                drawContent = 1;
             }
 
-            if (page != currentPage)
-                continue; // only display items in the current page
+            if (drawContent) // only the lines on the screen are looked for, starting from the first one
+            {
+                uint64_t offset = topOffset;
 
-            Terminal_SetCursorPosition(diagX+1 + col*widCols, diagY+5+row);
+                for (uint8_t row = 0; row < numRows; row++)
+                {
+                    Terminal_SetCursorPosition(diagX+1, diagY+1+row);
+                    TextViewer_PrintLine(&index, offset, column, widRows, matchOffset, strlen(search), style);
+                    offset = LineIndex_NextLine(&index, offset);
+                }
 
-            if (tinydir_readfile_n(&dir, &file, index) == -1)
-                printf("Tinydir error");
+                drawContent = 0;
+            }
 
-            if (index == SelectionIndex)
-                Terminal_SetStyle(style->OptionsText_Active, style->OptionsBack_Active);
+            // draw the status bar
+            char status[UINT8_MAX];
+            uint8_t complete;
+            uint64_t numLines = LineIndex_Lines(&index, &complete);
+
+            if (prompt)
+                snprintf(status, sizeof(status), "%s%s", (prompt == 'g') ? "Go to line: " : "Search: ", input);
+            else if (message[0] != '\0')
+                snprintf(status, sizeof(status), "%s", message);
+            else if (complete)
+                snprintf(status, sizeof(status), "Line %llu of %llu   [g] go to line  [/] search  [n] next  [q] close", (unsigned long long)topLine + 1, (unsigned long long)max(numLines, 1));
             else
-                Terminal_SetStyle(style->OptionsText_Normal, style->OptionsBack_Normal);
+                snprintf(status, sizeof(status), "Line %llu of %llu+ (indexing %u%%)   [g] go to line  [/] search  [n] next  [q] close", (unsigned long long)topLine + 1, (unsigned long long)numLines,
+                    (unsigned)(atomic_load(&index.IndexedBytes) * 100 / index.Size));
 
-            char displayName[_TINYDIR_PATH_MAX];
+            Terminal_SetCursorPosition(diagX+1, diagY+diagH-2);
+            Terminal_SetStyle(style->TitleText, style->TitleBack);
+            PrintWidth(widRows, 0, status);
 
-            if (file.is_dir)
-                sprintf(displayName, "[%s]", file.name);
-            else
-                sprintf(displayName, "%s", file.name);
+            // put the cursor where the typing goes
+            Terminal_SetCursorPosition(min(diagX+1+TextWidth_String(status), diagX+diagW-2), diagY+diagH-2);
 
-            PrintWidth(widCols-2, 0, displayName);
+            FrameScheduler_EndFrame(&scheduler);
+            continue;
         }
 
-        // put the cursor in the "filename" field
-        Terminal_SetCursorPosition(min(diagX+12+strlen(filename), diagX+diagW-2), diagY+3); // make sure the cursor does not end up outside the dialog in case the filename is really long
-
         // run keyboard interactivity
-        REGET:
         kb = getchNavigation();
+        message[0] = '\0';
+
+        if (prompt) // typing a line number or a search
+        {
+            size_t length = strlen(input);
+
+            if (kb == KEY_ESC)
+                prompt = 0;
+            else if (kb == KEY_BACKSPACE)
+            {
+                if (length > 0)
+                    input[length - 1] = '\0';
+            }
+            else if (kb == KEY_ENTER || kb == KEY_RETURN)
+            {
+                if (prompt == '/')
+                {
+                    strcpy(search, input);
+                    matchOffset = LINE_INDEX_NOT_FOUND; // start from the top of the screen
+                    kb = 'n';
+                }
+                else if (length > 0)
+                {
+                    uint8_t complete;
+                    uint64_t numLines = LineIndex_Lines(&index, &complete);
+                    uint64_t line = strtoull(input, NULL, 10);
+
+                    line = (line > 0) ? line - 1 : 0;
+
+                    if (line >= numLines && numLines > 0)
+                    {
+                        if (!complete)
+                            snprintf(message, sizeof(message), "Only %llu lines are indexed so far", (unsigned long long)numLines);
+
+                        line = numLines - 1; // past the end is taken as the last line
+                    }
+
+                    uint64_t offset = LineIndex_Seek(&index, line);
+                    if (offset != LINE_INDEX_NOT_FOUND)
+                    {
+                        topLine = line;
+                        topOffset = offset;
+                        drawContent = 1;
+                    }
+                }
+
+                prompt = 0;
+            }
+            else if (isprint((unsigned char)kb) && (prompt == '/' || isdigit((unsigned char)kb)) && length < sizeof(input) - 1)
+            {
+                input[length] = kb;
+                input[length + 1] = '\0';
+            }
+            else continue; // this character serves no purpose
+
+            if (kb != 'n' || prompt)
+            {
+                FrameScheduler_Invalidate(&scheduler);
+                continue;
+            }
+        }
 
-        int16_t newSel = SelectionIndex; // holds the candidate for new selected item
         switch (kb)
         {
             case KEY_ARROW_UP:
-                newSel -= numCols;
+            case KEY_PAGE_UP:
+                for (uint8_t step = (kb == KEY_PAGE_UP) ? numRows - 1 : 1; step > 0 && topLine > 0; step--)
+                {
+                    topOffset = LineIndex_PreviousLine(&index, topOffset);
+                    topLine--;
+                }
                 break;
 
             case KEY_ARROW_DOWN:
-                newSel += numCols;
-                //if (newSel > dir.n_files && currentPage == numPages - 1) // if last page, possibly not enough files to switch page using arrow, so this case is needed to make sure last page is accessible
-                //    newSel = dir.n_files -1;
+            case KEY_PAGE_DOWN:
+                for (uint8_t step = (kb == KEY_PAGE_DOWN) ? numRows - 1 : 1; step > 0; step--)
+                {
+                    uint64_t next = LineIndex_NextLine(&index, topOffset);
+                    if (next >= index.Size)
+                        break; // the last line stays on the screen
+
+                    topOffset = next;
+                    topLine++;
+                }
+                break;
+
+            case KEY_ARROW_LEFT:
+                column = (column > 8) ? column - 8 : 0;
                 break;
-            case KEY_ARROW_LEFT: newSel--; break;
-            case KEY_ARROW_RIGHT: newSel++; break;
 
-            case KEY_BACKSPACE: // backspace
-                if (strlen(filename)>0)
-                    if (sprintf(filename, "%.*s", (int)strlen(filename) - 1, filename)) // must cast strlen from size_t to avoid warning -Wformat
-                        newSel = -1;
+            case KEY_ARROW_RIGHT:
+                column += 8;
                 break;
 
-            case KEY_ESC: // esc key
-                    goto CLOSE;
+            case 'g':
+            case '/':
+                prompt = kb;
+                input[0] = '\0';
                 break;
 
-            case KEY_ENTER:
-            case KEY_RETURN: // enter key to navigate or accept file
-                //if (fileMustExist)
-                //{
-                //
-                //}
-                if (SelectionIndex>=0) // something is selected
+            case 'n': // the next match after the last one ... or the first one from the top of the screen
+            {
+                if (search[0] == '\0')
+                    break;
+
+                uint64_t from = (matchOffset == LINE_INDEX_NOT_FOUND) ? topOffset : matchOffset + 1;
+                uint64_t found = LineIndex_Search(&index, from, search);
+
+                if (found == LINE_INDEX_NOT_FOUND)
                 {
-                    if (tinydir_readfile_n(&dir, &file, SelectionIndex) != -1) // read success
-                    {
-                        if (file.is_dir) // browse new directory
-                        {
-                            if (tinydir_open_subdir_n(&dir, SelectionIndex) != -1) // open success
-                            {
-                                strcpy(folderpath, dir.path); // update folderpath
-                                strcpy(filename, ""); // clear filename
-                                SelectionIndex = -1; // de-select item on new folder
-                                newSel = SelectionIndex;
-                                clearBack = 1;
-                            }
-                            else
-                            {
-                                // failed to open ... may cause error - discard current session and reopen
-                                tinydir_close(&dir);
-                                tinydir_open_sorted(&dir, folderpath);
-                            }
-                        }
-                        else // try accept the selected file
-                        {
-                            if (strcmp(file.extension, filterextension) == 0) // accept the file if the extension matches
-                            {
-                                strcpy(out_filename, file.path);
-                                goto CLOSE;
-                            }
-                        }
-                    }
+                    snprintf(message, sizeof(message), "Not found: %s", search);
+                    break;
                 }
-                else // nothing is selected ...
-                {
-                    if (!fileMustExist) // ... but it does not have to be
-                    {
-                        char *ptrDot;
-                        char *ext = &filename[0]; // we begin with the full file name
 
-                        while ((ptrDot = strstr(ext, ".")) > 0) // while there is dot in the name...
-                            ext = ptrDot+1; // we move past it ... until there is no more dots
+                if (found < from)
+                    snprintf(message, sizeof(message), "Search wrapped around to the top");
 
-                        if (strcmp(filterextension, ext) == 0 || strlen(filterextension) == 0)
-                        {
-                            sprintf(out_filename, "%s/%s", dir.path, filename);
-                            goto CLOSE;
-                        }
+                matchOffset = found;
+                topOffset = LineIndex_LineStart(&index, found);
+                topLine = LineIndex_LineOf(&index, found);
 
-                    }
-                }
+                uint64_t matchColumn = TextWidth_Measure(index.Data + topOffset, found - topOffset); // scroll sideways if the match is off the screen
+                if (matchColumn < column || matchColumn + TextWidth_String(search) > column + widRows)
+                    column = (matchColumn > widRows / 2) ? (matchColumn - widRows / 2) / 8 * 8 : 0;
+                break;
+            }
 
+            case 'q':
+            case KEY_ESC:
+                goto CLOSE;
                 break;
 
             default:
-                if (isalnum(kb) || kb == '.' || kb == '_' || kb == ' ')
-                {
-                    if (sprintf(filename, "%.*s%c", (int)min(strlen(filename), _TINYDIR_FILENAME_MAX-1),filename, kb)) // GCC WARNING -Wformat-overflow: filename + c may be bigger than sizeof(filename)
-                        newSel = -1;               // ^ must cast from size_t to int to avoid -Wformat warning
-                }
-                else goto REGET; // this character serves no purpose
-            break;
+                continue; // this character serves no purpose
         }
 
-        if (newSel == -1) // user typed a filename
+        drawContent = 1;
+        FrameScheduler_Invalidate(&scheduler);
+    }
+
+    CLOSE:
+    RenderStats_SetScope(previousScope);
+    Terminal_RestoreCursorSavedPosition();
+    SetMode(previousMode);
+    Session_Unlock();
+    LineIndex_Close(&index);
+
+    return 1;
+}
+
+static void ProgressDialog_Layout(WidgetArea *area)
+{
+    uint8_t termW, termH;
+    TerminalSize_Get(&termW, &termH);
+
+    area->H = 5; // top border (title) / label / bar / counts / bottom border
+    area->W = min(max(termW/2, 24), termW - 1);
+
+    // center on terminal
+    area->X = (termW - area->W)/2;
+    area->Y = (termH - area->H)/2;
+}
+
+static void ProgressDialog_PrintCells(uint8_t count, uint8_t filled, uint8_t useUTF8)
+{
+    const char *cell = filled ? (useUTF8 ? "\xE2\x96\x88" : "#") : (useUTF8 ? "\xE2\x96\x91" : "-"); // full block / light shade
+    char buffer[UINT8_MAX * 3];
+    size_t cellLength = strlen(cell);
+
+    for (uint8_t index = 0; index < count; index++)
+        memcpy(&buffer[index * cellLength], cell, cellLength);
+
+    fwrite(buffer, cellLength, count, stdout);
+}
+
+static void ProgressDialog_ReadLabel(ProgressDialog *dialog, char *label)
+{
+    unsigned sequence;
+
+    do // seqlock: copy, and copy again if a writer came in meanwhile
+    {
+        while ((sequence = atomic_load_explicit(&dialog->LabelSequence, memory_order_acquire)) % 2 != 0)
+            (void)0;
+
+        memcpy(label, dialog->Label, PROGRESS_DIALOG_LABEL_MAX);
+        atomic_thread_fence(memory_order_acquire);
+    }
+    while (atomic_load_explicit(&dialog->LabelSequence, memory_order_relaxed) != sequence);
+
+    label[PROGRESS_DIALOG_LABEL_MAX - 1] = '\0';
+}
+
+static void* ProgressDialog_Main(void *argument)
+{
+    ProgressDialog *dialog = (ProgressDialog*)argument;
+    Session_Bind(dialog->Session); // draws where it was opened
+    RenderStats_SetScope(RENDER_STATS_PROGRESS_DIALOG);
+
+    #if (defined(unix) || defined(__unix__) || defined(__unix))
+        uint8_t useUTF8 = 1;
+    #elif (defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN32__))
+        uint8_t useUTF8 = (GetConsoleOutputCP() == CP_UTF8);
+    #endif
+
+    const WidgetStyle* style = &stylePalette[dialog->Style];
+
+    WidgetArea area, shownArea;
+    uint8_t shown = 0;
+    uint8_t shownCells = 0;
+    char shownLabel[PROGRESS_DIALOG_LABEL_MAX] = "";
+    char shownCounts[64] = "";
+
+    FrameScheduler scheduler; // only paces and wraps the frames: the dialog reads no keys
+    FrameScheduler_Create(&scheduler, PROGRESS_DIALOG_RATE);
+
+    for (;;)
+    {
+        uint8_t stopping = !atomic_load(&dialog->Running);
+
+        uint8_t drawChrome = !shown;
+        if (TerminalSize_Changed() || !shown)
         {
-            SelectionIndex = -1; // deselect current file
+            ProgressDialog_Layout(&area);
+            drawChrome = !shown || memcmp(&area, &shownArea, sizeof(area)) != 0;
+        }
 
-            for (size_t index = 0; index < dir.n_files; index++)
-                if (tinydir_readfile_n(&dir, &file, index) != -1)
-                    if (strcmp(file.name, filename) == 0 && strlen(file.name)>0)
-                    {
-                        SelectionIndex = index; // select the file with the right name if there is any ...
-                        break;
-                    }
+        // sample what the workers left
+        uint64_t done = atomic_load_explicit(&dialog->Done, memory_order_relaxed);
+        uint64_t total = dialog->Total;
+        char label[PROGRESS_DIALOG_LABEL_MAX];
+        char counts[64];
+
+        ProgressDialog_ReadLabel(dialog, label);
+
+        if (total > 0)
+        {
+            done = min(done, total);
+            snprintf(counts, sizeof(counts), "%u%%  (%llu of %llu)", (unsigned)(done * 100 / total), (unsigned long long)done, (unsigned long long)total);
         }
+        else
+            snprintf(counts, sizeof(counts), "%llu", (unsigned long long)done); // no end known: just count
+
+        uint8_t barLength = area.W - 4;
+        uint8_t cells = (total > 0) ? (uint8_t)(done * barLength / total) : 0;
 
-        if (newSel >=0 && newSel < dir.n_files && newSel != SelectionIndex)
+        if (drawChrome || cells != shownCells || strcmp(label, shownLabel) != 0 || strcmp(counts, shownCounts) != 0) // most samples change nothing on the screen
         {
-            SelectionIndex = newSel;
+            Session_Lock();
+            FrameScheduler_BeginFrame(&scheduler);
+            Terminal_SaveCursorPosition();
+
+            if (drawChrome)
+            {
+                if (shown)
+                    Widget_ClearUncoveredArea(&shownArea, &area);
+
+                // draw the form
+                ChromeCache_Render(area.X, area.Y, area.W, area.H, style->BoxText, style->BoxBack, SliderBox_DrawChrome, 0);
 
-            tinydir_readfile_n(&dir, &file, SelectionIndex);
-            strcpy(filename, file.name);
+                // print title
+                Terminal_SetCursorPosition(area.X+1,area.Y);
+                Terminal_SetStyle(style->TitleText, style->TitleBack);
+                PrintWidth(area.W-2,1,dialog->Title);
+
+                // empty bar
+                Terminal_SetCursorPosition(area.X+2,area.Y+2);
+                Terminal_SetStyle(style->OptionsText_Normal, style->OptionsBack_Normal);
+                ProgressDialog_PrintCells(barLength, 0, useUTF8);
+
+                shownArea = area;
+                shown = 1;
+                shownCells = 0;
+                shownLabel[0] = '\1'; // differs from any label
+                shownCounts[0] = '\0';
+            }
+
+            if (strcmp(label, shownLabel) != 0)
+            {
+                Terminal_SetCursorPosition(area.X+1,area.Y+1);
+                Terminal_SetStyle(style->ContentText, style->ContentBack);
+                PrintWidth(area.W-2,1,label);
+                strcpy(shownLabel, label);
+            }
+
+            if (cells != shownCells) // only the cells between the old and the new end of the bar
+            {
+                Terminal_SetCursorPosition(area.X+2 + min(cells, shownCells),area.Y+2);
+                Terminal_SetStyle(style->OptionsText_Normal, style->OptionsBack_Normal);
+                ProgressDialog_PrintCells(max(cells, shownCells) - min(cells, shownCells), cells > shownCells, useUTF8);
+                shownCells = cells;
+            }
+
+            if (strcmp(counts, shownCounts) != 0)
+            {
+                Terminal_SetCursorPosition(area.X+1,area.Y+3);
+                Terminal_SetStyle(style->ContentText, style->ContentBack);
+                PrintWidth(area.W-2,1,counts);
+                strcpy(shownCounts, counts);
+            }
+
+            Terminal_RestoreCursorSavedPosition();
+            FrameScheduler_EndFrame(&scheduler);
+            Session_Unlock();
         }
+
+        if (stopping)
+            break;
+
+        // there is no wake-up call (that would cost the workers a system call), so the value is looked at once per frame
+        Clock_SleepMicroseconds(scheduler.FrameInterval);
     }
 
-    CLOSE:
-    Terminal_RestoreCursorSavedPosition();
-    Terminal_Unlock();
-    tinydir_close(&dir);
+    return NULL;
+}
+
+uint8_t ProgressDialog_Open(ProgressDialog *dialog, const char *title, uint64_t total, DialogBoxStyle styleSelector)
+{
+    atomic_store(&dialog->Done, 0);
+    dialog->Total = total;
+    dialog->Label[0] = '\0';
+    atomic_store(&dialog->LabelSequence, 0);
+    atomic_flag_clear(&dialog->LabelWriter);
+
+    dialog->Title = title;
+    dialog->Style = styleSelector;
+    dialog->Session = Session_Current();
+    SyncUpdate_Detect(); // here, as the thread of the dialog must not read the keys
+
+    atomic_store(&dialog->Running, 1);
+    if (pthread_create(&dialog->Thread, NULL, ProgressDialog_Main, dialog) != 0)
+    {
+        atomic_store(&dialog->Running, 0);
+        return 0;
+    }
+
+    return 1;
+}
+
+void ProgressDialog_Update(ProgressDialog *dialog, uint64_t done)
+{
+    atomic_store_explicit(&dialog->Done, done, memory_order_relaxed); // nothing else is ordered by it
+}
+
+void ProgressDialog_Add(ProgressDialog *dialog, uint64_t amount)
+{
+    atomic_fetch_add_explicit(&dialog->Done, amount, memory_order_relaxed);
+}
+
+void ProgressDialog_SetLabel(ProgressDialog *dialog, const char *label)
+{
+    while (atomic_flag_test_and_set_explicit(&dialog->LabelWriter, memory_order_acquire))
+        (void)0; // another worker is copying its label
+
+    unsigned sequence = atomic_load_explicit(&dialog->LabelSequence, memory_order_relaxed);
+    atomic_store_explicit(&dialog->LabelSequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    strncpy(dialog->Label, label, PROGRESS_DIALOG_LABEL_MAX - 1);
+    dialog->Label[PROGRESS_DIALOG_LABEL_MAX - 1] = '\0';
+
+    atomic_store_explicit(&dialog->LabelSequence, sequence + 2, memory_order_release);
+    atomic_flag_clear_explicit(&dialog->LabelWriter, memory_order_release);
+}
+
+void ProgressDialog_Close(ProgressDialog *dialog)
+{
+    if (!atomic_exchange(&dialog->Running, 0))
+        return;
+
+    pthread_join(dialog->Thread, NULL);
+}
+
+static int ListBox_CompareText(const char *a, const char *b, size_t length) // case-insensitive, up to length characters
+{
+    for (size_t index = 0; index < length; index++)
+    {
+        int difference = tolower((unsigned char)a[index]) - tolower((unsigned char)b[index]);
+
+        if (difference != 0 || a[index] == '\0')
+            return difference;
+    }
+
+    return 0;
+}
+
+struct listBoxItems // where the options come from
+{
+    ListBoxGetItem GetItem;
+    void *Context;
+};
+
+static _Thread_local const struct listBoxItems *sortedItems; // qsort has no argument for it
+
+static int ListBox_CompareIndex(const void *a, const void *b)
+{
+    uint32_t indexA = *(const uint32_t*)a, indexB = *(const uint32_t*)b;
+    int order = ListBox_CompareText(sortedItems->GetItem(sortedItems->Context, indexA), sortedItems->GetItem(sortedItems->Context, indexB), SIZE_MAX);
+
+    if (order == 0) // equal texts keep the order of the list, so the first one is found first
+        order = (indexA > indexB) - (indexA < indexB);
+
+    return order;
+}
+
+static uint32_t* ListBox_SortItems(const struct listBoxItems *items, uint32_t numItems) // the options in alphabetical order, for the type-ahead
+{
+    uint32_t *sorted = (uint32_t*)malloc(sizeof(uint32_t) * (size_t)numItems);
+    if (sorted == NULL)
+        return NULL;
+
+    for (uint32_t index = 0; index < numItems; index++)
+        sorted[index] = index;
+
+    sortedItems = items;
+    qsort(sorted, numItems, sizeof(uint32_t), ListBox_CompareIndex);
+    sortedItems = NULL;
+
+    return sorted;
+}
+
+static int64_t ListBox_FindPrefix(const struct listBoxItems *items, const uint32_t *sorted, uint32_t numItems, const char *prefix) // the option that comes first among those starting with the prefix, or -1
+{
+    size_t length = strlen(prefix);
+    uint32_t first = 0, last = numItems;
+
+    while (first < last) // the first one that is not before the prefix
+    {
+        uint32_t middle = first + (last - first) / 2;
+
+        if (ListBox_CompareText(items->GetItem(items->Context, sorted[middle]), prefix, length) < 0)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    if (first == numItems || ListBox_CompareText(items->GetItem(items->Context, sorted[first]), prefix, length) != 0)
+        return -1;
+
+    return sorted[first];
+}
+
+const char* ListBox_ArrayItem(void *context, uint32_t index)
+{
+    return ((const char* const*)context)[index];
+}
+
+struct listBox
+{
+    struct listBoxItems Items;
+    uint32_t NumItems;
+    uint32_t *Sorted;       // built on the first typed character, so opening a long list costs nothing
+    char Prefix[64];        // what was typed
+    uint64_t LastTyped;
+
+    Widget Window;
+    Widget Status;          // the position, or what is being typed
+    Widget List;
+};
+
+static void ListBox_Layout(WidgetArea *area, void *context)
+{
+    const struct listBox *box = (const struct listBox*)context;
+
+    uint8_t termW, termH;
+    TerminalSize_Get(&termW, &termH);
+
+    area->H = (uint8_t)min(box->NumItems, (uint32_t)max(3*termH/4 - 4, 1)) + 4; // top border (title) / position and search / divider / the visible options / bottom border
+    area->W = min(max(termW/2, 24), termW - 1);
+
+    // center on terminal
+    area->X = (termW - area->W)/2;
+    area->Y = (termH - area->H)/2;
+}
+
+static void ListBox_BeforeRender(WidgetDialog *dialog)
+{
+    struct listBox *box = (struct listBox*)dialog->Context;
+    char status[100];
+
+    if (box->Prefix[0] != '\0')
+        snprintf(status, sizeof(status), "Find: %s", box->Prefix);
+    else
+        snprintf(status, sizeof(status), "%lu of %lu", (unsigned long)box->List.List.Selected + 1, (unsigned long)box->NumItems);
+
+    Widget_SetText(&box->Status, status);
+}
+
+static WidgetAction ListBox_OnKey(WidgetDialog *dialog, char kb, uint8_t used)
+{
+    struct listBox *box = (struct listBox*)dialog->Context;
+
+    if (kb == KEY_ENTER || kb == KEY_RETURN || kb == KEY_ESC)
+        return WIDGET_CLOSE;
+
+    if (used) // moving around ends the search
+    {
+        box->Prefix[0] = '\0';
+        return WIDGET_CONTINUE;
+    }
+
+    uint64_t now = Clock_GetMicroseconds();
+
+    if (kb == KEY_BACKSPACE)
+    {
+        if (box->Prefix[0] == '\0')
+            return WIDGET_CONTINUE;
+
+        box->Prefix[strlen(box->Prefix) - 1] = '\0';
+    }
+    else if (isprint((unsigned char)kb))
+    {
+        if (now - box->LastTyped > LIST_BOX_TYPE_AHEAD_TIMEOUT) // a pause starts a new search
+            box->Prefix[0] = '\0';
+
+        size_t length = strlen(box->Prefix);
+        if (length < sizeof(box->Prefix) - 1)
+        {
+            box->Prefix[length] = kb;
+            box->Prefix[length + 1] = '\0';
+        }
+
+        box->LastTyped = now;
+    }
+    else
+        return WIDGET_CONTINUE; // this character serves no purpose
+
+    // jump to the first option with what was typed
+    if (box->Sorted == NULL)
+        box->Sorted = ListBox_SortItems(&box->Items, box->NumItems);
+
+    int64_t found = (box->Sorted != NULL && box->Prefix[0] != '\0') ? ListBox_FindPrefix(&box->Items, box->Sorted, box->NumItems, box->Prefix) : -1;
+    if (found >= 0)
+        Widget_Select(&box->List, found);
+
+    Widget_Invalidate(&box->Status);
+    return WIDGET_CONTINUE;
+}
+
+uint8_t ShowListBox(uint32_t *selection, const char *title, uint32_t numItems, ListBoxGetItem getItem, void *context, DialogBoxStyle styleSelector)
+{
+    if (numItems == 0)
+        return 0;
+
+    struct listBox box = { .Items = { .GetItem = getItem, .Context = context }, .NumItems = numItems };
+
+    Widget_InitPanel(&box.Window, NULL, (WidgetPlacement){0, 0, 0, 0}, MessageBox_DrawChrome, title, WIDGET_TITLE_FULL);
+    box.Window.Panel.Split = 2; // under the status
+    Widget_InitLabel(&box.Status, &box.Window, (WidgetPlacement){1, 1, -1, 2}, "", WIDGET_ROLE_CONTENT, 1);
+    Widget_InitList(&box.List, &box.Window, (WidgetPlacement){1, 3, -1, -1}, numItems, getItem, context, 1, WIDGET_LIST_CENTERED); // only the visible options are ever asked for
+    box.List.List.Selected = min(*selection, numItems - 1);
+
+    WidgetDialog dialog;
+    WidgetDialog_Init(&dialog, &box.Window, &stylePalette[styleSelector], ListBox_Layout, &box, RENDER_STATS_LIST_BOX);
+    dialog.Focus = &box.List;
+    dialog.OnKey = ListBox_OnKey;
+    dialog.BeforeRender = ListBox_BeforeRender;
+
+    char kb = WidgetDialog_Run(&dialog);
+    free(box.Sorted);
+
+    if (kb == KEY_ESC || kb == 0) // if we close because of ESC key, then return 0 (failure)
+        return 0;
 
-    return (kb == KEY_ESC) ? 0 : 1; // if we close because of ESC key, then return 0 (failure)
+    *selection = (uint32_t)box.List.List.Selected;
+    return 1;
 }
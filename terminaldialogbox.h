@@ -19,6 +19,8 @@
 #define _TERMINAL_DIALOG_BOX_H_
 
 #include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
 
 typedef enum {
     DIALOG_BOX_STYLE_GREY =  0,
@@ -26,8 +28,44 @@ typedef enum {
     DIALOG_BOX_STYLE_RED   = 2,
 } DialogBoxStyle;
 
+#define MESSAGE_BOX_MAX_OPTIONS     125 // options of a message box (the rest are not shown)
+#define MESSAGE_BOX_ESC             255 // what ShowChoiceBox returns when it's closed with ESC
+#define LIST_BOX_TYPE_AHEAD_TIMEOUT 1000000 // [us] a pause this long between typed characters starts a new search
+
+typedef const char* (*ListBoxGetItem)(void *context, uint32_t index); // the text of an option ... it must stay valid while the dialog is open
+
+#define PROGRESS_DIALOG_LABEL_MAX   64  // longest label (including the '\0')
+#define PROGRESS_DIALOG_RATE        20  // frames per second: the value is sampled this often, however often it's updated
+
+typedef struct _ProgressDialog // shown while a job runs: the workers only store numbers, a thread of the dialog draws them
+{
+    atomic_uint_fast64_t Done;  // written by the workers
+    uint64_t Total;
+
+    char Label[PROGRESS_DIALOG_LABEL_MAX];
+    atomic_uint LabelSequence;  // odd while the label is being written
+    atomic_flag LabelWriter;    // one writer at a time
+
+    const char *Title;
+    DialogBoxStyle Style;
+    struct _TerminalSession *Session; // of the thread that opened it
+    pthread_t Thread;
+    atomic_uchar Running;
+} ProgressDialog;
+
 uint8_t ShowMessageBox(const char *title, const char *text, uint8_t numOptions, char* options[], DialogBoxStyle styleSelector);
+uint8_t ShowChoiceBox(const char *title, const char *text, uint8_t numOptions, char* options[], DialogBoxStyle styleSelector); // same, but ESC closes it too (and then it returns MESSAGE_BOX_ESC)
 uint8_t ShowFileExplorer(char *out_filename, const char* filterextension, const char* title, uint8_t fileMustExist, DialogBoxStyle styleSelector);
 float ShowSliderBox(const char *title, const char *text, float minValue, float curValue, float maxValue, float increment, DialogBoxStyle styleSelector);
+uint8_t ShowRangeBox(const char *title, const char *text, float minValue, float *value, float maxValue, float increment, DialogBoxStyle styleSelector); // same, but ESC closes it too (and then it returns 0, and *value is left as it was)
+uint8_t ShowTextViewer(const char *title, const char *path, DialogBoxStyle styleSelector); // returns 0 if the file cannot be read
+uint8_t ShowListBox(uint32_t *selection, const char *title, uint32_t numItems, ListBoxGetItem getItem, void *context, DialogBoxStyle styleSelector); // *selection is the option selected at first ... returns 0 if closed with ESC
+const char* ListBox_ArrayItem(void *context, uint32_t index); // for options in an array of strings: pass the array as the context
+
+uint8_t ProgressDialog_Open(ProgressDialog *dialog, const char *title, uint64_t total, DialogBoxStyle styleSelector); // starts the thread that draws it (the title must stay valid until closed)
+void ProgressDialog_Update(ProgressDialog *dialog, uint64_t done); // lock-free and without system calls, from any thread and at any rate ...
+void ProgressDialog_Add(ProgressDialog *dialog, uint64_t amount); // ... as is this, for workers that share the job
+void ProgressDialog_SetLabel(ProgressDialog *dialog, const char *label);
+void ProgressDialog_Close(ProgressDialog *dialog); // draws the last value and stops the thread ... the dialog stays on the screen
 
 #endif // _TERMINAL_DIALOG_BOX_H_
@@ -0,0 +1,177 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+#include "terminalsize.h"
+#include "session.h"            // the terminal of each thread
+#include "../BrailleCanvas/BrailleCanvas/terminal.h" // -- get this file (and the matching .c file too) in the repo "BrailleCanvas" at: https://github.com/luizfeldmann/BrailleCanvas
+#include <pthread.h>
+
+static uint8_t cachedWidth = 0;
+static uint8_t cachedHeight = 0;
+static pthread_once_t initializeOnce = PTHREAD_ONCE_INIT; // the main thread, the render thread and a progress dialog may all ask first
+
+#if defined(unix) || defined(__unix__) || defined(__unix)
+
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+
+#define SESSION_DEFAULT_WIDTH   80  // for sessions that are not terminals (sockets)
+#define SESSION_DEFAULT_HEIGHT  24
+
+static uint8_t TerminalSize_QuerySession(TerminalSession *session) // a session is not our controlling terminal, so it sends no SIGWINCH: its size is polled ... returns 1 if it changed
+{
+    uint8_t oldWidth = session->Width, oldHeight = session->Height;
+    struct winsize size;
+
+    if (ioctl(session->OutputDescriptor, TIOCGWINSZ, &size) == 0 && size.ws_col > 0 && size.ws_row > 0)
+    {
+        session->Width = (size.ws_col > 255) ? 255 : size.ws_col;
+        session->Height = (size.ws_row > 255) ? 255 : size.ws_row;
+    }
+    else if (!session->SizeKnown)
+    {
+        session->Width = SESSION_DEFAULT_WIDTH;
+        session->Height = SESSION_DEFAULT_HEIGHT;
+    }
+
+    session->SizeKnown = 1;
+    return (session->Width != oldWidth || session->Height != oldHeight);
+}
+
+static int resizePipe[2] = {-1, -1};            // self-pipe: the signal handler writes, the event loop polls
+static volatile sig_atomic_t resizePending = 0; // lets TerminalSize_Changed skip the pipe when nothing happened
+static struct sigaction hostAction;             // the handler that was there before ours ... it still gets the signal
+
+static void TerminalSize_SignalHandler(int signal, siginfo_t *info, void *context)
+{
+    int savedErrno = errno; // must not disturb whatever the interrupted code was doing
+
+    resizePending = 1;
+    if (write(resizePipe[1], "", 1) < 0)
+        (void)0; // pipe full: a wake-up is already pending
+
+    errno = savedErrno;
+
+    if (hostAction.sa_flags & SA_SIGINFO)
+        hostAction.sa_sigaction(signal, info, context);
+    else if (hostAction.sa_handler != SIG_DFL && hostAction.sa_handler != SIG_IGN)
+        hostAction.sa_handler(signal);
+}
+
+static void TerminalSize_Initialize(void)
+{
+    Terminal_GetSize(&cachedWidth, &cachedHeight);
+
+    if (pipe(resizePipe) == -1)
+        return;
+
+    for (uint8_t end = 0; end < 2; end++)
+    {
+        fcntl(resizePipe[end], F_SETFL, fcntl(resizePipe[end], F_GETFL) | O_NONBLOCK);
+        fcntl(resizePipe[end], F_SETFD, FD_CLOEXEC);
+    }
+
+    struct sigaction action;
+    action.sa_sigaction = TerminalSize_SignalHandler;
+    action.sa_flags = SA_RESTART | SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGWINCH, &action, &hostAction);
+}
+
+uint8_t TerminalSize_Changed(void)
+{
+    TerminalSession *session = Session_Current();
+    if (!session->Stdio)
+    {
+        uint8_t known = session->SizeKnown;
+        return TerminalSize_QuerySession(session) && known; // the first query is not a change
+    }
+
+    pthread_once(&initializeOnce, TerminalSize_Initialize);
+
+    if (!resizePending)
+        return 0;
+
+    resizePending = 0;
+
+    char drain[64];
+    while (read(resizePipe[0], drain, sizeof(drain)) > 0)
+        (void)0; // several signals may collapse into a single refresh
+
+    uint8_t oldWidth = cachedWidth, oldHeight = cachedHeight;
+    Terminal_GetSize(&cachedWidth, &cachedHeight);
+
+    return (cachedWidth != oldWidth || cachedHeight != oldHeight);
+}
+
+int TerminalSize_GetDescriptor(void)
+{
+    if (!Session_Current()->Stdio)
+        return -1; // polled
+
+    pthread_once(&initializeOnce, TerminalSize_Initialize);
+
+    return resizePipe[0];
+}
+
+#else
+
+static void TerminalSize_Initialize(void)
+{
+    Terminal_GetSize(&cachedWidth, &cachedHeight);
+}
+
+uint8_t TerminalSize_Changed(void) // there's no resize notification, so the size is polled
+{
+    pthread_once(&initializeOnce, TerminalSize_Initialize);
+
+    uint8_t oldWidth = cachedWidth, oldHeight = cachedHeight;
+    Terminal_GetSize(&cachedWidth, &cachedHeight);
+
+    return (cachedWidth != oldWidth || cachedHeight != oldHeight);
+}
+
+int TerminalSize_GetDescriptor(void)
+{
+    return -1;
+}
+
+#endif
+
+void TerminalSize_Get(uint8_t *WidthColumns, uint8_t *HeightRows)
+{
+    #if defined(unix) || defined(__unix__) || defined(__unix)
+        TerminalSession *session = Session_Current();
+        if (!session->Stdio)
+        {
+            if (!session->SizeKnown)
+                TerminalSize_QuerySession(session);
+
+            *WidthColumns = session->Width;
+            *HeightRows = session->Height;
+            return;
+        }
+    #endif
+
+    pthread_once(&initializeOnce, TerminalSize_Initialize);
+
+    *WidthColumns = cachedWidth;
+    *HeightRows = cachedHeight;
+}
@@ -0,0 +1,29 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+#ifndef _TERMINAL_SIZE_H_
+#define _TERMINAL_SIZE_H_
+
+#include <stdint.h>
+
+// Cached terminal geometry: the size is only read again after the terminal reports a resize (SIGWINCH under UNIX)
+
+void TerminalSize_Get(uint8_t *WidthColumns, uint8_t *HeightRows);
+uint8_t TerminalSize_Changed(void);     // refreshes the cache if a resize was reported ... returns 1 if the size is different
+int TerminalSize_GetDescriptor(void);   // becomes readable when a resize is reported, so it can be polled together with the input (-1 if not available)
+
+#endif // _TERMINAL_SIZE_H_
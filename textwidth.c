@@ -0,0 +1,347 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+#include "textwidth.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define TEXT_WIDTH_SSE2
+#endif
+
+// first and last code point of each range, in order
+struct textWidthRange
+{
+    uint32_t First;
+    uint32_t Last;
+};
+
+static const struct textWidthRange zeroWidth[] = { // combining marks, joiners and variation selectors
+    {0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD}, {0x05BF, 0x05BF}, {0x05C1, 0x05C2}, {0x05C4, 0x05C5}, {0x05C7, 0x05C7},
+    {0x0610, 0x061A}, {0x064B, 0x065F}, {0x0670, 0x0670}, {0x06D6, 0x06DC}, {0x06DF, 0x06E4}, {0x06E7, 0x06E8}, {0x06EA, 0x06ED},
+    {0x0711, 0x0711}, {0x0730, 0x074A}, {0x07A6, 0x07B0}, {0x07EB, 0x07F3}, {0x0816, 0x082D}, {0x0859, 0x085B}, {0x08D3, 0x0902},
+    {0x093A, 0x093A}, {0x093C, 0x093C}, {0x0941, 0x0948}, {0x094D, 0x094D}, {0x0951, 0x0957}, {0x0962, 0x0963}, {0x0981, 0x0981},
+    {0x09BC, 0x09BC}, {0x09C1, 0x09C4}, {0x09CD, 0x09CD}, {0x09E2, 0x09E3}, {0x0A01, 0x0A02}, {0x0A3C, 0x0A3C}, {0x0A41, 0x0A51},
+    {0x0A70, 0x0A71}, {0x0A75, 0x0A75}, {0x0A81, 0x0A82}, {0x0ABC, 0x0ABC}, {0x0AC1, 0x0AC8}, {0x0ACD, 0x0ACD}, {0x0B01, 0x0B01},
+    {0x0B3C, 0x0B3C}, {0x0B3F, 0x0B3F}, {0x0B41, 0x0B44}, {0x0B4D, 0x0B4D}, {0x0B82, 0x0B82}, {0x0BC0, 0x0BC0}, {0x0BCD, 0x0BCD},
+    {0x0C3E, 0x0C40}, {0x0C46, 0x0C56}, {0x0CBC, 0x0CBC}, {0x0CCC, 0x0CCD}, {0x0D41, 0x0D44}, {0x0D4D, 0x0D4D}, {0x0DCA, 0x0DCA},
+    {0x0DD2, 0x0DD6}, {0x0E31, 0x0E31}, {0x0E34, 0x0E3A}, {0x0E47, 0x0E4E}, {0x0EB1, 0x0EB1}, {0x0EB4, 0x0EBC}, {0x0EC8, 0x0ECD},
+    {0x0F18, 0x0F19}, {0x0F35, 0x0F35}, {0x0F37, 0x0F37}, {0x0F39, 0x0F39}, {0x0F71, 0x0F7E}, {0x0F80, 0x0F84}, {0x0F86, 0x0F87},
+    {0x0F8D, 0x0FBC}, {0x102D, 0x1030}, {0x1032, 0x1037}, {0x1039, 0x103A}, {0x1160, 0x11FF}, {0x135D, 0x135F}, {0x1712, 0x1714},
+    {0x17B4, 0x17B5}, {0x17B7, 0x17BD}, {0x17C6, 0x17C6}, {0x17C9, 0x17D3}, {0x180B, 0x180E}, {0x1AB0, 0x1AFF}, {0x1DC0, 0x1DFF},
+    {0x200B, 0x200F}, {0x202A, 0x202E}, {0x2060, 0x2064}, {0x20D0, 0x20FF}, {0x302A, 0x302D}, {0x3099, 0x309A}, {0xA66F, 0xA672},
+    {0xA674, 0xA67D}, {0xA69E, 0xA69F}, {0xA6F0, 0xA6F1}, {0xFB1E, 0xFB1E}, {0xFE00, 0xFE0F}, {0xFE20, 0xFE2F}, {0xFEFF, 0xFEFF},
+    {0x1D167, 0x1D169}, {0x1D17B, 0x1D182}, {0x1F3FB, 0x1F3FF}, {0xE0001, 0xE007F}, {0xE0100, 0xE01EF},
+};
+
+static const struct textWidthRange doubleWidth[] = { // East Asian wide and full-width characters, and emoji
+    {0x1100, 0x115F}, {0x231A, 0x231B}, {0x2329, 0x232A}, {0x23E9, 0x23EC}, {0x23F0, 0x23F0}, {0x23F3, 0x23F3}, {0x25FD, 0x25FE},
+    {0x2614, 0x2615}, {0x2648, 0x2653}, {0x267F, 0x267F}, {0x2693, 0x2693}, {0x26A1, 0x26A1}, {0x26AA, 0x26AB}, {0x26BD, 0x26BE},
+    {0x26C4, 0x26C5}, {0x26CE, 0x26CE}, {0x26D4, 0x26D4}, {0x26EA, 0x26EA}, {0x26F2, 0x26F3}, {0x26F5, 0x26F5}, {0x26FA, 0x26FA},
+    {0x26FD, 0x26FD}, {0x2705, 0x2705}, {0x270A, 0x270B}, {0x2728, 0x2728}, {0x274C, 0x274C}, {0x274E, 0x274E}, {0x2753, 0x2755},
+    {0x2757, 0x2757}, {0x2795, 0x2797}, {0x27B0, 0x27B0}, {0x27BF, 0x27BF}, {0x2B1B, 0x2B1C}, {0x2B50, 0x2B50}, {0x2B55, 0x2B55},
+    {0x2E80, 0x303E}, {0x3041, 0x3247}, {0x3250, 0x4DBF}, {0x4E00, 0xA4CF}, {0xA960, 0xA97F}, {0xAC00, 0xD7A3}, {0xF900, 0xFAFF},
+    {0xFE10, 0xFE19}, {0xFE30, 0xFE6F}, {0xFF00, 0xFF60}, {0xFFE0, 0xFFE6}, {0x16FE0, 0x16FE4}, {0x17000, 0x18AFF}, {0x1B000, 0x1B16F},
+    {0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF}, {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A}, {0x1F200, 0x1F251}, {0x1F300, 0x1F320},
+    {0x1F32D, 0x1F335}, {0x1F337, 0x1F37C}, {0x1F37E, 0x1F393}, {0x1F3A0, 0x1F3CA}, {0x1F3CF, 0x1F3D3}, {0x1F3E0, 0x1F3F0},
+    {0x1F3F4, 0x1F3F4}, {0x1F3F8, 0x1F3FA}, {0x1F400, 0x1F43E}, {0x1F440, 0x1F440}, {0x1F442, 0x1F4FC}, {0x1F4FF, 0x1F53D},
+    {0x1F54B, 0x1F54E}, {0x1F550, 0x1F567}, {0x1F57A, 0x1F57A}, {0x1F595, 0x1F596}, {0x1F5A4, 0x1F5A4}, {0x1F5FB, 0x1F64F},
+    {0x1F680, 0x1F6C5}, {0x1F6CC, 0x1F6CC}, {0x1F6D0, 0x1F6D2}, {0x1F6D5, 0x1F6D7}, {0x1F6EB, 0x1F6EC}, {0x1F6F4, 0x1F6FC},
+    {0x1F7E0, 0x1F7EB}, {0x1F90C, 0x1F93A}, {0x1F93C, 0x1F945}, {0x1F947, 0x1F9FF}, {0x1FA70, 0x1FAFF}, {0x20000, 0x2FFFD},
+    {0x30000, 0x3FFFD},
+};
+
+static uint8_t TextWidth_InRanges(uint32_t codepoint, const struct textWidthRange *ranges, size_t numRanges)
+{
+    if (codepoint < ranges[0].First || codepoint > ranges[numRanges - 1].Last)
+        return 0;
+
+    size_t first = 0, last = numRanges;
+    while (first < last) // binary search for the range that ends at or after the code point
+    {
+        size_t middle = first + (last - first) / 2;
+
+        if (ranges[middle].Last < codepoint)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    return (first < numRanges && codepoint >= ranges[first].First);
+}
+
+uint8_t TextWidth_Codepoint(uint32_t codepoint)
+{
+    if (codepoint < 0x0300) // latin, by far the most common after ASCII
+        return 1;
+
+    if (TextWidth_InRanges(codepoint, zeroWidth, sizeof(zeroWidth) / sizeof(zeroWidth[0])))
+        return 0;
+
+    if (TextWidth_InRanges(codepoint, doubleWidth, sizeof(doubleWidth) / sizeof(doubleWidth[0])))
+        return 2;
+
+    return 1;
+}
+
+size_t TextWidth_Decode(const char *text, size_t length, uint32_t *codepoint)
+{
+    const unsigned char *bytes = (const unsigned char*)text;
+    unsigned char lead = bytes[0];
+    size_t size;
+    uint32_t value;
+    unsigned char low = 0x80, high = 0xBF; // the range of the second byte, which also rules out overlong forms and surrogates
+
+    if (lead < 0x80)
+    {
+        *codepoint = lead;
+        return 1;
+    }
+    else if (lead >= 0xC2 && lead <= 0xDF)
+    {
+        size = 2;
+        value = lead & 0x1F;
+    }
+    else if (lead >= 0xE0 && lead <= 0xEF)
+    {
+        size = 3;
+        value = lead & 0x0F;
+        if (lead == 0xE0) low = 0xA0;
+        if (lead == 0xED) high = 0x9F;
+    }
+    else if (lead >= 0xF0 && lead <= 0xF4)
+    {
+        size = 4;
+        value = lead & 0x07;
+        if (lead == 0xF0) low = 0x90;
+        if (lead == 0xF4) high = 0x8F;
+    }
+    else
+        return 0;
+
+    if (length < size || bytes[1] < low || bytes[1] > high)
+        return 0;
+
+    for (size_t index = 1; index < size; index++)
+    {
+        if ((bytes[index] & 0xC0) != 0x80)
+            return 0;
+
+        value = (value << 6) | (bytes[index] & 0x3F);
+    }
+
+    *codepoint = value;
+    return size;
+}
+
+static size_t TextWidth_AsciiRun(const char *text, size_t length) // how many bytes from the start are ASCII
+{
+    size_t index = 0;
+
+    #if defined(TEXT_WIDTH_SSE2)
+        while (index + 16 <= length)
+        {
+            if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(text + index))) != 0) // the top bit of each byte
+                break;
+
+            index += 16;
+        }
+    #endif
+
+    while (index + 8 <= length)
+    {
+        uint64_t word;
+        memcpy(&word, text + index, sizeof(word));
+
+        if (word & 0x8080808080808080ULL)
+            break;
+
+        index += 8;
+    }
+
+    while (index < length && (unsigned char)text[index] < 0x80)
+        index++;
+
+    return index;
+}
+
+uint8_t TextWidth_Validate(const char *text, size_t length)
+{
+    size_t index = 0;
+    uint32_t codepoint;
+
+    while ((index += TextWidth_AsciiRun(text + index, length - index)) < length)
+    {
+        size_t size = TextWidth_Decode(text + index, length - index, &codepoint);
+        if (size == 0)
+            return 0;
+
+        index += size;
+    }
+
+    return 1;
+}
+
+size_t TextWidth_Next(const char *text, size_t length, uint8_t *columns)
+{
+    uint32_t codepoint;
+    size_t size = TextWidth_Decode(text, length, &codepoint);
+
+    if (size == 0) // shown as a replacement character
+    {
+        *columns = 1;
+        return 1;
+    }
+
+    *columns = TextWidth_Codepoint(codepoint);
+    return size;
+}
+
+size_t TextWidth_Measure(const char *text, size_t length)
+{
+    size_t columns = 0, index = 0;
+
+    for (;;)
+    {
+        size_t ascii = TextWidth_AsciiRun(text + index, length - index); // one column each
+        columns += ascii;
+        index += ascii;
+
+        if (index >= length)
+            return columns;
+
+        uint8_t width;
+        index += TextWidth_Next(text + index, length - index, &width);
+        columns += width;
+    }
+}
+
+size_t TextWidth_String(const char *text)
+{
+    return TextWidth_Measure(text, strlen(text));
+}
+
+size_t TextWidth_Truncate(const char *text, size_t length, size_t maxColumns, size_t *columns)
+{
+    size_t used = 0, index = 0;
+
+    while (index < length)
+    {
+        uint8_t width;
+        size_t size = ((unsigned char)text[index] < 0x80) ? (width = 1, 1) : TextWidth_Next(text + index, length - index, &width);
+
+        if (used + width > maxColumns)
+            break;
+
+        used += width;
+        index += size; // the marks that combine with the last character that fits come along, as they take no room
+    }
+
+    if (columns != NULL)
+        *columns = used;
+
+    return index;
+}
+
+size_t TextWidth_TruncateStart(const char *text, size_t length, size_t maxColumns, size_t *columns)
+{
+    size_t remaining = TextWidth_Measure(text, length), index = 0;
+
+    while (remaining > maxColumns) // drop characters from the start until the rest fits
+    {
+        uint8_t width;
+        index += TextWidth_Next(text + index, length - index, &width);
+        remaining -= width;
+    }
+
+    while (index < length) // a mark left at the start has nothing to combine with
+    {
+        uint8_t width;
+        size_t size = TextWidth_Next(text + index, length - index, &width);
+
+        if (width != 0)
+            break;
+
+        index += size;
+    }
+
+    if (columns != NULL)
+        *columns = remaining;
+
+    return index;
+}
+
+// CACHE
+// =================================================================
+
+void TextWidthCache_Init(TextWidthCache *cache)
+{
+    cache->Widths = NULL;
+    cache->Length = 0;
+    cache->Capacity = 0;
+}
+
+void TextWidthCache_Destroy(TextWidthCache *cache)
+{
+    free(cache->Widths);
+    TextWidthCache_Init(cache);
+}
+
+void TextWidthCache_Changed(TextWidthCache *cache, size_t numItems, size_t firstChanged)
+{
+    if (numItems > cache->Capacity)
+    {
+        size_t capacity = numItems + numItems / 2 + 16;
+        uint16_t *widths = (uint16_t*)realloc(cache->Widths, capacity * sizeof(uint16_t));
+
+        if (widths == NULL)
+        {
+            TextWidthCache_Destroy(cache); // measure every time instead
+            return;
+        }
+
+        cache->Widths = widths;
+        cache->Capacity = capacity;
+    }
+
+    if (firstChanged > cache->Length) // the items past the old length were never measured ... whatever is stored there is stale
+        firstChanged = cache->Length;
+
+    for (size_t index = firstChanged; index < numItems; index++)
+        cache->Widths[index] = TEXT_WIDTH_UNKNOWN;
+
+    cache->Length = numItems;
+}
+
+void TextWidthCache_Reset(TextWidthCache *cache, size_t numItems)
+{
+    TextWidthCache_Changed(cache, numItems, 0);
+}
+
+size_t TextWidthCache_Get(TextWidthCache *cache, size_t index, const char *text)
+{
+    if (index >= cache->Length)
+        return TextWidth_String(text);
+
+    if (cache->Widths[index] == TEXT_WIDTH_UNKNOWN)
+    {
+        size_t columns = TextWidth_String(text);
+        cache->Widths[index] = (uint16_t)((columns < TEXT_WIDTH_UNKNOWN) ? columns : TEXT_WIDTH_UNKNOWN - 1);
+    }
+
+    return cache->Widths[index];
+}
@@ -0,0 +1,50 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+#ifndef _TEXT_WIDTH_H_
+#define _TEXT_WIDTH_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// How many terminal columns UTF-8 text takes: wide (CJK, emoji) characters take two, combining marks take none, and bytes that are not valid UTF-8 take one each (as the replacement character they are shown as)
+// Runs of ASCII are skipped 16 bytes at a time (SSE2) or 8 bytes at a time elsewhere
+
+#define TEXT_WIDTH_UNKNOWN  0xFFFF  // a width not measured yet (in TextWidthCache)
+
+typedef struct _TextWidthCache // widths of the items of a list, measured once each
+{
+    uint16_t *Widths;
+    size_t Length;
+    size_t Capacity;
+} TextWidthCache;
+
+uint8_t TextWidth_Validate(const char *text, size_t length); // returns 1 if it's all valid UTF-8
+size_t TextWidth_Decode(const char *text, size_t length, uint32_t *codepoint); // bytes of the character at text, or 0 if they are not valid UTF-8
+uint8_t TextWidth_Codepoint(uint32_t codepoint); // 0, 1 or 2 columns
+size_t TextWidth_Next(const char *text, size_t length, uint8_t *columns); // bytes and width of the character at text (1 and 1 if it is not valid UTF-8)
+size_t TextWidth_Measure(const char *text, size_t length);
+size_t TextWidth_String(const char *text); // same, up to the '\0'
+size_t TextWidth_Truncate(const char *text, size_t length, size_t maxColumns, size_t *columns); // bytes of the longest start of the text that fits in maxColumns (never half a character) ... columns receives their width
+size_t TextWidth_TruncateStart(const char *text, size_t length, size_t maxColumns, size_t *columns); // offset of the longest end of the text that fits in maxColumns
+
+void TextWidthCache_Init(TextWidthCache *cache);
+void TextWidthCache_Destroy(TextWidthCache *cache);
+void TextWidthCache_Reset(TextWidthCache *cache, size_t numItems); // all new items
+void TextWidthCache_Changed(TextWidthCache *cache, size_t numItems, size_t firstChanged); // the items before firstChanged are the same
+size_t TextWidthCache_Get(TextWidthCache *cache, size_t index, const char *text); // the width of the item, measuring it only the first time
+
+#endif // _TEXT_WIDTH_H_
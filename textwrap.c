@@ -0,0 +1,184 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+#include "textwrap.h"
+#include "textwidth.h"          // how many columns each character takes
+#include <stdlib.h>
+#include <string.h>
+
+#define TEXT_WRAP_NO_BREAK  UINT32_MAX
+
+void TextWrap_Init(TextWrap *wrap, const char *text)
+{
+    memset(wrap, 0, sizeof(TextWrap));
+    wrap->Text = text;
+    wrap->Length = (text != NULL) ? strlen(text) : 0;
+}
+
+void TextWrap_Destroy(TextWrap *wrap)
+{
+    for (uint8_t index = 0; index < TEXT_WRAP_LAYOUTS; index++)
+        free(wrap->Layouts[index].Lines);
+
+    TextWrap_Init(wrap, NULL);
+}
+
+void TextWrap_SetText(TextWrap *wrap, const char *text)
+{
+    for (uint8_t index = 0; index < TEXT_WRAP_LAYOUTS; index++)
+        wrap->Layouts[index].Width = 0; // the lines are kept for the next layouts
+
+    wrap->Text = text;
+    wrap->Length = (text != NULL) ? strlen(text) : 0;
+}
+
+static uint8_t TextWrap_AddLine(TextWrapLayout *layout, size_t start, size_t length, size_t columns)
+{
+    if (layout->NumLines == layout->Capacity)
+    {
+        uint32_t capacity = layout->Capacity * 2 + 8;
+        TextWrapLine *lines = (TextWrapLine*)realloc(layout->Lines, capacity * sizeof(TextWrapLine));
+
+        if (lines == NULL)
+            return 0;
+
+        layout->Lines = lines;
+        layout->Capacity = capacity;
+    }
+
+    layout->Lines[layout->NumLines++] = (TextWrapLine){ .Start = (uint32_t)start, .Length = (uint32_t)length, .Columns = (uint16_t)columns };
+
+    if (columns > layout->Columns)
+        layout->Columns = (uint16_t)columns;
+
+    return 1;
+}
+
+static uint8_t TextWrap_Break(TextWrapLayout *layout, const char *text, size_t length, uint16_t width) // greedy: as many words on each line as fit
+{
+    size_t position = 0, lineStart = 0, lineColumns = 0;
+    uint32_t breakEnd = TEXT_WRAP_NO_BREAK;     // where the last spaces on the line start (the line can end there) ...
+    size_t breakColumns = 0;                    // ... the columns before them ...
+    size_t breakNext = 0, breakNextColumns = 0; // ... and where the next line would start
+
+    layout->NumLines = 0;
+    layout->Columns = 0;
+
+    while (position < length)
+    {
+        char c = text[position];
+
+        if (c == '\n')
+        {
+            uint8_t trailing = (breakEnd != TEXT_WRAP_NO_BREAK && breakNext == position); // the spaces before the newline are not shown
+            if (!TextWrap_AddLine(layout, lineStart, (trailing ? breakEnd : position) - lineStart, trailing ? breakColumns : lineColumns))
+                return 0;
+
+            lineStart = ++position;
+            lineColumns = 0;
+            breakEnd = TEXT_WRAP_NO_BREAK;
+            continue;
+        }
+
+        if (c == ' ' || c == '\t' || c == '\r') // spaces may hang past the width: they are cut off with the line
+        {
+            if (breakEnd == TEXT_WRAP_NO_BREAK || breakNext != position) // the first of a run of spaces
+            {
+                breakEnd = (uint32_t)position;
+                breakColumns = lineColumns;
+            }
+
+            position++;
+            lineColumns++;
+            breakNext = position;
+            breakNextColumns = lineColumns;
+            continue;
+        }
+
+        uint32_t codepoint;
+        size_t size = TextWidth_Decode(&text[position], length - position, &codepoint);
+        size_t columns = (size == 0) ? 1 : TextWidth_Codepoint(codepoint); // a byte that is not UTF-8 is shown as one replacement character
+        if (size == 0)
+            size = 1;
+
+        if (lineColumns + columns > width && position > lineStart) // it does not fit: break the line
+        {
+            if (breakEnd != TEXT_WRAP_NO_BREAK && breakEnd > lineStart) // at the last spaces ...
+            {
+                if (!TextWrap_AddLine(layout, lineStart, breakEnd - lineStart, breakColumns))
+                    return 0;
+
+                lineStart = breakNext;
+                lineColumns -= breakNextColumns;
+            }
+            else // ... or in the middle of a word that is longer than the line
+            {
+                if (!TextWrap_AddLine(layout, lineStart, position - lineStart, lineColumns))
+                    return 0;
+
+                lineStart = position;
+                lineColumns = 0;
+            }
+
+            breakEnd = TEXT_WRAP_NO_BREAK;
+            continue; // the same character again, on the new line
+        }
+
+        position += size;
+        lineColumns += columns;
+    }
+
+    if (lineStart < length || layout->NumLines == 0) // the last line, unless the text ended with a newline
+    {
+        uint8_t trailing = (breakEnd != TEXT_WRAP_NO_BREAK && breakNext == length);
+        if (!TextWrap_AddLine(layout, lineStart, (trailing ? breakEnd : length) - lineStart, trailing ? breakColumns : lineColumns))
+            return 0;
+    }
+
+    return 1;
+}
+
+const TextWrapLayout* TextWrap_Get(TextWrap *wrap, uint16_t width)
+{
+    TextWrapLayout *oldest = &wrap->Layouts[0];
+    width = (width > 0) ? width : 1;
+    wrap->Uses++;
+
+    for (uint8_t index = 0; index < TEXT_WRAP_LAYOUTS; index++)
+    {
+        TextWrapLayout *layout = &wrap->Layouts[index];
+
+        if (layout->Width != 0 && layout->Columns <= width && width <= layout->Width) // the lines it was broken in fit the narrower width too, and nothing more fits in the wider one
+        {
+            layout->LastUse = wrap->Uses;
+            return layout;
+        }
+
+        if (layout->Width == 0 || (oldest->Width != 0 && layout->LastUse < oldest->LastUse))
+            oldest = layout;
+    }
+
+    oldest->Width = width;
+    oldest->LastUse = wrap->Uses;
+
+    if (!TextWrap_Break(oldest, (wrap->Text != NULL) ? wrap->Text : "", wrap->Length, width))
+    {
+        oldest->Width = 0;
+        return NULL;
+    }
+
+    return oldest;
+}
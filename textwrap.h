@@ -0,0 +1,59 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+#ifndef _TEXT_WRAP_H_
+#define _TEXT_WRAP_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Lays UTF-8 text out in lines of at most a given number of columns: the lines break at spaces, a word too long for a line is cut, and '\n' always starts a new line
+// The breaks are worked out once for each width and kept, so drawing the text again (or resizing back and forth) does not read it again
+
+#define TEXT_WRAP_LAYOUTS   4       // widths kept for each text (the least recently used one goes first)
+#define TEXT_WRAP_UNLIMITED 0xFFFF  // a width that only breaks at '\n' ... its widest line is how wide the text wants to be
+
+typedef struct _TextWrapLine
+{
+    uint32_t Start;         // offset in the text
+    uint32_t Length;        // bytes, without the spaces it was broken at
+    uint16_t Columns;
+} TextWrapLine;
+
+typedef struct _TextWrapLayout
+{
+    uint16_t Width;         // it was wrapped to (0 = not used)
+    uint16_t Columns;       // of the widest line
+    uint32_t NumLines;
+    uint32_t Capacity;
+    TextWrapLine *Lines;
+    uint32_t LastUse;
+} TextWrapLayout;
+
+typedef struct _TextWrap
+{
+    const char *Text;       // owned by the caller, who must not change it while it is wrapped (TextWrap_SetText again instead)
+    size_t Length;
+    uint32_t Uses;
+    TextWrapLayout Layouts[TEXT_WRAP_LAYOUTS];
+} TextWrap;
+
+void TextWrap_Init(TextWrap *wrap, const char *text);
+void TextWrap_Destroy(TextWrap *wrap);
+void TextWrap_SetText(TextWrap *wrap, const char *text); // forgets the layouts of the old text
+const TextWrapLayout* TextWrap_Get(TextWrap *wrap, uint16_t width); // the text laid out in lines of at most width columns ... NULL if out of memory
+
+#endif // _TEXT_WRAP_H_
@@ -0,0 +1,143 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+#include "threadpool.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+#if defined(unix) || defined(__unix__) || defined(__unix)
+    #include <unistd.h>
+#elif (defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN32__))
+    #include <windows.h>
+#endif
+
+static pthread_mutex_t runMutex = PTHREAD_MUTEX_INITIALIZER;    // one batch at a time
+static pthread_mutex_t poolMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t workAvailable = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t workFinished = PTHREAD_COND_INITIALIZER;
+
+static uint8_t numWorkers = 0;
+static uint8_t initialized = 0;
+static pthread_t workers[THREAD_POOL_MAX_THREADS];
+
+// the current batch
+static uint32_t generation = 0;
+static ThreadPoolJob batchJob;
+static void *batchArgument;
+static uint8_t batchCount;
+static atomic_uint batchNext;
+static uint8_t batchDone;
+
+static uint8_t ThreadPool_CountProcessors(void)
+{
+    #if defined(unix) || defined(__unix__) || defined(__unix)
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    #elif (defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN32__))
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        long processors = info.dwNumberOfProcessors;
+    #else
+        long processors = 1;
+    #endif
+
+    if (processors < 1)
+        processors = 1;
+
+    return (processors > THREAD_POOL_MAX_THREADS) ? THREAD_POOL_MAX_THREADS : processors;
+}
+
+static void ThreadPool_Work(void) // takes jobs of the current batch until there are none left
+{
+    unsigned int index;
+    while ((index = atomic_fetch_add(&batchNext, 1)) < batchCount)
+    {
+        batchJob(batchArgument, index);
+
+        pthread_mutex_lock(&poolMutex);
+        if (++batchDone == batchCount)
+            pthread_cond_signal(&workFinished);
+        pthread_mutex_unlock(&poolMutex);
+    }
+}
+
+static void* ThreadPool_Worker(void *argument)
+{
+    uint32_t seenGeneration = 0;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&poolMutex);
+        while (generation == seenGeneration)
+            pthread_cond_wait(&workAvailable, &poolMutex);
+        seenGeneration = generation;
+        pthread_mutex_unlock(&poolMutex);
+
+        ThreadPool_Work();
+    }
+
+    (void)argument;
+    return NULL;
+}
+
+static void ThreadPool_Initialize(void)
+{
+    initialized = 1;
+
+    uint8_t processors = ThreadPool_CountProcessors();
+    for (numWorkers = 0; numWorkers < processors - 1; numWorkers++) // the calling thread is the last worker
+        if (pthread_create(&workers[numWorkers], NULL, ThreadPool_Worker, NULL) != 0)
+            break;
+}
+
+uint8_t ThreadPool_Size(void)
+{
+    pthread_mutex_lock(&runMutex);
+    if (!initialized)
+        ThreadPool_Initialize();
+    pthread_mutex_unlock(&runMutex);
+
+    return numWorkers + 1;
+}
+
+void ThreadPool_Run(ThreadPoolJob job, void *argument, uint8_t count)
+{
+    if (count == 0)
+        return;
+
+    pthread_mutex_lock(&runMutex);
+    if (!initialized)
+        ThreadPool_Initialize();
+
+    pthread_mutex_lock(&poolMutex);
+    batchJob = job;
+    batchArgument = argument;
+    batchCount = count;
+    batchDone = 0;
+    atomic_store(&batchNext, 0);
+    generation++;
+    pthread_cond_broadcast(&workAvailable);
+    pthread_mutex_unlock(&poolMutex);
+
+    ThreadPool_Work(); // help instead of just waiting
+
+    pthread_mutex_lock(&poolMutex);
+    while (batchDone < batchCount)
+        pthread_cond_wait(&workFinished, &poolMutex);
+    pthread_mutex_unlock(&poolMutex);
+
+    pthread_mutex_unlock(&runMutex);
+}
@@ -0,0 +1,30 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+#include <stdint.h>
+
+#define THREAD_POOL_MAX_THREADS     8
+
+typedef void (*ThreadPoolJob)(void *argument, uint8_t index);
+
+uint8_t ThreadPool_Size(void); // how many jobs can run at the same time (the workers plus the calling thread)
+void ThreadPool_Run(ThreadPoolJob job, void *argument, uint8_t count); // calls job(argument, 0 ... count-1) spread over the pool and returns when all of them are done
+
+#endif // _THREAD_POOL_H_
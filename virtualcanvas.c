@@ -0,0 +1,298 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+#include "virtualcanvas.h"
+#include "terminalsize.h"
+#include "outputsink.h"
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VIRTUAL_CANVAS_INITIAL_TABLE 64
+
+static uint32_t VirtualCanvas_Hash(uint32_t tileX, uint32_t tileY)
+{
+    uint32_t hash = tileX * 0x9E3779B1u ^ tileY * 0x85EBCA77u;
+    return hash ^ (hash >> 15);
+}
+
+static VirtualCanvasTile* VirtualCanvas_FindTile(const VirtualCanvas *canvas, uint32_t tileX, uint32_t tileY)
+{
+    if (canvas->TableSize == 0) // the table could not be allocated
+        return NULL;
+
+    for (uint32_t slot = VirtualCanvas_Hash(tileX, tileY);; slot++)
+    {
+        VirtualCanvasTile *tile = canvas->Tiles[slot & (canvas->TableSize - 1)];
+
+        if (tile == NULL)
+            return NULL; // an empty slot ends the probe: the tile was never drawn on
+
+        if (tile->TileX == tileX && tile->TileY == tileY)
+            return tile;
+    }
+}
+
+static void VirtualCanvas_InsertTile(VirtualCanvas *canvas, VirtualCanvasTile *tile)
+{
+    uint32_t slot = VirtualCanvas_Hash(tile->TileX, tile->TileY);
+
+    while (canvas->Tiles[slot & (canvas->TableSize - 1)] != NULL)
+        slot++;
+
+    canvas->Tiles[slot & (canvas->TableSize - 1)] = tile;
+}
+
+static VirtualCanvasTile* VirtualCanvas_AllocateTile(VirtualCanvas *canvas, uint32_t tileX, uint32_t tileY) // returns NULL if there's no memory (the canvas is left as it was)
+{
+    if ((canvas->NumTiles + 1) * 2 > canvas->TableSize) // keep the table at most half full so the probes stay short
+    {
+        uint32_t size = (canvas->TableSize == 0) ? VIRTUAL_CANVAS_INITIAL_TABLE : canvas->TableSize * 2;
+        VirtualCanvasTile **tiles = (VirtualCanvasTile**)calloc(size, sizeof(VirtualCanvasTile*));
+        if (tiles == NULL)
+            return NULL; // the old table still holds everything
+
+        VirtualCanvasTile **oldTiles = canvas->Tiles;
+        uint32_t oldSize = canvas->TableSize;
+
+        canvas->Tiles = tiles;
+        canvas->TableSize = size;
+
+        for (uint32_t slot = 0; slot < oldSize; slot++)
+            if (oldTiles[slot] != NULL)
+                VirtualCanvas_InsertTile(canvas, oldTiles[slot]);
+
+        free(oldTiles);
+    }
+
+    VirtualCanvasTile *tile = (VirtualCanvasTile*)calloc(1, sizeof(VirtualCanvasTile));
+    if (tile == NULL)
+        return NULL;
+
+    tile->TileX = tileX;
+    tile->TileY = tileY;
+
+    VirtualCanvas_InsertTile(canvas, tile);
+    canvas->NumTiles++;
+
+    return tile;
+}
+
+void VirtualCanvas_Create(VirtualCanvas *canvas, uint32_t W, uint32_t H, uint8_t ViewLeft, uint8_t ViewTop, uint8_t ViewW, uint8_t ViewH)
+{
+    canvas->Width = max(W, 1); // an empty area would leave no room for the view
+    canvas->Height = max(H, 1);
+
+    canvas->NumTiles = 0;
+    canvas->Tiles = (VirtualCanvasTile**)calloc(VIRTUAL_CANVAS_INITIAL_TABLE, sizeof(VirtualCanvasTile*));
+    canvas->TableSize = (canvas->Tiles != NULL) ? VIRTUAL_CANVAS_INITIAL_TABLE : 0; // without it, nothing is drawn until a tile can be allocated
+
+    uint8_t termW, termH;
+    TerminalSize_Get(&termW, &termH);
+
+    ViewW = max(min((ViewW == 0) ? termW : ViewW, canvas->Width), 1); // the view cannot be larger than what it shows ... nor 0, which BoxCanvas_Create takes for "fullscreen"
+    ViewH = max(min((ViewH == 0) ? termH : ViewH, canvas->Height), 1);
+    BoxCanvas_Create(&canvas->View, ViewLeft, ViewTop, ViewW, ViewH);
+
+    canvas->ViewX = 0;
+    canvas->ViewY = 0;
+    canvas->Dirty = 1;
+    canvas->Shown = 0;
+}
+
+void VirtualCanvas_Destroy(VirtualCanvas *canvas)
+{
+    for (uint32_t slot = 0; slot < canvas->TableSize; slot++)
+        free(canvas->Tiles[slot]);
+
+    free(canvas->Tiles);
+    BoxCanvas_Destroy(&canvas->View);
+}
+
+uint8_t VirtualCanvas_GetCell(const VirtualCanvas *canvas, uint32_t X, uint32_t Y)
+{
+    VirtualCanvasTile *tile = VirtualCanvas_FindTile(canvas, X / VIRTUAL_CANVAS_TILE_WIDTH, Y / VIRTUAL_CANVAS_TILE_HEIGHT);
+    return (tile == NULL) ? 0 : tile->Cells[Y % VIRTUAL_CANVAS_TILE_HEIGHT][X % VIRTUAL_CANVAS_TILE_WIDTH];
+}
+
+void VirtualCanvas_Box(VirtualCanvas *canvas, uint32_t X, uint32_t Y, uint32_t W, uint32_t H, BoxDrawStyle style)
+{
+    if (X >= canvas->Width || Y >= canvas->Height || W == 0 || H == 0)
+        return;
+
+    uint32_t maxX = min((uint64_t)X + W, canvas->Width);
+    uint32_t maxY = min((uint64_t)Y + H, canvas->Height);
+    uint32_t endX = maxX + (((style & BOX_STYLE_SHADOW) && maxX < canvas->Width) ? 1 : 0);
+    uint32_t endY = maxY + (((style & BOX_STYLE_SHADOW) && maxY < canvas->Height) ? 1 : 0);
+
+    uint8_t fill = style & BOX_STYLE_FILL;
+
+    for (uint32_t tileY = Y / VIRTUAL_CANVAS_TILE_HEIGHT; tileY <= (endY - 1) / VIRTUAL_CANVAS_TILE_HEIGHT; tileY++) // visit the tiles the box touches, one at a time
+    {
+        for (uint32_t tileX = X / VIRTUAL_CANVAS_TILE_WIDTH; tileX <= (endX - 1) / VIRTUAL_CANVAS_TILE_WIDTH; tileX++)
+        {
+            uint32_t firstX = max(X, tileX * VIRTUAL_CANVAS_TILE_WIDTH);
+            uint32_t lastX  = min(endX, (tileX + 1) * VIRTUAL_CANVAS_TILE_WIDTH);
+            uint32_t firstY = max(Y, tileY * VIRTUAL_CANVAS_TILE_HEIGHT);
+            uint32_t lastY  = min(endY, (tileY + 1) * VIRTUAL_CANVAS_TILE_HEIGHT);
+
+            // the interior of a box has no lines: an empty tile stays unallocated unless the box actually draws something on it
+            uint8_t touchesLines = (firstX == X || lastX >= maxX || firstY == Y || lastY >= maxY);
+
+            VirtualCanvasTile *tile = VirtualCanvas_FindTile(canvas, tileX, tileY);
+            if (tile == NULL)
+            {
+                if (!touchesLines)
+                    continue; // filling an empty area with nothing changes nothing
+
+                tile = VirtualCanvas_AllocateTile(canvas, tileX, tileY);
+                if (tile == NULL)
+                    continue; // no memory: this part of the box is not drawn
+            }
+
+            for (uint32_t currY = firstY; currY < lastY; currY++)
+                for (uint32_t currX = firstX; currX < lastX; currX++)
+                {
+                    uint8_t code = BoxCanvas_BoxCode(X, Y, maxX, maxY, currX, currY, style);
+                    uint8_t *cell = &tile->Cells[currY - tileY * VIRTUAL_CANVAS_TILE_HEIGHT][currX - tileX * VIRTUAL_CANVAS_TILE_WIDTH];
+
+                    if (fill)
+                        *cell = code;
+                    else
+                        *cell = BoxCanvas_MergeCode(*cell, code);
+                }
+        }
+    }
+
+    canvas->Dirty = 1;
+}
+
+void VirtualCanvas_SetViewport(VirtualCanvas *canvas, uint32_t X, uint32_t Y)
+{
+    canvas->ViewX = min(X, canvas->Width - canvas->View.Width);
+    canvas->ViewY = min(Y, canvas->Height - canvas->View.Height);
+}
+
+void VirtualCanvas_Pan(VirtualCanvas *canvas, int32_t dX, int32_t dY)
+{
+    int64_t X = (int64_t)canvas->ViewX + dX;
+    int64_t Y = (int64_t)canvas->ViewY + dY;
+
+    VirtualCanvas_SetViewport(canvas, (X < 0) ? 0 : X, (Y < 0) ? 0 : Y);
+}
+
+static void VirtualCanvas_CopyView(VirtualCanvas *canvas, uint8_t firstRow, uint8_t numRows) // brings the cells under the viewport into the view canvas
+{
+    BoxCanvas *view = &canvas->View;
+
+    for (uint8_t row = firstRow; row < firstRow + numRows; row++)
+    {
+        uint32_t Y = canvas->ViewY + row;
+        uint32_t X = canvas->ViewX;
+
+        while (X < canvas->ViewX + view->Width) // one tile-wide run at a time
+        {
+            uint32_t runEnd = min((X / VIRTUAL_CANVAS_TILE_WIDTH + 1) * VIRTUAL_CANVAS_TILE_WIDTH, canvas->ViewX + view->Width);
+            uint8_t *destination = &view->BlockBuffer[row][X - canvas->ViewX];
+            VirtualCanvasTile *tile = VirtualCanvas_FindTile(canvas, X / VIRTUAL_CANVAS_TILE_WIDTH, Y / VIRTUAL_CANVAS_TILE_HEIGHT);
+
+            if (tile == NULL)
+                memset(destination, 0, runEnd - X);
+            else
+                memcpy(destination, &tile->Cells[Y % VIRTUAL_CANVAS_TILE_HEIGHT][X % VIRTUAL_CANVAS_TILE_WIDTH], runEnd - X);
+
+            X = runEnd;
+        }
+    }
+}
+
+#if defined(unix) || defined(__unix__) || defined(__unix)
+
+static uint8_t VirtualCanvas_Scroll(VirtualCanvas *canvas) // returns 1 if the viewport was moved by scrolling the terminal
+{
+    BoxCanvas *view = &canvas->View;
+
+    uint8_t termW, termH;
+    TerminalSize_Get(&termW, &termH);
+
+    // the scrolling region of the terminal is made of whole lines, so the view must span the whole width
+    if (canvas->Dirty || canvas->ViewX != canvas->ShownX || view->Left != 0 || view->Width != termW)
+        return 0;
+
+    int64_t rows = (int64_t)canvas->ViewY - canvas->ShownY; // positive: the content moves up
+    int64_t jump = (rows < 0) ? -rows : rows;
+
+    if (rows == 0 || jump >= view->Height) // compared before it's narrowed: a jump of 256 rows is not a scroll of 0
+        return 0;
+
+    uint8_t distance = (uint8_t)jump;
+
+    Arena *scratch = Arena_Scratch();
+    ArenaMark mark = Arena_Mark(scratch);
+
+    char *buffer = (char*)Arena_Alloc(scratch, BOX_CANVAS_ROW_BYTES(view->Width)); // not on the stack, same as BoxCanvas_Render
+    if (buffer == NULL)
+        return 0; // rendered the usual way
+
+    Terminal_SaveCursorPosition();
+    Terminal_SetStyle(view->FillStyle, view->BackgroundStyle); // the lines scrolled in are painted with the current background
+
+    printf("\x1b[%u;%ur", view->Top + 1, view->Top + view->Height); // limit the scrolling to the view ...
+    printf((rows > 0) ? "\x1b[%uS" : "\x1b[%uT", distance); // ... scroll it ...
+    printf("\x1b[r"); // ... and give the whole screen back
+
+    uint8_t firstRow = (rows > 0) ? view->Height - distance : 0; // only the rows that came into view are encoded
+    VirtualCanvas_CopyView(canvas, 0, view->Height);
+
+    for (uint8_t row = firstRow; row < firstRow + distance; row++)
+    {
+        size_t length = BoxCanvas_EncodeRows(view, row, 1, 1, 1, buffer);
+        OutputSink_Print(buffer, length);
+    }
+
+    Arena_Release(scratch, mark);
+    Terminal_RestoreCursorSavedPosition();
+    return 1;
+}
+
+#else
+
+static uint8_t VirtualCanvas_Scroll(VirtualCanvas *canvas)
+{
+    (void)canvas;
+    return 0; // the console is redrawn instead
+}
+
+#endif
+
+void VirtualCanvas_Render(VirtualCanvas *canvas)
+{
+    if (canvas->Shown && !canvas->Dirty && canvas->ViewX == canvas->ShownX && canvas->ViewY == canvas->ShownY)
+        return; // nothing changed on the screen
+
+    if (!canvas->Shown || !VirtualCanvas_Scroll(canvas))
+    {
+        VirtualCanvas_CopyView(canvas, 0, canvas->View.Height);
+        BoxCanvas_Render(&canvas->View);
+    }
+
+    canvas->Shown = 1;
+    canvas->ShownX = canvas->ViewX;
+    canvas->ShownY = canvas->ViewY;
+    canvas->Dirty = 0;
+}
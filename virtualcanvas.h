@@ -0,0 +1,64 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+
+#ifndef _VIRTUAL_CANVAS_H_
+#define _VIRTUAL_CANVAS_H_
+
+#include <stdint.h>
+#include "boxcanvas.h"
+
+// A canvas bigger than the screen: the drawing is kept in tiles that are only allocated once something is drawn on them,
+// and only the part under the viewport is encoded. Vertical panning scrolls the terminal and draws just the rows that come into view.
+
+#define VIRTUAL_CANVAS_TILE_WIDTH   64
+#define VIRTUAL_CANVAS_TILE_HEIGHT  16
+
+typedef struct _VirtualCanvasTile
+{
+    uint32_t TileX;
+    uint32_t TileY;
+    uint8_t Cells[VIRTUAL_CANVAS_TILE_HEIGHT][VIRTUAL_CANVAS_TILE_WIDTH];
+} VirtualCanvasTile;
+
+typedef struct _VirtualCanvas
+{
+    uint32_t Width;
+    uint32_t Height;
+
+    VirtualCanvasTile **Tiles;  // hash table of the allocated tiles (open addressing)
+    uint32_t TableSize;         // power of 2
+    uint32_t NumTiles;
+
+    uint32_t ViewX;             // top left corner of the viewport inside the virtual area
+    uint32_t ViewY;
+    BoxCanvas View;             // the on-screen area (position, size and style) - holds a copy of the cells under the viewport
+
+    uint8_t Dirty;              // something was drawn since the last render
+    uint8_t Shown;              // the view is on the screen, at ShownX/ShownY
+    uint32_t ShownX;
+    uint32_t ShownY;
+} VirtualCanvas;
+
+void VirtualCanvas_Create(VirtualCanvas *canvas, uint32_t W, uint32_t H, uint8_t ViewLeft, uint8_t ViewTop, uint8_t ViewW, uint8_t ViewH); // 0 view width or height means "fullscreen"
+void VirtualCanvas_Destroy(VirtualCanvas *canvas);
+void VirtualCanvas_Box(VirtualCanvas *canvas, uint32_t X, uint32_t Y, uint32_t W, uint32_t H, BoxDrawStyle style);
+uint8_t VirtualCanvas_GetCell(const VirtualCanvas *canvas, uint32_t X, uint32_t Y);
+void VirtualCanvas_SetViewport(VirtualCanvas *canvas, uint32_t X, uint32_t Y); // kept inside the virtual area
+void VirtualCanvas_Pan(VirtualCanvas *canvas, int32_t dX, int32_t dY);
+void VirtualCanvas_Render(VirtualCanvas *canvas);
+
+#endif // _VIRTUAL_CANVAS_H_
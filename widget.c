@@ -0,0 +1,801 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+#include "widget.h"
+#include "port_kbhit.h"         // portable kbhit and getch functions
+#include "terminalsize.h"       // cached terminal size
+#include "session.h"            // the terminal of each thread
+#include "arena.h"              // scratch memory for the drawing
+#include "syncupdate.h"         // asked here, where the keys are read
+#include <stdio.h>              // printf, fwrite etc
+#include <string.h>
+#include <ctype.h>
+
+#if (defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN32__))
+    #include <windows.h>
+#endif
+
+static void PrintSpaces(size_t count)
+{
+    for (;count>0;count--)
+        printf(" ");
+}
+
+static void PrintText(const char *text, size_t length) // tabs, carriage returns and new lines are shown as the spaces they were measured as (a line of text stays on its line)
+{
+    for (size_t start = 0, end = 0; start < length; start = end + 1)
+    {
+        for (end = start; end < length && text[end] != '\t' && text[end] != '\r' && text[end] != '\n'; end++);
+
+        fwrite(&text[start], sizeof(char), end - start, stdout);
+        if (end < length)
+            fputc(' ', stdout);
+    }
+}
+
+void PrintWidthBytes(uint8_t width, uint8_t centered, const char* text, size_t length, size_t columns)
+{
+    if (columns > width && width >= 4) // the start and the end of it, with ".." in the middle
+    {
+        size_t headColumns, tailColumns;
+        size_t head = TextWidth_Truncate(text, length, width/2 - 1, &headColumns);
+        size_t tail = TextWidth_TruncateStart(text, length, width - 2 - headColumns, &tailColumns);
+
+        PrintText(text, head);
+        printf("..");
+        PrintText(&text[tail], length - tail);
+        PrintSpaces(width - 2 - headColumns - tailColumns); // a wide character that did not fit
+    }
+    else if (columns > width)
+    {
+        size_t shownColumns;
+        PrintText(text, TextWidth_Truncate(text, length, width, &shownColumns));
+        PrintSpaces(width - shownColumns);
+    }
+    else
+    {
+        size_t leftComplete = centered ? (width-columns)/2 : 0;
+        size_t rightComplete = width - columns - leftComplete;
+
+        PrintSpaces(leftComplete);
+        PrintText(text, length);
+        PrintSpaces(rightComplete);
+    }
+}
+
+void PrintWidthColumns(uint8_t width, uint8_t centered, const char* text, size_t columns)
+{
+    PrintWidthBytes(width, centered, text, strlen(text), columns);
+}
+
+void PrintWidth(uint8_t width, uint8_t centered, const char* text)
+{
+    PrintWidthColumns(width, centered, text, TextWidth_String(text));
+}
+
+static void ClearRectangle(int16_t left, int16_t top, int16_t right, int16_t bottom)
+{
+    if (right > left && bottom > top)
+        Terminal_ClearArea(left, top, right - left, bottom - top);
+}
+
+void Widget_ClearUncoveredArea(const WidgetArea *oldArea, const WidgetArea *newArea)
+{
+    // when a resize moves the dialog, only what it leaves behind needs to be cleared - the new area is painted over anyway
+    uint8_t termW, termH;
+    TerminalSize_Get(&termW, &termH);
+
+    int16_t oldRight    = min(oldArea->X + oldArea->W + 1, termW); // +1 for the shadow
+    int16_t oldBottom   = min(oldArea->Y + oldArea->H + 1, termH);
+    int16_t newRight    = newArea->X + newArea->W + 1;
+    int16_t newBottom   = newArea->Y + newArea->H + 1;
+
+    int16_t middleTop    = max(oldArea->Y, newArea->Y);
+    int16_t middleBottom = min(oldBottom, newBottom);
+
+    Terminal_SetStyle(CONSOLE_STYLE_TEXT_WHITE, CONSOLE_STYLE_BACKGROUND_BLACK);
+    ClearRectangle(oldArea->X, oldArea->Y, oldRight, min(oldBottom, newArea->Y));               // above the new area
+    ClearRectangle(oldArea->X, max(oldArea->Y, newBottom), oldRight, oldBottom);                // below the new area
+    ClearRectangle(oldArea->X, middleTop, min(oldRight, newArea->X), middleBottom);             // left of the new area
+    ClearRectangle(max(oldArea->X, newRight), middleTop, oldRight, middleBottom);               // right of the new area
+}
+
+// BUILDING THE TREE
+// =================================================================
+
+static void Widget_Init(Widget *widget, Widget *parent, WidgetPlacement placement, WidgetType type)
+{
+    memset(widget, 0, sizeof(Widget));
+    widget->Type = type;
+    widget->Placement = placement;
+    widget->Dirty = WIDGET_DIRTY_ALL;
+
+    if (parent == NULL)
+        return;
+
+    widget->Parent = parent;
+
+    if (parent->LastChild == NULL)
+        parent->FirstChild = widget;
+    else
+        parent->LastChild->Next = widget;
+
+    parent->LastChild = widget;
+    parent->ChildDirty = 1;
+}
+
+void Widget_InitPanel(Widget *widget, Widget *parent, WidgetPlacement placement, ChromeDrawer chrome, const char *title, WidgetTitleWidth titleWidth)
+{
+    Widget_Init(widget, parent, placement, WIDGET_PANEL);
+    widget->Panel.Chrome = chrome;
+    widget->Panel.Title = title;
+    widget->Panel.TitleWidth = titleWidth;
+    widget->Panel.Split = 0;
+}
+
+void Widget_InitLabel(Widget *widget, Widget *parent, WidgetPlacement placement, const char *text, WidgetRole role, uint8_t centered)
+{
+    Widget_Init(widget, parent, placement, WIDGET_LABEL);
+    snprintf(widget->Label.Text, WIDGET_TEXT_MAX, "%s", text);
+    widget->Label.Role = role;
+    widget->Label.Centered = centered;
+}
+
+void Widget_InitParagraph(Widget *widget, Widget *parent, WidgetPlacement placement, TextWrap *wrap, WidgetRole role, uint8_t centered)
+{
+    Widget_Init(widget, parent, placement, WIDGET_PARAGRAPH);
+    widget->Paragraph.Wrap = wrap;
+    widget->Paragraph.Role = role;
+    widget->Paragraph.Centered = centered;
+}
+
+void Widget_InitTextField(Widget *widget, Widget *parent, WidgetPlacement placement, const char *caption, char *text, size_t capacity)
+{
+    Widget_Init(widget, parent, placement, WIDGET_TEXT_FIELD);
+    widget->TextField.Caption = caption;
+    widget->TextField.Text = text;
+    widget->TextField.Capacity = capacity;
+}
+
+void Widget_InitSlider(Widget *widget, Widget *parent, WidgetPlacement placement, float minValue, float value, float maxValue, float increment)
+{
+    Widget_Init(widget, parent, placement, WIDGET_SLIDER);
+    widget->Slider.Min = minValue;
+    widget->Slider.Value = value;
+    widget->Slider.Max = maxValue;
+    widget->Slider.Increment = increment;
+}
+
+void Widget_InitList(Widget *widget, Widget *parent, WidgetPlacement placement, uint32_t numItems, WidgetGetItem getItem, void *context, uint8_t columns, uint8_t flags)
+{
+    Widget_Init(widget, parent, placement, WIDGET_LIST);
+    widget->List.NumItems = numItems;
+    widget->List.GetItem = getItem;
+    widget->List.Context = context;
+    widget->List.Columns = max(columns, 1);
+    widget->List.Flags = flags;
+    widget->List.Selected = -1;
+    widget->List.RedrawFirst = UINT32_MAX;
+    widget->List.Widths = NULL;
+}
+
+void Widget_CacheWidths(Widget *widget, TextWidthCache *cache)
+{
+    widget->List.Widths = cache;
+    TextWidthCache_Reset(cache, widget->List.NumItems);
+}
+
+static const char* Widget_ButtonText(void *context, uint32_t index)
+{
+    return ((char**)context)[index];
+}
+
+void Widget_InitButtons(Widget *widget, Widget *parent, WidgetPlacement placement, uint8_t numOptions, char* options[])
+{
+    Widget_InitList(widget, parent, placement, numOptions, Widget_ButtonText, options, 1, WIDGET_LIST_CENTERED);
+    widget->List.Selected = 0;
+}
+
+// CHANGING THE STATE
+// =================================================================
+
+static void Widget_MarkDirty(Widget *widget, uint8_t dirty)
+{
+    widget->Dirty |= dirty;
+
+    for (Widget *parent = widget->Parent; parent != NULL && !parent->ChildDirty; parent = parent->Parent) // the path from the root finds it
+        parent->ChildDirty = 1;
+}
+
+static void Widget_MarkTree(Widget *widget) // the widget and all below it are drawn again
+{
+    widget->Dirty = WIDGET_DIRTY_ALL;
+    widget->ChildDirty = (widget->FirstChild != NULL);
+
+    for (Widget *child = widget->FirstChild; child != NULL; child = child->Next)
+        Widget_MarkTree(child);
+}
+
+void Widget_Invalidate(Widget *widget)
+{
+    Widget_MarkDirty(widget, WIDGET_DIRTY_ALL);
+}
+
+void Widget_SetText(Widget *widget, const char *text)
+{
+    if (strncmp(widget->Label.Text, text, WIDGET_TEXT_MAX - 1) == 0)
+        return; // the same text is already on the screen
+
+    snprintf(widget->Label.Text, WIDGET_TEXT_MAX, "%s", text);
+    Widget_Invalidate(widget);
+}
+
+void Widget_SetValue(Widget *widget, float value)
+{
+    if (value == widget->Slider.Value)
+        return;
+
+    widget->Slider.Value = value;
+    Widget_Invalidate(widget);
+}
+
+static uint32_t Widget_ListPageSize(const Widget *widget)
+{
+    return max((uint32_t)widget->Area.H * widget->List.Columns, 1);
+}
+
+static uint32_t Widget_ListTop(const Widget *widget) // the first item to show so the selection is on the screen
+{
+    uint32_t pageSize = Widget_ListPageSize(widget);
+    int64_t selected = widget->List.Selected;
+    uint32_t top = widget->List.Top;
+
+    if (selected < 0)
+        return top; // nothing to follow
+
+    if (widget->List.Flags & WIDGET_LIST_PAGED)
+        return (uint32_t)(selected / pageSize * pageSize);
+
+    uint32_t columns = widget->List.Columns;
+    uint32_t row = (uint32_t)selected / columns;
+
+    if (row < top / columns)
+        return row * columns;
+
+    if (row >= top / columns + widget->Area.H)
+        return (row - widget->Area.H + 1) * columns;
+
+    return top;
+}
+
+void Widget_Select(Widget *widget, int64_t index)
+{
+    if (index >= (int64_t)widget->List.NumItems)
+        index = -1;
+
+    if (index == widget->List.Selected)
+        return;
+
+    widget->List.Selected = index;
+    widget->List.Top = Widget_ListTop(widget);
+
+    Widget_MarkDirty(widget, WIDGET_DIRTY_SELECTION); // a new top is seen when drawing, and then all is drawn
+}
+
+void Widget_SetItems(Widget *widget, uint32_t numItems)
+{
+    widget->List.NumItems = numItems;
+    widget->List.Selected = -1;
+    widget->List.Top = 0;
+
+    if (widget->List.Widths != NULL)
+        TextWidthCache_Reset(widget->List.Widths, numItems);
+
+    Widget_Invalidate(widget);
+}
+
+void Widget_ItemsChanged(Widget *widget, uint32_t numItems, uint32_t firstChanged)
+{
+    widget->List.NumItems = numItems;
+
+    if (widget->List.Selected >= (int64_t)numItems)
+        widget->List.Selected = -1;
+
+    widget->List.RedrawFirst = min(widget->List.RedrawFirst, firstChanged);
+
+    if (widget->List.Widths != NULL)
+        TextWidthCache_Changed(widget->List.Widths, numItems, firstChanged);
+
+    Widget_MarkDirty(widget, WIDGET_DIRTY_ITEMS);
+}
+
+void Widget_ListPage(const Widget *widget, uint32_t *page, uint32_t *numPages)
+{
+    uint32_t pageSize = Widget_ListPageSize(widget);
+
+    *page = widget->List.Top / pageSize;
+    *numPages = (widget->List.NumItems + pageSize - 1) / pageSize;
+}
+
+// LAYOUT
+// =================================================================
+
+static uint8_t Widget_Edge(int8_t edge, uint8_t size)
+{
+    int16_t position = (edge >= 0) ? edge : size + edge;
+    return (uint8_t)max(min(position, size), 0);
+}
+
+static void Widget_Place(Widget *widget, const WidgetArea *parent)
+{
+    uint8_t left    = Widget_Edge(widget->Placement.Left,   parent->W);
+    uint8_t top     = Widget_Edge(widget->Placement.Top,    parent->H);
+    uint8_t right   = Widget_Edge(widget->Placement.Right,  parent->W);
+    uint8_t bottom  = Widget_Edge(widget->Placement.Bottom, parent->H);
+
+    widget->Area.X = parent->X + left;
+    widget->Area.Y = parent->Y + top;
+    widget->Area.W = (right > left) ? right - left : 0;
+    widget->Area.H = (bottom > top) ? bottom - top : 0;
+}
+
+static void Widget_PlaceChildren(Widget *widget)
+{
+    if (widget->Type == WIDGET_LIST) // the page size changed
+    {
+        if ((widget->List.Flags & WIDGET_LIST_PAGED) && widget->List.Selected < 0)
+            widget->List.Top = 0; // the old page number means nothing
+        else
+            widget->List.Top = Widget_ListTop(widget);
+    }
+
+    for (Widget *child = widget->FirstChild; child != NULL; child = child->Next)
+    {
+        Widget_Place(child, &widget->Area);
+        Widget_PlaceChildren(child);
+    }
+}
+
+void Widget_Layout(Widget *root, const WidgetArea *area)
+{
+    if (root->Area.W != 0 && memcmp(&root->Area, area, sizeof(WidgetArea)) == 0)
+        return; // the cached layout is still right
+
+    root->Area = *area;
+    Widget_PlaceChildren(root);
+    Widget_MarkTree(root);
+}
+
+// DRAWING
+// =================================================================
+
+static void Widget_DrawPanel(Widget *widget, const WidgetStyle *style)
+{
+    const WidgetArea *area = &widget->Area;
+
+    if (widget->Panel.Chrome != NULL)
+    {
+        int split = (widget->Panel.Split >= 0) ? widget->Panel.Split : area->H + widget->Panel.Split;
+        ChromeCache_Render(area->X, area->Y, area->W, area->H, style->BoxText, style->BoxBack, widget->Panel.Chrome, (uint8_t)max(split, 0));
+    }
+
+    if (widget->Panel.Title != NULL)
+    {
+        Terminal_SetStyle(style->TitleText, style->TitleBack);
+
+        if (widget->Panel.TitleWidth == WIDGET_TITLE_HALF)
+        {
+            Terminal_SetCursorPosition(area->X+area->W/4,area->Y);
+            PrintWidth(area->W/2,1,widget->Panel.Title);
+        }
+        else
+        {
+            Terminal_SetCursorPosition(area->X+1,area->Y);
+            PrintWidth(area->W-2,1,widget->Panel.Title);
+        }
+    }
+
+    for (Widget *child = widget->FirstChild; child != NULL; child = child->Next) // the frame painted over them
+        Widget_MarkTree(child);
+
+    widget->ChildDirty = (widget->FirstChild != NULL);
+}
+
+static void Widget_DrawLabel(const Widget *widget, const WidgetStyle *style)
+{
+    Terminal_SetCursorPosition(widget->Area.X, widget->Area.Y);
+
+    if (widget->Label.Text[0] == '\0') // an empty label leaves the panel showing
+        Terminal_SetStyle(style->BoxText, style->BoxBack);
+    else if (widget->Label.Role == WIDGET_ROLE_TITLE)
+        Terminal_SetStyle(style->TitleText, style->TitleBack);
+    else
+        Terminal_SetStyle(style->ContentText, style->ContentBack);
+
+    PrintWidth(widget->Area.W, widget->Label.Centered, widget->Label.Text);
+}
+
+static void Widget_DrawParagraph(const Widget *widget, const WidgetStyle *style)
+{
+    const TextWrap *wrap = widget->Paragraph.Wrap;
+    const TextWrapLayout *layout = TextWrap_Get(widget->Paragraph.Wrap, widget->Area.W); // the same lines as long as the width is the same
+
+    if (widget->Paragraph.Role == WIDGET_ROLE_TITLE)
+        Terminal_SetStyle(style->TitleText, style->TitleBack);
+    else
+        Terminal_SetStyle(style->ContentText, style->ContentBack);
+
+    uint8_t indent = (layout != NULL && widget->Paragraph.Centered && layout->Columns < widget->Area.W) ? (widget->Area.W - layout->Columns)/2 : 0; // the lines are centered as a block, aligned on the left
+
+    for (uint8_t row = 0; row < widget->Area.H; row++)
+    {
+        Terminal_SetCursorPosition(widget->Area.X, widget->Area.Y + row);
+
+        if (layout != NULL && row < layout->NumLines)
+        {
+            const TextWrapLine *line = &layout->Lines[row];
+            PrintSpaces(indent);
+            PrintWidthBytes(widget->Area.W - indent, 0, &wrap->Text[line->Start], line->Length, line->Columns);
+        }
+        else
+            PrintSpaces(widget->Area.W);
+    }
+}
+
+static void Widget_DrawTextField(const Widget *widget, const WidgetStyle *style)
+{
+    size_t captionColumns;
+    size_t captionLength = TextWidth_Truncate(widget->TextField.Caption, strlen(widget->TextField.Caption), widget->Area.W, &captionColumns);
+
+    Terminal_SetCursorPosition(widget->Area.X, widget->Area.Y);
+    Terminal_SetStyle(style->TitleText, style->TitleBack);
+    printf("%.*s", (int)captionLength, widget->TextField.Caption);
+    Terminal_SetStyle(style->ContentText, style->ContentBack);
+    PrintWidth(widget->Area.W - captionColumns, 0, widget->TextField.Text);
+}
+
+static void Widget_DrawSlider(const Widget *widget, const WidgetStyle *style)
+{
+    #if (defined(unix) || defined(__unix__) || defined(__unix))
+        uint8_t bSliderboxUseUTF8 = 1;
+    #elif (defined(WIN32) || defined(_WIN32) || defined(__WIN32) || defined(__WIN32__))
+        uint8_t bSliderboxUseUTF8 = (GetConsoleOutputCP() == CP_UTF8);
+    #endif
+
+    uint8_t X = widget->Area.X, Y = widget->Area.Y, width = widget->Area.W;
+    float minValue = widget->Slider.Min, curValue = widget->Slider.Value, maxValue = widget->Slider.Max;
+
+    if (width < 4) // no room for the ends of the bar
+        return;
+
+    Arena *scratch = Arena_Scratch();
+    ArenaMark mark = Arena_Mark(scratch);
+    size_t capacity = 3 * (size_t)width + 64; // the bar takes up to 3 bytes a column, the values some digits more
+    char *slider = (char*)Arena_Alloc(scratch, capacity);
+    if (slider == NULL)
+        return;
+
+    // min max values
+    size_t formatWidth = snprintf(slider, capacity, "%4.2f", minValue); // min value
+    size_t len = formatWidth;
+
+    for (int i = 0; i < (int)width-2 - (int)formatWidth*2; i++)
+        slider[len++] = ' ';                                // spaces
+
+    snprintf(slider + len, capacity - len, "%4.2f", maxValue);
+
+    Terminal_SetStyle(style->OptionsText_Normal, style->OptionsBack_Normal);
+    Terminal_SetCursorPosition(X+1,Y);
+    printf("%s", slider);
+
+    // bar
+    uint8_t sliderLength = width - 4;
+    const char *starter = bSliderboxUseUTF8 ? "\xE2\x94\x9C" : "|";
+    const char *marker  = bSliderboxUseUTF8 ? "\xE2\x95\x91" : "X";
+    const char *line    = bSliderboxUseUTF8 ? "\xE2\x94\x80" : "-";
+    const char *end     = bSliderboxUseUTF8 ? "\xE2\x94\xA4" : "|";
+    size_t cellBytes = strlen(line);
+
+    uint8_t markerPosition = (uint8_t) (sliderLength * (curValue - minValue) / (maxValue - minValue));
+
+    memcpy(slider, starter, cellBytes);
+    len = cellBytes;
+    for (uint8_t i = 0; i < sliderLength; i++, len += cellBytes)
+        memcpy(slider + len, (i == markerPosition) ? marker : line, cellBytes);
+    memcpy(slider + len, end, cellBytes);
+    slider[len + cellBytes] = '\0';
+
+    Terminal_SetCursorPosition(X+1,Y+1);
+    Terminal_SetStyle(style->OptionsText_Active, style->OptionsBack_Active);
+    printf("%s", slider);
+
+    // current value
+    len = 0;
+    for (uint8_t i = 0; i < width; i++)
+        if (i == markerPosition + 2 - ((markerPosition > sliderLength/2) ? formatWidth-1 : 0) )
+            i = len += snprintf(slider + len, capacity - len, "%4.2f", curValue);
+        else
+            slider[len++] = ' ';
+    slider[len] = '\0';
+
+    Terminal_SetStyle(style->OptionsText_Normal, style->OptionsBack_Normal);
+    Terminal_SetCursorPosition(X,Y+2);
+    printf("%s", slider);
+
+    Arena_Release(scratch, mark);
+}
+
+static void Widget_DrawList(Widget *widget, const WidgetStyle *style)
+{
+    uint8_t columns = widget->List.Columns;
+    uint8_t columnWidth = widget->Area.W / columns;
+    uint8_t cellWidth = (widget->List.Flags & WIDGET_LIST_SPACED) ? columnWidth - 2 : columnWidth;
+    uint8_t centered = (widget->List.Flags & WIDGET_LIST_CENTERED) != 0;
+
+    uint32_t top = widget->List.Top;
+    uint32_t pageEnd = top + Widget_ListPageSize(widget);
+    uint32_t itemsEnd = min(pageEnd, widget->List.NumItems);
+
+    uint8_t all = (widget->Dirty & WIDGET_DIRTY_ALL) || top != widget->List.ShownTop; // otherwise only the items that changed
+    uint32_t changedFirst = (widget->Dirty & WIDGET_DIRTY_ITEMS) ? widget->List.RedrawFirst : UINT32_MAX;
+
+    for (uint32_t index = top; index < pageEnd; index++)
+    {
+        uint8_t draw = all || index >= changedFirst || index == widget->List.Selected || index == widget->List.ShownSelected;
+
+        if (!draw || (index >= itemsEnd && !all && index >= widget->List.ShownEnd))
+            continue;
+
+        uint32_t cell = index - top;
+        Terminal_SetCursorPosition(widget->Area.X + (cell % columns) * columnWidth, widget->Area.Y + cell / columns);
+
+        if (index >= itemsEnd) // nothing here, or not anymore
+        {
+            Terminal_SetStyle(style->BoxText, style->BoxBack);
+            PrintWidth(cellWidth, 0, "");
+            continue;
+        }
+
+        if (index == widget->List.Selected)
+            Terminal_SetStyle(style->OptionsText_Active, style->OptionsBack_Active);
+        else
+            Terminal_SetStyle(style->OptionsText_Normal, style->OptionsBack_Normal);
+
+        const char *text = widget->List.GetItem(widget->List.Context, index); // only the items on the screen are ever asked for
+        size_t textColumns = (widget->List.Widths != NULL) ? TextWidthCache_Get(widget->List.Widths, index, text) : TextWidth_String(text);
+
+        PrintWidthColumns(cellWidth, centered, text, textColumns);
+    }
+
+    widget->List.ShownTop = top;
+    widget->List.ShownSelected = widget->List.Selected;
+    widget->List.ShownEnd = itemsEnd;
+    widget->List.RedrawFirst = UINT32_MAX;
+}
+
+static void Widget_Draw(Widget *widget, const WidgetStyle *style)
+{
+    if (widget->Dirty && widget->Area.W > 0 && widget->Area.H > 0)
+    {
+        switch (widget->Type)
+        {
+            case WIDGET_PANEL:      Widget_DrawPanel(widget, style);        break;
+            case WIDGET_LABEL:      Widget_DrawLabel(widget, style);        break;
+            case WIDGET_PARAGRAPH:  Widget_DrawParagraph(widget, style);    break;
+            case WIDGET_TEXT_FIELD: Widget_DrawTextField(widget, style);    break;
+            case WIDGET_SLIDER:     Widget_DrawSlider(widget, style);       break;
+            case WIDGET_LIST:       Widget_DrawList(widget, style);         break;
+        }
+    }
+
+    widget->Dirty = 0;
+
+    if (!widget->ChildDirty)
+        return; // nothing changed below
+
+    widget->ChildDirty = 0;
+    for (Widget *child = widget->FirstChild; child != NULL; child = child->Next)
+        if (child->Dirty || child->ChildDirty)
+            Widget_Draw(child, style);
+}
+
+void Widget_Render(Widget *root, const WidgetStyle *style)
+{
+    Widget_Draw(root, style);
+}
+
+uint8_t Widget_NeedsRender(const Widget *root)
+{
+    return root->Dirty || root->ChildDirty;
+}
+
+// INPUT
+// =================================================================
+
+static uint8_t Widget_ListKey(Widget *widget, char key)
+{
+    int64_t selected = widget->List.Selected;
+    int64_t numItems = widget->List.NumItems;
+    int64_t candidate;
+
+    switch (key)
+    {
+        case KEY_ARROW_UP:      candidate = selected - widget->List.Columns; break;
+        case KEY_ARROW_DOWN:    candidate = selected + widget->List.Columns; break;
+        case KEY_ARROW_LEFT:    if (widget->List.Columns == 1) return 0; candidate = selected - 1; break;
+        case KEY_ARROW_RIGHT:   if (widget->List.Columns == 1) return 0; candidate = selected + 1; break;
+        case KEY_PAGE_UP:       candidate = max(selected - (int64_t)Widget_ListPageSize(widget), 0); break; // the page keys stop at the ends ...
+        case KEY_PAGE_DOWN:     candidate = min(max(selected, 0) + (int64_t)Widget_ListPageSize(widget), numItems - 1); break;
+        default: return 0;
+    }
+
+    if (candidate < 0 || candidate >= numItems || candidate == selected) // ... the arrows don't move past them
+        return 0;
+
+    Widget_Select(widget, candidate);
+    return 1;
+}
+
+uint8_t Widget_HandleKey(Widget *widget, char key)
+{
+    switch (widget->Type)
+    {
+        case WIDGET_TEXT_FIELD:
+        {
+            size_t length = strlen(widget->TextField.Text);
+
+            if (key == KEY_BACKSPACE && length > 0)
+                widget->TextField.Text[length - 1] = '\0';
+            else if (isprint((unsigned char)key) && length + 1 < widget->TextField.Capacity)
+            {
+                widget->TextField.Text[length] = key;
+                widget->TextField.Text[length + 1] = '\0';
+            }
+            else
+                return 0;
+
+            Widget_Invalidate(widget);
+            return 1;
+        }
+
+        case WIDGET_SLIDER:
+            if (key == KEY_ARROW_LEFT && widget->Slider.Value - widget->Slider.Increment >= widget->Slider.Min)
+                Widget_SetValue(widget, widget->Slider.Value - widget->Slider.Increment);
+            else if (key == KEY_ARROW_RIGHT && widget->Slider.Value + widget->Slider.Increment <= widget->Slider.Max)
+                Widget_SetValue(widget, widget->Slider.Value + widget->Slider.Increment);
+            else
+                return 0;
+
+            return 1;
+
+        case WIDGET_LIST:
+            return Widget_ListKey(widget, key);
+
+        default:
+            return 0;
+    }
+}
+
+// MODAL DIALOGS
+// =================================================================
+
+void WidgetDialog_Init(WidgetDialog *dialog, Widget *root, const WidgetStyle *style, void (*layout)(WidgetArea *area, void *context), void *context, RenderStatsScope scope)
+{
+    memset(dialog, 0, sizeof(WidgetDialog));
+    dialog->Root = root;
+    dialog->Style = style;
+    dialog->Layout = layout;
+    dialog->Context = context;
+    dialog->Scope = scope;
+
+    FrameScheduler_Create(&dialog->Scheduler, 0);
+}
+
+char WidgetDialog_Run(WidgetDialog *dialog)
+{
+    if (Session_Lock() != 0) // cannot let anything else mess the screen while the dialog is on
+        return 0;
+
+    char previousMode = SetMode(1); // once for the whole dialog: the keys typed ahead are neither echoed nor held back until a new line
+    SyncUpdate_Detect(); // the first dialog on a terminal asks it, before the first frame
+    Terminal_SaveCursorPosition();
+    RenderStatsScope previousScope = RenderStats_SetScope(dialog->Scope);
+
+    WidgetArea area, shownArea;
+    dialog->Layout(&area, dialog->Context);
+
+    uint8_t shown = 0;
+    char kb = 0;
+
+    for (;;)
+    {
+        FrameEvent event = FrameScheduler_Wait(&dialog->Scheduler);
+
+        if (event == FRAME_EVENT_WATCH)
+        {
+            if (dialog->OnWatch != NULL)
+                dialog->OnWatch(dialog);
+
+            if (Widget_NeedsRender(dialog->Root))
+                FrameScheduler_Invalidate(&dialog->Scheduler);
+            continue;
+        }
+
+        if (event == FRAME_EVENT_RESIZE)
+        {
+            dialog->Layout(&area, dialog->Context);
+
+            if (!shown || memcmp(&area, &shownArea, sizeof(area)) != 0) // a resize that does not move the dialog needs no redraw
+                FrameScheduler_Invalidate(&dialog->Scheduler);
+            continue;
+        }
+
+        if (event == FRAME_EVENT_PRESENT)
+        {
+            FrameScheduler_BeginFrame(&dialog->Scheduler);
+
+            if (!shown || memcmp(&area, &shownArea, sizeof(area)) != 0)
+            {
+                if (shown)
+                    Widget_ClearUncoveredArea(&shownArea, &area);
+
+                Widget_Layout(dialog->Root, &area); // everything is placed and drawn again
+                shownArea = area;
+                shown = 1;
+            }
+
+            if (dialog->BeforeRender != NULL)
+                dialog->BeforeRender(dialog);
+
+            Widget_Render(dialog->Root, dialog->Style);
+
+            if (dialog->Cursor != NULL) // put the cursor where the typing goes
+            {
+                const Widget *field = dialog->Cursor;
+                size_t end = TextWidth_String(field->TextField.Caption) + TextWidth_String(field->TextField.Text);
+
+                Terminal_SetCursorPosition(field->Area.X + min(end, field->Area.W), field->Area.Y); // make sure the cursor does not end up outside the dialog in case the text is really long
+            }
+
+            FrameScheduler_EndFrame(&dialog->Scheduler);
+            continue;
+        }
+
+        // run keyboard interactivity
+        kb = getchNavigation();
+
+        uint8_t used = (dialog->Focus != NULL) ? Widget_HandleKey(dialog->Focus, kb) : 0;
+        WidgetAction action;
+
+        if (dialog->OnKey != NULL)
+            action = dialog->OnKey(dialog, kb, used);
+        else
+            action = (kb == KEY_ENTER || kb == KEY_RETURN || kb == KEY_ESC) ? WIDGET_CLOSE : WIDGET_CONTINUE;
+
+        if (action == WIDGET_CLOSE)
+            break;
+
+        if (Widget_NeedsRender(dialog->Root))
+            FrameScheduler_Invalidate(&dialog->Scheduler);
+    }
+
+    RenderStats_SetScope(previousScope);
+    Terminal_RestoreCursorSavedPosition();
+    SetMode(previousMode); // a dialog opened from another one leaves it as it was
+    Session_Unlock();
+
+    return kb;
+}
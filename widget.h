@@ -0,0 +1,219 @@
+// ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  //
+#ifndef _WIDGET_H_
+#define _WIDGET_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../BrailleCanvas/BrailleCanvas/terminal.h"
+#include "chromecache.h"        // the panels print their frames from the cache
+#include "framescheduler.h"     // paces the redraws to a maximum frame rate
+#include "renderstats.h"        // counts what each dialog costs
+#include "textwidth.h"          // how many columns the text takes
+#include "textwrap.h"           // paragraphs are broken in lines once for each width
+
+// A tree of widgets that keep their state between frames. Changing the state of a widget marks it dirty, and each frame only draws the widgets that are dirty.
+// The placement of every widget is worked out once for each size of the dialog.
+
+#define WIDGET_TEXT_MAX         256 // longest text of a label (including the '\0')
+
+#define WIDGET_DIRTY_ALL        0b00000001  // the whole widget is drawn again
+#define WIDGET_DIRTY_SELECTION  0b00000010  // list: only the items whose highlight changed
+#define WIDGET_DIRTY_ITEMS      0b00000100  // list: the items from the first one that changed on
+
+#define WIDGET_LIST_PAGED       0b00000001  // the list shows a page at a time, instead of scrolling a line at a time
+#define WIDGET_LIST_CENTERED    0b00000010  // the items are centered in their cells
+#define WIDGET_LIST_SPACED      0b00000100  // two blank cells after each column
+
+typedef struct _WidgetStyle
+{
+    // box
+    ConsoleStyleText        BoxText;
+    ConsoleStyleBackground  BoxBack;
+    // title
+    ConsoleStyleText        TitleText;
+    ConsoleStyleBackground  TitleBack;
+    // message
+    ConsoleStyleText        ContentText;
+    ConsoleStyleBackground  ContentBack;
+    // options
+    ConsoleStyleText        OptionsText_Active;
+    ConsoleStyleBackground  OptionsBack_Active;
+    ConsoleStyleText        OptionsText_Normal;
+    ConsoleStyleBackground  OptionsBack_Normal;
+} WidgetStyle;
+
+typedef struct _WidgetArea // where a widget is on the screen (not counting the shadow of a panel)
+{
+    uint8_t X;
+    uint8_t Y;
+    uint8_t W;
+    uint8_t H;
+} WidgetArea;
+
+typedef struct _WidgetPlacement // the edges of a widget inside its parent: non-negative are cells from the left / top edge, negative are cells from the right / bottom edge (right and bottom are not included)
+{
+    int8_t Left;
+    int8_t Top;
+    int8_t Right;
+    int8_t Bottom;
+} WidgetPlacement;
+
+typedef enum {
+    WIDGET_PANEL,           // a framed box the other widgets are placed in
+    WIDGET_LABEL,           // a line of text
+    WIDGET_PARAGRAPH,       // text wrapped in as many lines as the widget has
+    WIDGET_TEXT_FIELD,      // a caption and the text typed after it
+    WIDGET_SLIDER,          // a value between two limits (three lines)
+    WIDGET_LIST,            // items in rows and columns, of which one may be selected (buttons are a list too)
+} WidgetType;
+
+typedef enum {
+    WIDGET_ROLE_TITLE,      // printed like the titles
+    WIDGET_ROLE_CONTENT,    // printed like the messages
+} WidgetRole;
+
+typedef enum {
+    WIDGET_TITLE_FULL,      // the title of a panel is centered on its whole top border ...
+    WIDGET_TITLE_HALF,      // ... or on the middle half of it
+} WidgetTitleWidth;
+
+typedef const char* (*WidgetGetItem)(void *context, uint32_t index); // the text of an item of a list
+
+typedef struct _Widget
+{
+    WidgetType Type;
+    WidgetPlacement Placement;
+    WidgetArea Area;                // on the screen, as of the last layout
+    uint8_t Dirty;                  // WIDGET_DIRTY_* of this widget
+    uint8_t ChildDirty;             // some widget below this one is dirty
+
+    struct _Widget *Parent;
+    struct _Widget *FirstChild;
+    struct _Widget *LastChild;
+    struct _Widget *Next;
+
+    union
+    {
+        struct {
+            ChromeDrawer Chrome;
+            const char *Title;
+            WidgetTitleWidth TitleWidth;
+            int8_t Split;           // the row the chrome is divided at: from the top, or from the bottom if negative (0 = none)
+        } Panel;
+
+        struct {
+            char Text[WIDGET_TEXT_MAX];
+            WidgetRole Role;
+            uint8_t Centered;
+        } Label;
+
+        struct {
+            TextWrap *Wrap;         // owned by the caller, with the text ... the lines for each width are kept there
+            WidgetRole Role;
+            uint8_t Centered;
+        } Paragraph;
+
+        struct {
+            const char *Caption;
+            char *Text;             // owned by the caller, who edits it too (and then calls Widget_Invalidate)
+            size_t Capacity;
+        } TextField;
+
+        struct {
+            float Min;
+            float Value;
+            float Max;
+            float Increment;
+        } Slider;
+
+        struct {
+            uint32_t NumItems;
+            WidgetGetItem GetItem;
+            void *Context;
+            uint8_t Columns;
+            uint8_t Flags;          // WIDGET_LIST_*
+            int64_t Selected;       // -1 = nothing
+            uint32_t Top;           // first item on the screen
+            // what is on the screen
+            uint32_t ShownTop;
+            int64_t ShownSelected;
+            uint32_t ShownEnd;      // one past the last item on the screen
+            uint32_t RedrawFirst;   // the items before this one did not change
+            TextWidthCache *Widths; // NULL = measure the items each time they are drawn
+        } List;
+    };
+} Widget;
+
+void PrintWidth(uint8_t width, uint8_t centered, const char* text); // prints exactly width columns: the text is padded or shortened (with "..")
+void PrintWidthColumns(uint8_t width, uint8_t centered, const char* text, size_t columns); // same, for text already measured
+void PrintWidthBytes(uint8_t width, uint8_t centered, const char* text, size_t length, size_t columns); // same, for length bytes of the text
+void Widget_ClearUncoveredArea(const WidgetArea *oldArea, const WidgetArea *newArea); // clears what a dialog that moved left behind
+
+// building the tree (a NULL parent makes a root)
+void Widget_InitPanel(Widget *widget, Widget *parent, WidgetPlacement placement, ChromeDrawer chrome, const char *title, WidgetTitleWidth titleWidth);
+void Widget_InitLabel(Widget *widget, Widget *parent, WidgetPlacement placement, const char *text, WidgetRole role, uint8_t centered);
+void Widget_InitParagraph(Widget *widget, Widget *parent, WidgetPlacement placement, TextWrap *wrap, WidgetRole role, uint8_t centered); // centered moves the lines as a block ... the lines that do not fit in the height are not shown
+void Widget_InitTextField(Widget *widget, Widget *parent, WidgetPlacement placement, const char *caption, char *text, size_t capacity);
+void Widget_InitSlider(Widget *widget, Widget *parent, WidgetPlacement placement, float minValue, float value, float maxValue, float increment);
+void Widget_InitList(Widget *widget, Widget *parent, WidgetPlacement placement, uint32_t numItems, WidgetGetItem getItem, void *context, uint8_t columns, uint8_t flags);
+void Widget_CacheWidths(Widget *widget, TextWidthCache *cache); // list: measure each item only once (the cache follows SetItems and ItemsChanged)
+void Widget_InitButtons(Widget *widget, Widget *parent, WidgetPlacement placement, uint8_t numOptions, char* options[]); // a centered list of options, the first one selected
+
+// changing the state (each marks what must be drawn again)
+void Widget_Invalidate(Widget *widget);
+void Widget_SetText(Widget *widget, const char *text); // label ... nothing is drawn if the text is the same
+void Widget_SetValue(Widget *widget, float value); // slider
+void Widget_Select(Widget *widget, int64_t index); // list: -1 selects nothing
+void Widget_SetItems(Widget *widget, uint32_t numItems); // list: all new items, shown from the top
+void Widget_ItemsChanged(Widget *widget, uint32_t numItems, uint32_t firstChanged); // list: the items before firstChanged are the same
+void Widget_ListPage(const Widget *widget, uint32_t *page, uint32_t *numPages); // list: where the shown page is
+
+void Widget_Layout(Widget *root, const WidgetArea *area); // places the whole tree ... nothing happens if the area is the same
+void Widget_Render(Widget *root, const WidgetStyle *style); // draws the dirty widgets
+uint8_t Widget_NeedsRender(const Widget *root);
+uint8_t Widget_HandleKey(Widget *widget, char key); // returns 1 if the widget used the key (and changed)
+
+// a modal dialog made of a tree: it runs the frame loop and gives the keys to the focused widget, then to OnKey
+
+typedef enum {
+    WIDGET_CONTINUE,
+    WIDGET_CLOSE,
+} WidgetAction;
+
+typedef struct _WidgetDialog WidgetDialog;
+
+struct _WidgetDialog
+{
+    Widget *Root;
+    Widget *Focus;              // gets the keys first (NULL = none)
+    Widget *Cursor;             // text field the cursor is left in (NULL = wherever the drawing ended)
+    const WidgetStyle *Style;
+    RenderStatsScope Scope;
+    FrameScheduler Scheduler;   // FrameScheduler_Watch() on it for OnWatch
+
+    void (*Layout)(WidgetArea *area, void *context);                // where the root goes, for the current terminal size
+    WidgetAction (*OnKey)(WidgetDialog *dialog, char key, uint8_t used); // NULL = <enter> and <esc> close the dialog
+    void (*OnWatch)(WidgetDialog *dialog);                          // the watched descriptor can be read
+    void (*BeforeRender)(WidgetDialog *dialog);                     // the last changes before a frame is drawn
+    void *Context;
+};
+
+void WidgetDialog_Init(WidgetDialog *dialog, Widget *root, const WidgetStyle *style, void (*layout)(WidgetArea *area, void *context), void *context, RenderStatsScope scope);
+char WidgetDialog_Run(WidgetDialog *dialog); // returns the key that closed the dialog, or 0 if the terminal is taken
+
+#endif // _WIDGET_H_